@@ -2,10 +2,15 @@
 # 俄罗斯方块游戏 Flask 后端
 # 本文件是一个 Flask Web 应用，充当 C++ 游戏引擎与 JavaScript 前端之间的桥梁
 
-from flask import Flask, jsonify, request, render_template
+from flask import Flask, jsonify, request, render_template, g, Response
 from cffi import FFI  # CFFI库用于Python调用C/C++代码
 import os
 import platform
+import json
+import time
+import atexit     # 退出时写检查点
+import threading  # 定期写检查点的后台线程
+from contextlib import contextmanager  # 只在调用核心期间持有会话锁
 
 # 创建Flask应用实例
 app = Flask(__name__)
@@ -45,6 +50,7 @@ if actual_lib_path:
     # 在C语言中使用分号结束，但在CFFI的声明中不需要
     ffi.cdef("""
         typedef struct TetrisGame TetrisGame; // 不透明指针类型，我们不需要知道其内部结构
+        typedef struct GameState GameState;   // 状态快照，按get_state_size_api()分配的字节缓冲区
 
         TetrisGame* create_game();         // 创建游戏实例
         void destroy_game(TetrisGame* game); // 销毁游戏实例
@@ -55,17 +61,56 @@ if actual_lib_path:
         bool rotate_piece_api(TetrisGame* game); // 旋转方块
         void drop_piece_api(TetrisGame* game);   // 直接下落方块
         bool game_tick_api(TetrisGame* game); // 推进游戏一个节拍，返回 !game_over
+        int drain_and_step_api(TetrisGame* game, int max_inputs, int ticks, uint64_t* out_max_wait_us); // 执行排队的输入
 
         const int* get_board_api(TetrisGame* game); // 获取棋盘数据
         int get_score_api(TetrisGame* game);        // 获取当前分数
         bool is_game_over_api(TetrisGame* game);    // 检查游戏是否结束
+
+        uint32_t get_board_delta_api(TetrisGame* game, uint8_t* out_rows, uint32_t* out_seq); // 获取脏行增量
+        uint32_t get_board_packed_api(TetrisGame* game, uint8_t* out_board); // 获取完整棋盘（关键帧）
         int get_board_width_api();  // 获取棋盘宽度
         int get_board_height_api(); // 获取棋盘高度
+
+        uint64_t create_session_api();                  // 创建新会话并开始游戏
+        TetrisGame* lookup_session_api(uint64_t session_id); // 查找会话对应的游戏
+        bool expire_session_api(uint64_t session_id);   // 使会话过期
+        int expire_idle_sessions_api(int max_idle_seconds); // 清理长时间未访问的会话
+        int get_session_count_api();                    // 当前活跃会话数量
+        TetrisGame* acquire_session_api(uint64_t session_id); // 查找并锁定会话
+        void release_session_api(uint64_t session_id);  // 释放会话锁
+        void release_session_changed_api(uint64_t session_id); // 释放会话锁并通知推送流
+        TetrisGame* wait_session_change_api(uint64_t session_id, uint64_t* inout_version, int timeout_ms); // 等待会话变化并锁定会话
+        bool enqueue_session_input_api(uint64_t session_id, int action, uint64_t timestamp_us); // 把动作放进会话的输入队列
+
+        bool start_gravity_api(int tick_ms);            // 启动服务器端重力调度器
+        bool gravity_add_session_api(uint64_t session_id); // 登记会话，使方块自动下落
+        int get_gravity_session_count_api();            // 已登记自动下落的会话数量
+        int get_level_api(TetrisGame* game);            // 获取当前等级
+        bool get_ghost_position_api(TetrisGame* game, int* out_x, int* out_y, int* out_cells); // 获取落点预览
+        int get_next_pieces_api(TetrisGame* game, int n, int* out_types); // 获取后续方块预览
+        size_t get_state_size_api();                    // 状态快照的字节数
+        void clone_state_api(TetrisGame* game, GameState* out_state); // 复制当前状态
+
+        int checkpoint_sessions_api(const char* path);  // 把所有会话写入检查点文件
+        int restore_sessions_api(const char* path, bool register_gravity); // 从检查点文件恢复会话
+
+        bool suggest_move_api(TetrisGame* game, int depth, int* out_rotations, int* out_x); // 求最佳落点
+        bool suggest_move_from_state_api(const GameState* state, int depth, int* out_rotations, int* out_x); // 在状态快照上求最佳落点
+        bool apply_suggested_move_api(TetrisGame* game, int depth); // 求解并立即执行
+
+        bool stats_enabled_api();           // 编译时是否开启了插桩计数器
+        int get_stat_count_api();           // 被统计的函数数量
+        const char* get_stat_name_api(int id); // 被统计的函数名称
+        int get_stats_api(uint64_t* out_calls, uint64_t* out_cycles, int max_count); // 读取统计数据
+        void reset_stats_api();             // 清零统计数据
     """)
     try:
         # 尝试加载动态链接库
         tetris_lib = ffi.dlopen(actual_lib_path)
         print(f"成功加载 C++ 库: {actual_lib_path}")
+        # 方块的自动下落由C++核心的重力调度器驱动，浏览器不再定时发送tick请求
+        tetris_lib.start_gravity_api(0)
     except OSError as e:
         # 捕获库加载失败的错误
         print(f"加载共享库 {actual_lib_path} 时出错: {e}")
@@ -78,102 +123,247 @@ elif lib_name: # 只有在lib_name被设置了 (即支持的操作系统) 才打
     print("请确保 C++ 库已正确编译并放置。")
     # tetris_lib 此时已经是 None
 
-# 全局游戏实例指针
-# 在多用户场景下，你需要会话管理或一个游戏实例的字典。
-# 对于这个单人游戏示例，一个全局游戏实例就足够了。
-game_instance = None
+# 会话管理
+# 每个浏览器通过cookie中的会话ID对应C++核心会话注册表中的一局游戏，
+# 不同玩家互不影响；游戏实例由C++核心统一分配和回收
+SESSION_COOKIE_NAME = "tetris_session"   # 保存会话ID的cookie名称
+SESSION_IDLE_SECONDS = 30 * 60           # 会话超过这么久没有访问就会被回收
+
+# 会话检查点
+# 重启或部署时进行中的游戏不会丢失：所有会话定期写入一个二进制检查点文件，
+# 启动时按原来的会话ID恢复，浏览器cookie中的会话ID仍然有效
+CHECKPOINT_PATH = os.environ.get(
+    "TETRIS_CHECKPOINT", os.path.join(os.path.dirname(os.path.abspath(__file__)), "sessions.ckpt"))
+CHECKPOINT_INTERVAL_SECONDS = 30  # 定期写检查点的间隔：进程被强制终止时最多丢失这么久的进度
+
+def save_checkpoint():
+    """
+    把所有会话写入检查点文件，返回写入的会话数（出错时为-1）。
+    """
+    written = tetris_lib.checkpoint_sessions_api(CHECKPOINT_PATH.encode())
+    if written < 0:
+        print(f"写入检查点 {CHECKPOINT_PATH} 失败")
+    return written
+
+def checkpoint_loop():
+    """
+    后台线程：每隔CHECKPOINT_INTERVAL_SECONDS秒写一次检查点。
+    """
+    while True:
+        time.sleep(CHECKPOINT_INTERVAL_SECONDS)
+        save_checkpoint()
 
-def get_game():
+def init_checkpoint():
     """
-    获取或创建游戏实例。
-    如果游戏实例不存在，则创建一个新的并开始游戏。
-    返回游戏实例指针。
+    从检查点恢复会话（未结束的游戏重新登记自动下落），然后开始定期写检查点，进程正常退出时再写一次。
+    """
+    if os.path.exists(CHECKPOINT_PATH):
+        restored = tetris_lib.restore_sessions_api(CHECKPOINT_PATH.encode(), True)
+        if restored < 0:
+            print(f"检查点 {CHECKPOINT_PATH} 无效，已忽略")
+        else:
+            print(f"从检查点恢复了 {restored} 个会话")
+    atexit.register(save_checkpoint)
+    threading.Thread(target=checkpoint_loop, name="tetris-checkpoint", daemon=True).start()
+
+# 开发模式的自动重载器会先启动一个只负责监视文件的父进程，真正处理请求的是子进程（WERKZEUG_RUN_MAIN为true）。
+# 父进程不能读写检查点，否则它退出时会用启动时的旧数据覆盖子进程写入的检查点
+if tetris_lib is not None and not (__name__ == '__main__' and os.environ.get("WERKZEUG_RUN_MAIN") != "true"):
+    init_checkpoint()
+
+def get_session_id_from_cookie():
+    """
+    从请求cookie中解析会话ID（16位十六进制字符串）。
+    cookie不存在或格式错误时返回0（无效ID）。
+    """
+    raw = request.cookies.get(SESSION_COOKIE_NAME, "")
+    try:
+        return int(raw, 16)
+    except ValueError:
+        return 0
+
+@contextmanager
+def locked_game():
+    """
+    锁定当前请求所属会话的游戏实例，with块结束时立即释放。
+    重力调度器会在后台线程中推动方块下落，锁定保证读写游戏期间它不会被同时修改。
+    会话锁是会话所在分片的锁：持有期间同一分片的其他会话（所有会话的1/64）和重力调度器都要等待，
+    所以with块中只放对C++核心的调用，JSON编码、求解器搜索等放在with块之外。
+    如果会话不存在（新访客或会话已过期），则创建一个新会话，请求结束后再登记自动下落，
+    新会话ID会在响应中通过cookie返回给浏览器。
+    释放时通知这个会话的推送流（/api/stream），由它把请求造成的变化推送给浏览器。
     """
-    global game_instance
     if tetris_lib is None:
         raise RuntimeError("Tetris 库未加载。无法创建或管理游戏。")
-    if game_instance is None:
-        # 如果没有现有的游戏实例，创建一个并开始新游戏
-        game_instance = tetris_lib.create_game()
-        tetris_lib.start_new_game_api(game_instance)
-    return game_instance
+    session_id = g.get("session_id") or get_session_id_from_cookie() # 本请求新建的会话还不在cookie中
+    game = tetris_lib.acquire_session_api(session_id) if session_id else ffi.NULL
+    if game == ffi.NULL:
+        # 新会话：C++核心会从实例池中取出一局游戏并开始
+        session_id = tetris_lib.create_session_api()
+        g.new_session_id = session_id
+        g.register_gravity = True
+        game = tetris_lib.acquire_session_api(session_id)
+    g.session_id = session_id
+    try:
+        # 持有会话锁的一方负责执行其他请求排进输入队列的按键，保证它们先于本请求的操作生效
+        tetris_lib.drain_and_step_api(game, 0, 0, ffi.NULL)
+        yield game
+    finally:
+        tetris_lib.release_session_changed_api(session_id)
 
-def get_board_state_from_lib(game):
+@app.teardown_request
+def register_session_gravity(exc):
     """
-    从C++库中获取棋盘状态并转换为Python数据结构。
-    
+    需要时把会话登记到重力调度器
+    （登记时调度器会锁定会话，所以必须在会话锁释放之后进行）。
+    """
+    session_id = g.get("session_id")
+    if session_id and tetris_lib is not None and g.pop("register_gravity", False):
+        tetris_lib.gravity_add_session_api(session_id)
+
+@app.after_request
+def attach_session_cookie(response):
+    """
+    如果本次请求创建了新会话，把会话ID写入cookie。
+    """
+    session_id = g.get("new_session_id")
+    if session_id:
+        response.set_cookie(SESSION_COOKIE_NAME, format(session_id, "016x"),
+                            httponly=True, samesite="Lax")
+    return response
+
+# 把棋盘字节（颜色值0-7）翻译成ASCII数字，每行编码成一个短字符串
+# 例如 b'\x00\x01\x01...' -> "011..."，前端按字符解析，比嵌套列表小得多
+_CELL_DIGITS = bytes.maketrans(bytes(range(10)), b'0123456789')
+
+def read_board_frame(game, full=False):
+    """
+    从C++库中读取一帧棋盘数据（增量或完整棋盘），只做核心调用和一次缓冲区复制，在持有会话锁时调用。
+
     参数:
         game: C++游戏实例的指针
-    
+        full: True表示读取完整棋盘（关键帧），False表示只读取改动过的行
+
     返回:
-        board_list: 二维列表，表示棋盘状态
-        width: 棋盘宽度
-        height: 棋盘高度
+        (帧序号, 是否关键帧, 行号列表, 这些行的字节)，交给format_board_frame在锁外编码
     """
-    if not game or tetris_lib is None:
-        return None, 0, 0
-        
-    # 获取棋盘数据和维度
-    board_ptr = tetris_lib.get_board_api(game)
     width = tetris_lib.get_board_width_api()
     height = tetris_lib.get_board_height_api()
-    
-    if board_ptr == ffi.NULL: # 检查返回的指针是否为空
-        return None, width, height
+    buf = ffi.new("uint8_t[]", width * height) # C++侧直接按字节写入，无需逐格读取
+    if full:
+        seq = tetris_lib.get_board_packed_api(game, buf)
+        row_indices = range(height)
+    else:
+        seq_ptr = ffi.new("uint32_t*")
+        mask = tetris_lib.get_board_delta_api(game, buf, seq_ptr)
+        seq = seq_ptr[0]
+        row_indices = [r for r in range(height) if mask & (1 << r)]
+    return seq, full, row_indices, ffi.buffer(buf, len(row_indices) * width)[:]
+
+def format_board_frame(raw):
+    """
+    把read_board_frame的结果编码成前端使用的帧（不需要持有会话锁）。
+
+    返回:
+        字典 {"seq": 帧序号, "full": 是否关键帧, "rows": [[行号, "行字符串"], ...]}
+    """
+    seq, full, row_indices, data = raw
+    width = tetris_lib.get_board_width_api()
+    # 一次性翻译整块缓冲区，再按行切片
+    text = data.translate(_CELL_DIGITS).decode('ascii')
+    rows = [[r, text[i * width:(i + 1) * width]] for i, r in enumerate(row_indices)]
+    return {"seq": seq, "full": full, "rows": rows}
+
+def get_ghost_from_lib(game):
+    """
+    获取落点预览：当前方块硬降后占据的4个格子 [[x, y], ...]，前端据此绘制虚影。
+    游戏已结束或库未加载时返回None。
+    """
+    if not game or tetris_lib is None:
+        return None
+    cells = ffi.new("int[8]")
+    if not tetris_lib.get_ghost_position_api(game, ffi.NULL, ffi.NULL, cells):
+        return None
+    return [[cells[i * 2], cells[i * 2 + 1]] for i in range(4)]
+
+# 界面上预览的后续方块数（核心最多提供8个）
+NEXT_PREVIEW_COUNT = 3
+
+def get_next_from_lib(game):
+    """
+    获取后续方块预览：接下来的NEXT_PREVIEW_COUNT个方块类型（0-6，颜色值是类型+1）。
+    游戏已结束或库未加载时返回空列表。
+    """
+    if not game or tetris_lib is None:
+        return []
+    types = ffi.new("int[]", NEXT_PREVIEW_COUNT)
+    count = tetris_lib.get_next_pieces_api(game, NEXT_PREVIEW_COUNT, types)
+    return [types[i] for i in range(count)]
 
-    # 将C数组（一维数组）转换为Python嵌套列表（二维数组）
-    # C++中的棋盘是按行优先顺序存储的一维数组
-    board_list = []
-    for r in range(height):
-        row = [board_ptr[r * width + c] for c in range(width)]
-        board_list.append(row)
-    return board_list, width, height
+def read_game_view(game, full=False, board=True):
+    """
+    在持有会话锁时读取响应需要的全部游戏数据：分数、结束标志，board为True时还有棋盘帧、落点预览和后续方块。
+    棋盘帧是read_board_frame的原始结果，由format_game_view在锁外编码。
+    """
+    view = {
+        "score": tetris_lib.get_score_api(game),
+        "gameOver": tetris_lib.is_game_over_api(game)
+    }
+    if board:
+        view["frame"] = read_board_frame(game, full=full)
+        view["ghost"] = get_ghost_from_lib(game)
+        view["next"] = get_next_from_lib(game)
+    return view
+
+def format_game_view(view):
+    """
+    把read_game_view的结果变成可以直接放进JSON的字典（不需要持有会话锁）。
+    """
+    if "frame" in view:
+        view["frame"] = format_board_frame(view["frame"])
+    return view
 
 # API路由：开始新游戏
 @app.route('/api/start', methods=['POST'])
 def start_game():
     """
     处理开始新游戏的API请求。
-    清理旧的游戏实例（如果有），创建新的游戏实例，并返回初始游戏状态。
+    在当前会话的游戏实例上重新开始（没有会话则创建），并返回初始游戏状态。
     """
-    global game_instance
     if tetris_lib is None:
         return jsonify({"error": "Tetris 库未加载"}), 500
 
-    if game_instance: # 如果存在旧的游戏实例
-        tetris_lib.destroy_game(game_instance) # 清理旧的游戏实例
-    game_instance = tetris_lib.create_game()
-    tetris_lib.start_new_game_api(game_instance)
-    
-    # 获取并返回初始游戏状态
-    board_data, _, _ = get_board_state_from_lib(game_instance)
-    return jsonify({
-        "message": "新游戏已开始",
-        "board": board_data,
-        "score": tetris_lib.get_score_api(game_instance),
-        "gameOver": tetris_lib.is_game_over_api(game_instance)
-    })
+    # 顺便回收长时间未访问的会话（开始游戏的请求频率低，适合做这种清理）
+    tetris_lib.expire_idle_sessions_api(SESSION_IDLE_SECONDS)
+
+    with locked_game() as game:
+        if not g.get("new_session_id"):
+            # 已有会话：在原实例上重新开始，不需要销毁和重新创建
+            tetris_lib.start_new_game_api(game)
+        view = read_game_view(game, full=True) # 初始游戏状态（完整棋盘）
+    g.register_gravity = True # 重新开局后从0级的速度重新计时
+
+    response = format_game_view(view)
+    response["message"] = "新游戏已开始"
+    return jsonify(response)
 
 # API路由：获取当前游戏状态
 @app.route('/api/state', methods=['GET'])
 def get_state():
     """
     获取当前游戏状态的API。
-    返回棋盘布局、分数和游戏结束状态。
+    返回完整棋盘、分数和游戏结束状态。
     """
-    game = get_game() # 获取当前或新的游戏实例
     if tetris_lib is None:
         return jsonify({"error": "Tetris 库未加载"}), 500
-    if not game: # 理论上 get_game() 会确保有一个实例，除非库加载失败
-         return jsonify({"error": "游戏未初始化。请调用 /api/start"}), 400
 
-    # 获取并返回当前游戏状态
-    board_data, _, _ = get_board_state_from_lib(game)
-    return jsonify({
-        "board": board_data,
-        "score": tetris_lib.get_score_api(game),
-        "gameOver": tetris_lib.is_game_over_api(game)
-    })
+    # 获取并返回当前游戏状态（完整棋盘，客户端用于初始化或重新同步）
+    with locked_game() as game: # 当前或新的游戏实例
+        view = read_game_view(game, full=True)
+    return jsonify(format_game_view(view))
+
+# 动作名称 -> 动作编码（TetrisAction），放进输入队列时使用
+ACTION_CODES = {"left": 1, "right": 2, "rotate": 3, "drop": 4, "tick": 5}
 
 # API路由：处理游戏动作
 @app.route('/api/action', methods=['POST'])
@@ -182,42 +372,161 @@ def handle_action():
     处理游戏动作的API。
     接收客户端发送的动作（如移动、旋转等），执行动作，并返回更新后的游戏状态。
     """
-    game = get_game()
     if tetris_lib is None:
         return jsonify({"error": "Tetris 库未加载"}), 500
-    if not game:
-         return jsonify({"error": "游戏未初始化。请调用 /api/start"}), 400
-    if tetris_lib.is_game_over_api(game):
-        return jsonify({"message": "游戏已结束。请开始新游戏。", "gameOver": True}), 400
-
-    # 从请求中获取动作类型
     action = request.json.get('action') # 从请求的JSON体中获取动作
-    action_taken = False # 标记动作是否实际执行（例如，移动是否成功）
 
-    # 根据动作类型执行相应的操作
-    if action == 'left':
-        action_taken = tetris_lib.move_left_api(game)
-    elif action == 'right':
-        action_taken = tetris_lib.move_right_api(game)
-    elif action == 'rotate':
-        action_taken = tetris_lib.rotate_piece_api(game)
-    elif action == 'drop':
-        tetris_lib.drop_piece_api(game) # 硬直落总是会改变状态
-        action_taken = True # 假设 drop 改变了状态，即使只是固化方块
-    elif action == 'tick': # 游戏时钟滴答，由前端计时器触发
-        action_taken = tetris_lib.game_tick_api(game) # game_tick 推进游戏状态
-    else:
+    # 连接了推送流的客户端不需要在响应里拿到棋盘：动作只放进游戏的输入队列就返回，
+    # 不执行动作；入队会唤醒推送流，排队的动作由下一次持有会话的一方（推送流或重力调度器）按顺序执行。
+    # 查找会话和入队由注册表在分片锁内一起完成，不能先lookup再入队：两步之间会话可能过期，
+    # 游戏实例被回收给别的会话甚至被销毁，按键就会落到别人的游戏里
+    if request.json.get('stream') and action in ACTION_CODES:
+        session_id = get_session_id_from_cookie()
+        if session_id and tetris_lib.enqueue_session_input_api(session_id, ACTION_CODES[action], 0):
+            return jsonify({"action": action, "queued": True})
+        # 会话不存在或队列已满：走下面加锁的同步路径
+
+    if action not in ACTION_CODES:
         return jsonify({"error": "无效的动作"}), 400
 
-    # 获取并返回更新后的游戏状态
-    board_data, _, _ = get_board_state_from_lib(game)
-    return jsonify({
-        "action": action,
-        "success": action_taken, # 对于移动操作，指示移动是否有效
-        "board": board_data,
-        "score": tetris_lib.get_score_api(game),
-        "gameOver": tetris_lib.is_game_over_api(game)
-    })
+    action_taken = False # 标记动作是否实际执行（例如，移动是否成功）
+    view = None          # 游戏已结束时保持为None
+    with locked_game() as game:
+        if not tetris_lib.is_game_over_api(game):
+            # 根据动作类型执行相应的操作
+            if action == 'left':
+                action_taken = tetris_lib.move_left_api(game)
+            elif action == 'right':
+                action_taken = tetris_lib.move_right_api(game)
+            elif action == 'rotate':
+                action_taken = tetris_lib.rotate_piece_api(game)
+            elif action == 'drop':
+                tetris_lib.drop_piece_api(game) # 硬直落总是会改变状态
+                action_taken = True # 假设 drop 改变了状态，即使只是固化方块
+            elif action == 'tick': # 软降（按住S键）：立即下落一格；平时的自动下落由服务器端重力调度器负责
+                action_taken = tetris_lib.game_tick_api(game) # game_tick 推进游戏状态
+            # 读取更新后的游戏状态（只包含改动过的行）
+            # 已经连接了/api/stream的客户端由事件流统一推送棋盘帧（stream为true），
+            # 这里不再读取增量，否则两个通道会各自拿走一部分帧
+            view = read_game_view(game, board=not request.json.get('stream'))
+    if view is None:
+        return jsonify({"message": "游戏已结束。请开始新游戏。", "gameOver": True}), 400
+
+    result = format_game_view(view)
+    result["action"] = action
+    result["success"] = action_taken # 对于移动操作，指示移动是否有效
+    return jsonify(result)
+
+# 没有变化时发送保活注释的间隔（秒），防止代理断开空闲连接
+STREAM_KEEPALIVE_SECONDS = 15
+
+# API路由：服务器推送的游戏状态事件流（Server-Sent Events）
+@app.route('/api/stream', methods=['GET'])
+def stream_state():
+    """
+    以text/event-stream推送当前会话的游戏状态。
+    第一条消息是完整棋盘，之后每当棋盘、分数或结束状态变化时推送一条增量帧，
+    格式与/api/action的响应相同。自动下落由C++核心驱动，浏览器只需要监听这个流。
+    流不轮询：wait_session_change_api在C++核心里阻塞（cffi调用期间释放GIL），
+    直到重力调度器下落、/api/action排进按键或其他请求修改了游戏才醒来，空闲的连接不占用会话锁。
+    """
+    if tetris_lib is None:
+        return jsonify({"error": "Tetris 库未加载"}), 500
+    session_id = get_session_id_from_cookie()
+    if not session_id:
+        return jsonify({"error": "游戏未初始化。请调用 /api/start"}), 400
+
+    def events():
+        full = True # 连接（或浏览器自动重连）后先发送完整棋盘
+        last_score = None
+        last_game_over = None
+        last_sent = time.monotonic()
+        version = ffi.new("uint64_t*", 0) # 会话的变化序号，0表示第一次不等待
+        while True:
+            # 等到会话有变化（或者到了发送保活的时间）才短暂锁定会话，不在两次读取之间持有锁
+            game = tetris_lib.wait_session_change_api(session_id, version, STREAM_KEEPALIVE_SECONDS * 1000)
+            if game == ffi.NULL:
+                yield "event: expired\ndata: {}\n\n" # 会话已过期，客户端需要重新开始
+                return
+            try:
+                tetris_lib.drain_and_step_api(game, 0, 0, ffi.NULL) # 先执行/api/action排队的按键
+                view = read_game_view(game, full=full)
+            finally:
+                tetris_lib.release_session_api(session_id)
+
+            score = view["score"]
+            game_over = view["gameOver"]
+            if full or view["frame"][2] or score != last_score or game_over != last_game_over:
+                payload = format_game_view(view)
+                yield f"data: {json.dumps(payload, separators=(',', ':'))}\n\n"
+                full = False
+                last_score = score
+                last_game_over = game_over
+                last_sent = time.monotonic()
+            elif time.monotonic() - last_sent >= STREAM_KEEPALIVE_SECONDS:
+                yield ": keepalive\n\n"
+                last_sent = time.monotonic()
+
+    return Response(events(), mimetype='text/event-stream',
+                    headers={"Cache-Control": "no-cache", "X-Accel-Buffering": "no"})
+
+# 提示功能向后看的方块数（1-3）：越大越准，但耗时也越长
+HINT_DEPTH = 2
+
+# API路由：获取当前方块的最佳落点提示
+@app.route('/api/hint', methods=['GET'])
+def get_hint():
+    """
+    获取提示的API。
+    返回把当前方块放到最佳位置所需的旋转次数和目标x坐标；游戏结束时返回 {"hint": null}。
+    """
+    if tetris_lib is None:
+        return jsonify({"error": "Tetris 库未加载"}), 500
+
+    # 持有会话锁时只复制一份状态（一次memcpy），向后看的搜索在锁外、在副本上进行
+    state = ffi.cast("GameState*", ffi.new("char[]", tetris_lib.get_state_size_api()))
+    with locked_game() as game:
+        tetris_lib.clone_state_api(game, state)
+
+    rotations_ptr = ffi.new("int*")
+    x_ptr = ffi.new("int*")
+    if not tetris_lib.suggest_move_from_state_api(state, HINT_DEPTH, rotations_ptr, x_ptr):
+        return jsonify({"hint": None})
+    return jsonify({"hint": {"rotations": rotations_ptr[0], "x": x_ptr[0]}})
+
+# API路由：Prometheus格式的运行指标
+@app.route('/api/metrics', methods=['GET'])
+def get_metrics():
+    """
+    以Prometheus文本格式（text/plain; version=0.0.4）返回运行指标。
+    活跃会话数总是可用；核心函数的调用次数和CPU周期数只有在库以TETRIS_ENABLE_STATS编译时才有。
+    """
+    if tetris_lib is None:
+        return Response("# Tetris 库未加载\n", status=500, mimetype='text/plain')
+
+    lines = [
+        "# HELP tetris_sessions_active 当前活跃的游戏会话数",
+        "# TYPE tetris_sessions_active gauge",
+        f"tetris_sessions_active {tetris_lib.get_session_count_api()}",
+        "# HELP tetris_core_stats_enabled 核心库是否开启了插桩计数器",
+        "# TYPE tetris_core_stats_enabled gauge",
+        f"tetris_core_stats_enabled {1 if tetris_lib.stats_enabled_api() else 0}",
+    ]
+
+    count = tetris_lib.get_stat_count_api()
+    calls = ffi.new("uint64_t[]", count)
+    cycles = ffi.new("uint64_t[]", count)
+    written = tetris_lib.get_stats_api(calls, cycles, count)
+    if written > 0:
+        names = [ffi.string(tetris_lib.get_stat_name_api(i)).decode() for i in range(written)]
+        lines.append("# HELP tetris_core_calls_total 核心函数的调用次数")
+        lines.append("# TYPE tetris_core_calls_total counter")
+        lines.extend(f'tetris_core_calls_total{{function="{names[i]}"}} {calls[i]}' for i in range(written))
+        lines.append("# HELP tetris_core_cycles_total 核心函数累计消耗的CPU周期数")
+        lines.append("# TYPE tetris_core_cycles_total counter")
+        lines.extend(f'tetris_core_cycles_total{{function="{names[i]}"}} {cycles[i]}' for i in range(written))
+
+    return Response("\n".join(lines) + "\n", mimetype='text/plain; version=0.0.4')
 
 # 网站主页路由
 @app.route('/')
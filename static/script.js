@@ -10,25 +10,56 @@ document.addEventListener('DOMContentLoaded', () => {
     const scoreElement = document.getElementById('score');  // 显示分数的元素
     const startButton = document.getElementById('start-button'); // 开始游戏按钮
     const gameOverMessage = document.getElementById('game-over-message'); // 游戏结束消息
+    const nextCanvas = document.getElementById('next-pieces'); // 后续方块预览的Canvas元素
+    const nextContext = nextCanvas.getContext('2d');
 
     // 游戏棋盘的配置参数（必须与C++后端的值匹配）
     const BOARD_WIDTH_CELLS = 10;  // 棋盘宽度（格子数）
     const BOARD_HEIGHT_CELLS = 20; // 棋盘高度（格子数）
     const CELL_SIZE = 25;          // 每个格子的像素大小
 
+    // 后续方块预览：每个方块占4×3格（I形横放时宽4格），上下排列
+    const NEXT_CELL_SIZE = 16;     // 预览格子的像素大小
+    const NEXT_PREVIEW_COUNT = 3;  // 预览的方块数（与app.py一致）
+    // 各类型方块生成时的形状（SRS的0号旋转状态，与C++方块表一致），下标是方块类型（0-6）
+    const NEXT_SHAPES = [
+        [[0, 1], [1, 1], [2, 1], [3, 1]], // I
+        [[0, 0], [0, 1], [1, 1], [2, 1]], // J
+        [[2, 0], [0, 1], [1, 1], [2, 1]], // L
+        [[0, 0], [1, 0], [0, 1], [1, 1]], // O
+        [[1, 0], [2, 0], [0, 1], [1, 1]], // S
+        [[1, 0], [0, 1], [1, 1], [2, 1]], // T
+        [[0, 0], [1, 0], [1, 1], [2, 1]]  // Z
+    ];
+
     // 设置Canvas的尺寸
     canvas.width = BOARD_WIDTH_CELLS * CELL_SIZE;
     canvas.height = BOARD_HEIGHT_CELLS * CELL_SIZE;
+    nextCanvas.width = 4 * NEXT_CELL_SIZE;
+    nextCanvas.height = NEXT_PREVIEW_COUNT * 3 * NEXT_CELL_SIZE;
 
     // 游戏状态变量
     let gameBoard = [];             // 存储从后端获取的棋盘状态
+    let ghostCells = null;          // 落点预览：当前方块硬降后占据的格子[[x, y], ...]，没有时为null
+    let nextPieces = [];            // 后续方块的类型（0-6），按出现顺序
+    let frameSeq = -1;              // 已应用的最新棋盘帧序号（-1表示还没有完整棋盘）
+    let resyncPending = false;      // 是否正在请求完整棋盘以重新同步
     let score = 0;                  // 当前游戏分数
     let gameOver = false;           // 游戏是否结束的标志
-    let gameLoopInterval = null;    // 游戏主循环的计时器ID
+    let stateStream = null;         // 服务器推送游戏状态的EventSource（/api/stream）
+    let gameLoopInterval = null;    // 浏览器不支持EventSource时，退回前端计时下落的计时器ID
     let softDropInterval = null;    // 软下落（按住S键）的计时器ID
-    const GAME_TICK_MS = 500;       // 游戏自动下落的间隔时间（毫秒）
+    const FALLBACK_TICK_MS = 500;   // 退回前端计时下落时的间隔时间（毫秒）
     const SOFT_DROP_MS = 60;        // 按住S键加速下落的间隔时间（毫秒）
 
+    // 传输方式：Flask提供页面时为'http'；原生服务器tetris_server提供页面时被改写为'websocket'
+    const TRANSPORT = document.body.dataset.transport || 'http';
+    let socket = null;              // WebSocket传输下与tetris_server的连接
+    // WebSocket指令编码（与tetris_server.cpp中的二进制协议一致）
+    const WS_ACTIONS = { left: 1, right: 2, rotate: 3, drop: 4, tick: 5 };
+    const WS_CMD_START = 0x80;      // 开始新游戏
+    const WS_CMD_SYNC = 0x81;       // 请求完整棋盘
+
     // 方块颜色定义（优化了颜色以避免过浅的颜色）
     // 索引对应棋盘上的值：0为空白，1-7为不同的方块颜色
     const pieceColors = [
@@ -41,6 +72,7 @@ document.addEventListener('DOMContentLoaded', () => {
         '#9C27B0', // 6: T形方块（紫色）
         '#F44336'  // 7: Z形方块（红色）
     ];
+    const GHOST_COLOR = '#E0E0E0'; // 落点预览（虚影）的颜色（浅灰色）
 
     /**
      * 绘制游戏棋盘
@@ -77,6 +109,89 @@ document.addEventListener('DOMContentLoaded', () => {
                 context.strokeRect(c * CELL_SIZE, r * CELL_SIZE, CELL_SIZE, CELL_SIZE);
             }
         }
+
+        // 绘制落点预览（虚影）：只画在空格上，与方块本身重叠的部分不画
+        if (ghostCells && !gameOver) {
+            context.fillStyle = GHOST_COLOR;
+            for (const [c, r] of ghostCells) {
+                if (gameBoard[r] && gameBoard[r][c] === 0) {
+                    context.fillRect(c * CELL_SIZE, r * CELL_SIZE, CELL_SIZE, CELL_SIZE);
+                    context.strokeRect(c * CELL_SIZE, r * CELL_SIZE, CELL_SIZE, CELL_SIZE);
+                }
+            }
+        }
+    }
+
+    /**
+     * 绘制后续方块预览
+     * 每个方块画在自己的4×3格区域里，颜色与棋盘上的同类方块一致（颜色值是类型+1）
+     */
+    function drawNextPieces() {
+        nextContext.fillStyle = pieceColors[0];
+        nextContext.fillRect(0, 0, nextCanvas.width, nextCanvas.height);
+        if (gameOver) return;
+        nextContext.strokeStyle = '#444';
+        nextPieces.forEach((type, i) => {
+            const shape = NEXT_SHAPES[type];
+            if (!shape) return;
+            nextContext.fillStyle = pieceColors[type + 1];
+            for (const [c, r] of shape) {
+                const x = c * NEXT_CELL_SIZE;
+                const y = (i * 3 + r) * NEXT_CELL_SIZE;
+                nextContext.fillRect(x, y, NEXT_CELL_SIZE, NEXT_CELL_SIZE);
+                nextContext.strokeRect(x, y, NEXT_CELL_SIZE, NEXT_CELL_SIZE);
+            }
+        });
+    }
+
+    /**
+     * 把一帧棋盘数据应用到gameBoard
+     * 后端只发送改动过的行：每行是[行号, "0120000000"]，每个字符是一个格子的颜色值
+     * @param {Object} frame - {seq: 帧序号, full: 是否完整棋盘, rows: [[行号, 行字符串], ...]}
+     */
+    function applyBoardFrame(frame) {
+        if (frame.full) {
+            // 完整棋盘（关键帧）：直接替换，作为之后增量的基准
+            gameBoard = [];
+            for (let r = 0; r < BOARD_HEIGHT_CELLS; r++) {
+                gameBoard.push(new Array(BOARD_WIDTH_CELLS).fill(0));
+            }
+        } else if (frame.seq <= frameSeq) {
+            return; // 没有改动，或是乱序到达的旧帧，忽略
+        } else if (frameSeq < 0 || frame.seq !== frameSeq + 1) {
+            // 漏掉了中间的帧，增量无法正确应用，请求完整棋盘重新同步
+            resyncBoard();
+            return;
+        }
+        for (const [r, cells] of frame.rows) {
+            const row = gameBoard[r];
+            for (let c = 0; c < BOARD_WIDTH_CELLS; c++) {
+                row[c] = cells.charCodeAt(c) - 48; // '0'的字符编码是48
+            }
+        }
+        frameSeq = frame.seq;
+    }
+
+    /**
+     * 从后端获取完整棋盘，用于增量帧丢失后的重新同步
+     */
+    async function resyncBoard() {
+        if (TRANSPORT === 'websocket') {
+            sendSocketCommand(WS_CMD_SYNC); // 服务器随后推送一个完整棋盘帧
+            return;
+        }
+        if (resyncPending) return;
+        resyncPending = true;
+        try {
+            const response = await fetch('/api/state');
+            if (response.ok) {
+                updateGameState(await response.json());
+            }
+        } catch (error) {
+            console.error('Error resyncing board:', error);
+        } finally {
+            resyncPending = false;
+        }
     }
 
     /**
@@ -85,8 +200,16 @@ document.addEventListener('DOMContentLoaded', () => {
      */
     async function updateGameState(data) {
         // 更新棋盘数据
-        if (data.board) {
-            gameBoard = data.board;
+        if (data.frame) {
+            applyBoardFrame(data.frame);
+        }
+        // 更新落点预览（只有HTTP传输的响应带有ghost字段）
+        if (data.ghost !== undefined) {
+            ghostCells = data.ghost;
+        }
+        // 更新后续方块预览（同样只有HTTP传输的响应带有next字段）
+        if (data.next !== undefined) {
+            nextPieces = data.next;
         }
         // 更新分数
         if (data.score !== undefined) {
@@ -100,18 +223,16 @@ document.addEventListener('DOMContentLoaded', () => {
                 // 如果游戏结束，显示游戏结束消息
                 gameOverMessage.style.display = 'block';
                 startButton.textContent = '重新开始';
-                // 清除所有游戏计时器
-                if (gameLoopInterval) clearInterval(gameLoopInterval);
-                if (softDropInterval) clearInterval(softDropInterval);
-                gameLoopInterval = null;
-                softDropInterval = null;
+                // 清除所有游戏计时器并关闭状态推送
+                stopTimers();
             } else {
                 // 如果游戏未结束，隐藏游戏结束消息
                 gameOverMessage.style.display = 'none';
             }
         }
-        // 重绘棋盘
+        // 重绘棋盘和预览
         drawBoard();
+        drawNextPieces();
     }
 
     /**
@@ -122,12 +243,16 @@ document.addEventListener('DOMContentLoaded', () => {
     async function sendAction(action) {
         // 如果游戏已结束且动作不是开始/重启，则不执行任何操作
         if (gameOver && action !== 'start' && action !== 'restart') return false;
+        if (TRANSPORT === 'websocket') {
+            return sendSocketCommand(WS_ACTIONS[action]); // 棋盘变化由服务器推送
+        }
         try {
             // 发送POST请求到后端API
             const response = await fetch('/api/action', {
                 method: 'POST',
                 headers: { 'Content-Type': 'application/json' },
-                body: JSON.stringify({ action: action }),
+                // 连接了状态推送时，棋盘由推送流送达，动作响应里不再带棋盘帧
+                body: JSON.stringify({ action: action, stream: stateStream !== null }),
             });
             
             // 如果请求失败
@@ -136,7 +261,7 @@ document.addEventListener('DOMContentLoaded', () => {
                 console.error('Action failed:', errorData.error || response.statusText);
                 // 如果游戏已结束，更新游戏状态
                 if (errorData.gameOver) {
-                    updateGameState({ gameOver: true, score: errorData.score, board: errorData.board });
+                    updateGameState({ gameOver: true, score: errorData.score });
                 }
                 return false; // 动作失败
             }
@@ -153,15 +278,117 @@ document.addEventListener('DOMContentLoaded', () => {
     }
 
     /**
-     * 开始新游戏
-     * 向后端API发送请求，重置游戏状态
+     * 清除所有游戏计时器并关闭状态推送
      */
-    async function startGame() {
-        // 清除所有游戏计时器
+    function stopTimers() {
+        if (stateStream) stateStream.close();
         if (gameLoopInterval) clearInterval(gameLoopInterval);
         if (softDropInterval) clearInterval(softDropInterval);
+        stateStream = null;
         gameLoopInterval = null;
         softDropInterval = null;
+    }
+
+    /**
+     * 订阅服务器推送的游戏状态
+     * 方块的自动下落由服务器端的重力调度器完成，下落后的棋盘通过/api/stream推送过来；
+     * 浏览器不支持EventSource时退回旧的方式：前端定时发送'tick'动作
+     */
+    function subscribeState() {
+        if (!window.EventSource) {
+            gameLoopInterval = setInterval(() => {
+                if (!gameOver) sendAction('tick');
+            }, FALLBACK_TICK_MS);
+            return;
+        }
+        const stream = new EventSource('/api/stream');
+        stream.onmessage = (event) => {
+            updateGameState(JSON.parse(event.data));
+        };
+        // 会话已过期：关闭推送，提示重新开始
+        stream.addEventListener('expired', () => {
+            stopTimers();
+            updateGameState({ gameOver: true });
+        });
+        stateStream = stream;
+    }
+
+    /**
+     * 通过WebSocket发送一条单字节指令
+     * @param {number} command - 指令编码（动作1-5或WS_CMD_*）
+     * @returns {boolean} - 是否已发送
+     */
+    function sendSocketCommand(command) {
+        if (command === undefined || !socket || socket.readyState !== WebSocket.OPEN) return false;
+        socket.send(Uint8Array.of(command));
+        return true;
+    }
+
+    /**
+     * 把tetris_server推送的二进制棋盘帧解码成与HTTP接口相同的格式
+     * 帧格式：类型(1) 标志(1) 帧序号(4) 分数(4) 等级(1) 行数(1)，之后每行是行号(1)+每格颜色值(1)
+     * @param {ArrayBuffer} buffer - 收到的二进制消息
+     * @returns {Object|null} - {frame, score, gameOver}，不认识的消息返回null
+     */
+    function decodeSocketFrame(buffer) {
+        const bytes = new Uint8Array(buffer);
+        if (bytes.length < 12 || bytes[0] !== 1) return null;
+        const view = new DataView(buffer);
+        const rows = [];
+        let offset = 12;
+        for (let i = 0; i < bytes[11]; i++) {
+            let cells = '';
+            for (let c = 0; c < BOARD_WIDTH_CELLS; c++) {
+                cells += String.fromCharCode(48 + bytes[offset + 1 + c]); // 转成与HTTP接口相同的行字符串
+            }
+            rows.push([bytes[offset], cells]);
+            offset += 1 + BOARD_WIDTH_CELLS;
+        }
+        return {
+            frame: { seq: view.getUint32(2, true), full: (bytes[1] & 1) !== 0, rows: rows },
+            score: view.getInt32(6, true),
+            gameOver: (bytes[1] & 2) !== 0
+        };
+    }
+
+    /**
+     * WebSocket传输下开始新游戏：连接已打开时直接发送开始指令，否则先建立连接
+     * 自动下落由服务器驱动，棋盘帧通过同一个连接推送过来
+     */
+    function startSocketGame() {
+        if (socket && socket.readyState === WebSocket.OPEN) {
+            sendSocketCommand(WS_CMD_START);
+            startButton.textContent = '游戏中...';
+            return;
+        }
+        if (socket) socket.close(); // 还在连接中的旧连接
+        const ws = new WebSocket((location.protocol === 'https:' ? 'wss://' : 'ws://') + location.host + '/ws');
+        ws.binaryType = 'arraybuffer';
+        ws.onopen = () => {
+            sendSocketCommand(WS_CMD_START);
+            startButton.textContent = '游戏中...';
+        };
+        ws.onmessage = (event) => {
+            const data = decodeSocketFrame(event.data);
+            if (data) updateGameState(data);
+        };
+        ws.onclose = () => {
+            if (socket === ws) socket = null;
+        };
+        socket = ws;
+    }
+
+    /**
+     * 开始新游戏
+     * 向后端API发送请求，重置游戏状态
+     */
+    async function startGame() {
+        // 清除所有游戏计时器并关闭旧的状态推送
+        stopTimers();
+        if (TRANSPORT === 'websocket') {
+            startSocketGame();
+            return;
+        }
 
         try {
             // 调用后端开始新游戏的API
@@ -177,12 +404,9 @@ document.addEventListener('DOMContentLoaded', () => {
             updateGameState(data);
             startButton.textContent = '游戏中...';
             
-            // 如果游戏未结束，启动游戏循环
+            // 如果游戏未结束，订阅服务器推送的状态（自动下落由服务器驱动）
             if (!gameOver) {
-                // 设置游戏主循环，定期调用game_tick
-                gameLoopInterval = setInterval(() => {
-                    if (!gameOver) sendAction('tick');
-                }, GAME_TICK_MS);
+                subscribeState();
             }
         } catch (error) {
             console.error('Error starting game:', error);
@@ -267,8 +491,9 @@ document.addEventListener('DOMContentLoaded', () => {
     // 为开始游戏按钮添加点击事件
     startButton.addEventListener('click', startGame);
 
-    // 初始绘制一个空的棋盘
+    // 初始绘制一个空的棋盘和空的预览
     drawBoard(); 
+    drawNextPieces();
 });
 
 /**
@@ -278,10 +503,10 @@ document.addEventListener('DOMContentLoaded', () => {
  * 
  * 点击开始按钮:
  * 触发startgame函数；
- * 清除所有计时器；
+ * 清除所有计时器，关闭旧的状态推送；
  * 向后端发送/api/start请求，获取初始棋盘和分数；
  * 更新游戏状态；
- * 如果游戏未结束，启动主循环（每500ms自动下落一次，调用sendAction('tick')）。
+ * 如果游戏未结束，用EventSource订阅/api/stream（不支持时退回每500ms调用sendAction('tick')）。
  * 按键操作：
  * 监听keydown事件
  * 判断按键类型，决定动作（左/右/旋转/硬降/软降/重启）。
@@ -290,12 +515,18 @@ document.addEventListener('DOMContentLoaded', () => {
  * Q键可以随时重启游戏（调用startGame()）
  * 监听keyup事件：松开S键时，停止软降计时器。
  * 
- * 游戏主循环：
- * 如果游戏在进行中，主循环每500ms自动调用sendAction('tick')，让方块自动下落。
+ * 自动下落：
+ * 由服务器端的重力调度器按等级对应的速度推动方块下落，前端不再定时发请求；
+ * 棋盘、分数和结束状态的变化通过/api/stream推送过来，交给updateGameState()。
+ * 
+ * 传输方式：
+ * 由原生服务器tetris_server提供页面时，body的data-transport为websocket：
+ * 开局和按键都以单字节指令通过/ws发送，棋盘帧以二进制格式推送回来，解码后同样交给updateGameState()。
  * 
  * 交互：
- * 每次有动作（包括自动下落、用户操作），都通过sendAction()向后端发送请求。
- * 后端返回最新的棋盘、分数、游戏是否结束等信息。
+ * 用户操作通过sendAction()向后端发送请求（带stream标志时响应里不含棋盘，棋盘由推送流送达）。
+ * 后端返回改动过的棋盘行（带帧序号）、分数、游戏是否结束等信息；
+ * 帧序号不连续时前端会请求/api/state获取完整棋盘重新同步。
  * 前端用updateGameState()更新状态和界面。
  * 
  * 如果后端返回gameOver为true，前端会：
@@ -0,0 +1,127 @@
+// tetris_batch.cpp
+// 批量游戏环境的实现
+#include "tetris_batch.h"
+#include "tetris_stats.h"  // 插桩计数器（未开启时为空）
+
+// 构造函数：创建并开始所有游戏
+TetrisBatch::TetrisBatch(int game_count) : games_(game_count > 0 ? game_count : 0) {
+    reset_all();
+}
+
+// 构造函数：为每局游戏派生种子后开始
+// 之后自动重开时，新一局的种子从该局自己的随机数生成器派生，仍然是确定的
+TetrisBatch::TetrisBatch(int game_count, uint64_t seed) : games_(game_count > 0 ? game_count : 0) {
+    uint64_t x = seed;
+    for (size_t i = 0; i < games_.size(); ++i) {
+        games_[i].start_new_game_seeded(TetrisRng::splitmix64(x));
+    }
+}
+
+// 获取游戏局数
+int TetrisBatch::size() const {
+    return static_cast<int>(games_.size());
+}
+
+// 访问第index局游戏
+TetrisGame& TetrisBatch::game(int index) {
+    return games_[index];
+}
+
+const TetrisGame& TetrisBatch::game(int index) const {
+    return games_[index];
+}
+
+// 重新开始全部游戏
+void TetrisBatch::reset_all() {
+    for (size_t i = 0; i < games_.size(); ++i) {
+        games_[i].start_new_game();
+    }
+}
+
+// 推进所有游戏一步
+void TetrisBatch::step(const uint8_t* actions, bool auto_reset) {
+    for (size_t i = 0; i < games_.size(); ++i) {
+        TetrisGame& game = games_[i];
+        if (game.is_game_over()) {
+            if (!auto_reset) continue; // 已结束且不自动重开：保持最终状态
+            game.start_new_game();     // 自动重开后本步动作作用于新的一局
+        }
+        game.apply_action(actions[i]);
+    }
+}
+
+// 写出所有棋盘：颜色值只有0-7，按字节输出以减少调用方需要搬运的数据量
+void TetrisBatch::write_boards(uint8_t* out_boards) const {
+    const int cells = BOARD_HEIGHT * BOARD_WIDTH;
+    for (size_t i = 0; i < games_.size(); ++i) {
+        games_[i].write_board(out_boards + i * cells); // 直接合成为字节，不经过int棋盘
+    }
+}
+
+// 写出所有分数
+void TetrisBatch::write_scores(int32_t* out_scores) const {
+    for (size_t i = 0; i < games_.size(); ++i) {
+        out_scores[i] = games_[i].get_score();
+    }
+}
+
+// 写出所有结束标志
+void TetrisBatch::write_game_over(uint8_t* out_game_over) const {
+    for (size_t i = 0; i < games_.size(); ++i) {
+        out_game_over[i] = games_[i].is_game_over() ? 1 : 0;
+    }
+}
+
+//------------------------------------------------------------------------------
+// C语言风格的批量API函数实现
+//------------------------------------------------------------------------------
+
+// 创建批量环境
+API_EXPORT TetrisBatch* create_batch(int game_count) {
+    return new TetrisBatch(game_count);
+}
+
+// 创建可复现的批量环境
+API_EXPORT TetrisBatch* create_batch_seeded(int game_count, uint64_t seed) {
+    return new TetrisBatch(game_count, seed);
+}
+
+// 销毁批量环境
+API_EXPORT void destroy_batch(TetrisBatch* batch) {
+    delete batch;
+}
+
+// 获取游戏局数
+API_EXPORT int get_batch_size_api(TetrisBatch* batch) {
+    return batch ? batch->size() : 0;
+}
+
+// 重新开始全部游戏
+API_EXPORT void batch_reset_api(TetrisBatch* batch) {
+    if (batch) batch->reset_all();
+}
+
+// 重新开始第index局游戏
+API_EXPORT void batch_reset_game_api(TetrisBatch* batch, int index) {
+    if (batch && index >= 0 && index < batch->size()) {
+        batch->game(index).start_new_game();
+    }
+}
+
+// 推进所有游戏一步并输出结果
+API_EXPORT void batch_step_api(TetrisBatch* batch, const uint8_t* actions, bool auto_reset,
+                               uint8_t* out_boards, int32_t* out_scores, uint8_t* out_game_over) {
+    TETRIS_STAT_SCOPE(STAT_API_BATCH_STEP);
+    if (!batch) return;
+    if (actions) batch->step(actions, auto_reset); // 没有动作数组时只输出结果
+    batch_observe_api(batch, out_boards, out_scores, out_game_over);
+}
+
+// 只读取当前结果
+API_EXPORT void batch_observe_api(TetrisBatch* batch,
+                                  uint8_t* out_boards, int32_t* out_scores, uint8_t* out_game_over) {
+    if (!batch) return;
+    if (out_boards) batch->write_boards(out_boards);
+    if (out_scores) batch->write_scores(out_scores);
+    if (out_game_over) batch->write_game_over(out_game_over);
+}
@@ -0,0 +1,77 @@
+// tetris_batch.h
+// 批量游戏环境：一次调用推进成千上万局游戏
+// 训练和压测场景中，逐局调用C API的FFI开销远大于游戏逻辑本身，
+// 这里把所有游戏放在一个容器里，动作和结果都通过调用方提供的连续缓冲区传递
+#ifndef TETRIS_BATCH_H // 防止头文件被重复包含的保护宏
+#define TETRIS_BATCH_H
+
+#include "tetris_game.h"
+#include <vector>   // 连续存储所有游戏实例
+#include <cstdint>  // 固定宽度整数类型，用于缓冲区布局
+
+// 批量游戏容器
+// 所有游戏实例连续存放；step一次按动作数组推进全部游戏
+class TetrisBatch {
+public:
+    // 构造函数：创建game_count局游戏并全部开始
+    explicit TetrisBatch(int game_count);
+
+    // 构造函数：用seed为每局游戏派生不同的开局种子，整个批次的运行过程可以复现
+    TetrisBatch(int game_count, uint64_t seed);
+
+    // 获取游戏局数
+    int size() const;
+
+    // 访问第index局游戏
+    TetrisGame& game(int index);
+    const TetrisGame& game(int index) const;
+
+    // 重新开始全部游戏
+    void reset_all();
+
+    // 推进所有游戏一步
+    // actions: 长度为size()的动作数组，第i个元素作用于第i局（编码见TetrisAction）
+    // auto_reset: 为true时，已结束的游戏会在本步开始前自动重新开始
+    void step(const uint8_t* actions, bool auto_reset);
+
+    // 将结果按结构数组（SoA）布局写入调用方的缓冲区
+    // out_boards: size() * BOARD_HEIGHT * BOARD_WIDTH 字节，每局一个按行优先存储的棋盘
+    // out_scores: size() 个int32_t
+    // out_game_over: size() 个字节，1表示该局已结束
+    void write_boards(uint8_t* out_boards) const;
+    void write_scores(int32_t* out_scores) const;
+    void write_game_over(uint8_t* out_game_over) const;
+
+private:
+    std::vector<TetrisGame> games_; // 所有游戏实例（连续存储）
+};
+
+// 定义C风格的批量API接口
+// 所有输出缓冲区都是可选的，传入NULL表示不需要该项结果
+extern "C" {
+    // 创建包含game_count局游戏的批量环境，所有游戏已开始
+    API_EXPORT TetrisBatch* create_batch(int game_count);
+
+    // 创建可复现的批量环境：第i局游戏的种子由seed和i派生
+    API_EXPORT TetrisBatch* create_batch_seeded(int game_count, uint64_t seed);
+
+    // 销毁批量环境
+    API_EXPORT void destroy_batch(TetrisBatch* batch);
+
+    // 获取批量环境中的游戏局数
+    API_EXPORT int get_batch_size_api(TetrisBatch* batch);
+
+    // 重新开始全部游戏 / 重新开始第index局游戏
+    API_EXPORT void batch_reset_api(TetrisBatch* batch);
+    API_EXPORT void batch_reset_game_api(TetrisBatch* batch, int index);
+
+    // 推进所有游戏一步，并把棋盘、分数、结束标志写入调用方提供的缓冲区
+    API_EXPORT void batch_step_api(TetrisBatch* batch, const uint8_t* actions, bool auto_reset,
+                                   uint8_t* out_boards, int32_t* out_scores, uint8_t* out_game_over);
+
+    // 不推进游戏，只读取当前结果
+    API_EXPORT void batch_observe_api(TetrisBatch* batch,
+                                      uint8_t* out_boards, int32_t* out_scores, uint8_t* out_game_over);
+}
+
+#endif // TETRIS_BATCH_H
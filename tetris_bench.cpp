@@ -0,0 +1,679 @@
+// tetris_bench.cpp
+// 核心库的性能基准测试（tetris_bench可执行文件）
+// 风格参照Google Benchmark：每个基准函数先做准备工作，再在计时循环中重复执行被测操作；
+// 迭代次数按上一轮的速度自动估算，直到一次运行的耗时超过最短运行时间。
+// 所有随机数据都使用固定种子，不同版本之间的结果可以直接比较。
+//
+// 用法：tetris_bench [--json] [--out=文件] [--filter=子串] [--min-time=秒]
+//   --json        以JSON格式输出（默认输出便于阅读的表格）
+//   --out=文件    把结果写入文件而不是标准输出
+//   --filter=子串 只运行名称包含该子串的基准
+//   --min-time=秒 每个基准的最短运行时间（默认0.5秒）
+#include "tetris_game.h"
+#include "tetris_solver.h"
+#include "tetris_pool.h"
+#include "tetris_savestate.h"
+#include <algorithm> // std::min, std::max
+#include <atomic>    // 分配计数器
+#include <chrono>    // 计时
+#include <cstdio>    // 输出
+#include <cstdlib>   // malloc/free, atof
+#include <ctime>     // 结果中的日期
+#include <new>       // std::bad_alloc
+#include <string>
+#include <thread>    // hardware_concurrency
+#include <vector>
+
+//------------------------------------------------------------------------------
+// 分配计数：替换全局operator new/delete，统计被测代码每次操作的堆分配次数
+//------------------------------------------------------------------------------
+
+static std::atomic<uint64_t> g_allocations(0);
+
+void* operator new(size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void* operator new[](size_t size) {
+    g_allocations.fetch_add(1, std::memory_order_relaxed);
+    void* p = malloc(size ? size : 1);
+    if (!p) throw std::bad_alloc();
+    return p;
+}
+
+void operator delete(void* p) noexcept { free(p); }
+void operator delete[](void* p) noexcept { free(p); }
+void operator delete(void* p, size_t) noexcept { free(p); }
+void operator delete[](void* p, size_t) noexcept { free(p); }
+
+// 防止编译器把被测操作的结果优化掉
+template <typename T>
+static inline void do_not_optimize(const T& value) {
+#if defined(__GNUC__) || defined(__clang__)
+    asm volatile("" : : "r,m"(value) : "memory");
+#else
+    static volatile const T* sink;
+    sink = &value;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// 基准框架
+//------------------------------------------------------------------------------
+
+typedef std::chrono::steady_clock BenchClock;
+
+// 一次运行的状态：基准函数读取iterations，做完准备工作后调用start_timing()
+class BenchState {
+public:
+    explicit BenchState(uint64_t iterations)
+        : iterations(iterations), items_processed(0),
+          start_(BenchClock::now()), start_allocations_(g_allocations.load()) {}
+
+    // 准备工作结束，开始计时（不调用则从基准函数开始执行时计时）
+    void start_timing() {
+        start_allocations_ = g_allocations.load();
+        start_ = BenchClock::now();
+    }
+
+    // 计时结束（由框架在基准函数返回后调用）
+    void stop_timing() {
+        elapsed_ns_ = std::chrono::duration<double, std::nano>(BenchClock::now() - start_).count();
+        allocations_ = g_allocations.load() - start_allocations_;
+    }
+
+    double elapsed_ns() const { return elapsed_ns_; }
+    uint64_t allocations() const { return allocations_; }
+
+    const uint64_t iterations; // 需要执行的操作次数
+    uint64_t items_processed;  // 处理的“项目”数（例如动作数），用于计算每秒吞吐量；0表示与操作次数相同
+
+private:
+    BenchClock::time_point start_;
+    uint64_t start_allocations_;
+    double elapsed_ns_ = 0;
+    uint64_t allocations_ = 0;
+};
+
+// 一个基准的结果
+struct BenchResult {
+    std::string name;
+    uint64_t iterations;
+    double ns_per_op;
+    double items_per_second;
+    double allocs_per_op;
+    const char* item_label; // 吞吐量的单位，例如"moves"
+};
+
+// 基准测试程序：作为TetrisGame的友元，可以直接调用内部函数
+class TetrisBench {
+public:
+    typedef void (*BenchFunction)(BenchState&);
+
+    struct Benchmark {
+        const char* name;
+        BenchFunction function;
+        const char* item_label;
+    };
+
+    // 注册的全部基准
+    static std::vector<Benchmark> all();
+
+    // 自动确定迭代次数并运行一个基准
+    static BenchResult run(const Benchmark& benchmark, double min_time_seconds);
+
+private:
+    static void bm_check_collision(BenchState& state);
+    static void bm_clear_full_lines_0(BenchState& state);
+    static void bm_clear_full_lines_1(BenchState& state);
+    static void bm_clear_full_lines_4(BenchState& state);
+    static void bm_restore_state(BenchState& state);
+    static void bm_game_tick(BenchState& state);
+    static void bm_drop_piece(BenchState& state);
+    static void bm_move_blocked(BenchState& state);
+    static void bm_rotate_wall(BenchState& state);
+    static void bm_move_get_board(BenchState& state);
+    static void bm_input_queue(BenchState& state);
+    static void bm_piece_queue(BenchState& state);
+    static void bm_random_game(BenchState& state);
+    template <int Width, int Height>
+    static void bm_random_game_sized(BenchState& state);
+    static void bm_construct(BenchState& state);
+    static void bm_create_destroy_api(BenchState& state);
+    static void bm_create_reset(BenchState& state);
+    static void bm_solver_suggest(BenchState& state);
+    static void bm_pool_count_alive(BenchState& state);
+    static void bm_pool_top_scores(BenchState& state);
+    static void bm_pool_score_histogram(BenchState& state);
+    static void bm_save_encode(BenchState& state);
+    static void bm_save_decode(BenchState& state);
+
+    // 批量查询基准共用的游戏池：LEADERBOARD_GAMES局游戏，分数随机，一部分已结束
+    static const TetrisPool& leaderboard_pool();
+    static const int LEADERBOARD_GAMES = 100000;
+
+    // 消行基准的公共部分
+    static void clear_lines_loop(BenchState& state, const GameState& prepared);
+
+    // 准备一个有num_full_lines个满行（在底部）、其余行半满的局面
+    static GameState make_clear_state(int num_full_lines);
+
+    // 用固定种子随机玩actions步，得到一个中盘局面（游戏结束时重新开局）
+    static GameState make_midgame_state(uint64_t seed, int actions);
+
+    // 固定种子的随机动作（不含ACTION_NONE）
+    static int random_action(TetrisRng& rng) {
+        return ACTION_LEFT + static_cast<int>(rng.next_below(ACTION_COUNT - ACTION_LEFT));
+    }
+};
+
+GameState TetrisBench::make_midgame_state(uint64_t seed, int actions) {
+    TetrisGame game(seed);
+    game.start_new_game_seeded(seed);
+    TetrisRng rng;
+    rng.seed(seed);
+    for (int i = 0; i < actions; ++i) {
+        if (game.is_game_over()) game.start_new_game_seeded(rng.next64());
+        // 多数是左右移动和节拍，少量硬降，让棋盘有一定高度
+        int action = random_action(rng);
+        game.apply_action(action == ACTION_DROP && rng.next_below(4) != 0 ? ACTION_TICK : action);
+    }
+    return game.get_state();
+}
+
+GameState TetrisBench::make_clear_state(int num_full_lines) {
+    TetrisGame game(1);
+    game.start_new_game_seeded(1);
+    GameState state = game.get_state();
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        bool full = y >= BOARD_HEIGHT - num_full_lines;
+        bool half = y >= BOARD_HEIGHT - 8; // 满行之上还有若干半满的行，消行时需要整体下移
+        state.rows[y] = 0;
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            bool filled = full || (half && (x + y) % 2 == 0);
+            state.board[y][x] = filled ? 1 : 0;
+            if (filled) state.rows[y] |= static_cast<RowMask>(1u << x);
+        }
+    }
+    return state;
+}
+
+// 碰撞检测：在中盘局面上轮流检测一组固定的（类型, 旋转, 位置）
+void TetrisBench::bm_check_collision(BenchState& state) {
+    TetrisGame game(0);
+    game.restore_state(make_midgame_state(42, 400));
+    struct Probe { Point pos; int type; int rotation; };
+    std::vector<Probe> probes(256);
+    TetrisRng rng;
+    rng.seed(7);
+    for (size_t i = 0; i < probes.size(); ++i) {
+        probes[i].pos.x = static_cast<int>(rng.next_below(BOARD_WIDTH + 2)) - 1;
+        probes[i].pos.y = static_cast<int>(rng.next_below(BOARD_HEIGHT));
+        probes[i].type = static_cast<int>(rng.next_below(PieceTable::PIECE_TYPES));
+        probes[i].rotation = static_cast<int>(rng.next_below(PieceTable::ROTATIONS));
+    }
+    state.start_timing();
+    int collisions = 0;
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        const Probe& probe = probes[i & 255];
+        collisions += game.check_collision(probe.pos, probe.type, probe.rotation);
+    }
+    do_not_optimize(collisions);
+}
+
+// 消行：每次操作先恢复局面（包含在计时内，单独的开销见restore_state基准）
+void TetrisBench::clear_lines_loop(BenchState& state, const GameState& prepared) {
+    TetrisGame game(0);
+    state.start_timing();
+    uint32_t cleared = 0;
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        game.restore_state(prepared);
+        cleared ^= game.clear_full_lines();
+    }
+    do_not_optimize(cleared);
+}
+
+void TetrisBench::bm_clear_full_lines_0(BenchState& state) {
+    clear_lines_loop(state, make_clear_state(0));
+}
+
+void TetrisBench::bm_clear_full_lines_1(BenchState& state) {
+    clear_lines_loop(state, make_clear_state(1));
+}
+
+void TetrisBench::bm_clear_full_lines_4(BenchState& state) {
+    clear_lines_loop(state, make_clear_state(4));
+}
+
+// 恢复状态快照（上面几个基准的固定开销）
+void TetrisBench::bm_restore_state(BenchState& state) {
+    TetrisGame game(0);
+    GameState prepared = make_clear_state(4);
+    state.start_timing();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        game.restore_state(prepared);
+        do_not_optimize(game.get_state());
+    }
+}
+
+// 游戏节拍：每个节拍方块下落一格，落地时固定并生成下一个方块
+void TetrisBench::bm_game_tick(BenchState& state) {
+    TetrisGame game(1);
+    game.start_new_game_seeded(1);
+    uint64_t round = 1;
+    state.start_timing();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        if (!game.game_tick()) game.start_new_game_seeded(++round);
+    }
+    do_not_optimize(game.get_state());
+}
+
+// 硬降：落地、消行并生成下一个方块（游戏结束后用下一个固定种子重新开局，开局开销计入其中）
+void TetrisBench::bm_drop_piece(BenchState& state) {
+    TetrisGame game(1);
+    game.start_new_game_seeded(1);
+    uint64_t round = 1;
+    TetrisRng rng;
+    rng.seed(3);
+    state.start_timing();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        if (game.is_game_over()) game.start_new_game_seeded(++round);
+        // 让方块落在不同的列上，避免总是堆在同一位置
+        if (rng.next_below(2)) game.move_left(); else game.move_right();
+        game.drop_piece();
+    }
+    do_not_optimize(game.get_state());
+}
+
+// 被挡住的移动：方块已经靠在左墙上，每次向左移动都失败
+void TetrisBench::bm_move_blocked(BenchState& state) {
+    TetrisGame game(1);
+    game.start_new_game_seeded(1);
+    while (game.move_left()) {
+    }
+    state.start_timing();
+    int moved = 0;
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        moved += game.move_left();
+    }
+    do_not_optimize(moved);
+}
+
+// 靠墙连续旋转：原位置放不下时要依次尝试踢墙表中的偏移
+void TetrisBench::bm_rotate_wall(BenchState& state) {
+    TetrisGame game(1);
+    game.start_new_game_seeded(1);
+    while (game.move_left()) {
+    }
+    state.start_timing();
+    int rotated = 0;
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        rotated += game.rotate_piece();
+    }
+    do_not_optimize(rotated);
+}
+
+// 移动一格后读取整个棋盘（前端每次操作后的典型调用）
+void TetrisBench::bm_move_get_board(BenchState& state) {
+    TetrisGame game(1);
+    game.start_new_game_seeded(1);
+    game.move_left(); // 离开靠墙的位置，左右移动都能成功
+    state.start_timing();
+    int sum = 0;
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        if (i & 1) game.move_left(); else game.move_right();
+        sum += game.get_board()[BOARD_WIDTH + 4];
+    }
+    do_not_optimize(sum);
+}
+
+// 输入队列：一次入队加一次取出执行（单线程，不含线程间竞争）
+void TetrisBench::bm_input_queue(BenchState& state) {
+    TetrisGame game(1);
+    game.enable_input_queue();
+    game.start_new_game_seeded(1);
+    game.move_left();
+    state.start_timing();
+    int applied = 0;
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        game.enqueue_input((i & 1) ? ACTION_LEFT : ACTION_RIGHT, i);
+        applied += game.drain_inputs_and_step(0, 0, nullptr);
+    }
+    do_not_optimize(applied);
+}
+
+// 从预览队列取方块（7袋）：大部分调用只是读队首，每8个方块补满一次队列
+void TetrisBench::bm_piece_queue(BenchState& state) {
+    TetrisRng rng;
+    rng.seed(1);
+    PieceQueue queue;
+    queue.reset(RANDOMIZER_BAG7);
+    state.start_timing();
+    uint32_t sum = 0;
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        sum += queue.pop(rng, BOARD_WIDTH);
+    }
+    do_not_optimize(sum);
+}
+
+// 完整的随机对局：每次操作是一整局游戏，吞吐量按动作数统计
+void TetrisBench::bm_random_game(BenchState& state) {
+    TetrisGame game(1);
+    TetrisRng rng;
+    rng.seed(5);
+    uint64_t moves = 0;
+    state.start_timing();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        game.start_new_game_seeded(i + 1);
+        while (!game.is_game_over()) {
+            game.apply_action(random_action(rng));
+            ++moves;
+        }
+    }
+    state.items_processed = moves;
+    do_not_optimize(game.get_state());
+}
+
+// 其他尺寸棋盘上的完整随机对局（与random_game相同，只是换成对应尺寸的实例）
+// 小棋盘的每局更短，宽棋盘的行掩码是32位，高棋盘的脏行掩码是64位
+template <int Width, int Height>
+void TetrisBench::bm_random_game_sized(BenchState& state) {
+    BasicTetrisGame<Width, Height> game(1);
+    TetrisRng rng;
+    rng.seed(5);
+    uint64_t moves = 0;
+    state.start_timing();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        game.start_new_game_seeded(i + 1);
+        while (!game.is_game_over()) {
+            game.apply_action(random_action(rng));
+            ++moves;
+        }
+    }
+    state.items_processed = moves;
+    do_not_optimize(game.get_state());
+}
+
+// 构造和析构一个游戏实例
+void TetrisBench::bm_construct(BenchState& state) {
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        TetrisGame* game = new TetrisGame(i + 1);
+        do_not_optimize(game);
+        delete game;
+    }
+}
+
+// 通过C API创建、开局和销毁一个游戏实例
+void TetrisBench::bm_create_destroy_api(BenchState& state) {
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        TetrisGame* game = create_game_seeded(i + 1);
+        do_not_optimize(game);
+        destroy_game(game);
+    }
+}
+
+// 一局游戏的完整生命周期：从板块创建、开局、玩一个方块、再开一局、销毁
+// 实例来自共享上下文的板块，开局在原地重置，allocs/op应为0
+void TetrisBench::bm_create_reset(BenchState& state) {
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        TetrisGame* game = create_game_seeded(i + 1);
+        start_new_game_api(game);
+        drop_piece_api(game);
+        start_new_game_api(game);
+        do_not_optimize(game);
+        destroy_game(game);
+    }
+}
+
+// 求解器：只看当前方块时求一次最佳落点
+void TetrisBench::bm_solver_suggest(BenchState& state) {
+    TetrisGame game(0);
+    game.restore_state(make_midgame_state(42, 400));
+    TetrisSolver solver;
+    state.start_timing();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        SolverMove move = solver.suggest(game, 1);
+        do_not_optimize(move);
+    }
+}
+
+// 只构造一次：游戏池的准备工作比一次查询慢得多，不能在每轮迭代次数估算时重复
+const TetrisPool& TetrisBench::leaderboard_pool() {
+    static TetrisPool* pool = nullptr;
+    if (!pool) {
+        pool = new TetrisPool(LEADERBOARD_GAMES);
+        TetrisRng rng;
+        rng.seed(11);
+        for (int i = 0; i < LEADERBOARD_GAMES; ++i) {
+            int slot = pool->acquire(rng.next64());
+            GameState state = pool->game(slot).get_state();
+            state.score = static_cast<int>(rng.next_below(20000));
+            state.game_over = rng.next_below(10) == 0; // 约10%已结束
+            pool->game(slot).restore_state(state);
+            pool->sync(slot);
+        }
+    }
+    return *pool;
+}
+
+// 游戏池：统计进行中的游戏，吞吐量按扫描的游戏数统计
+void TetrisBench::bm_pool_count_alive(BenchState& state) {
+    const TetrisPool& pool = leaderboard_pool();
+    state.start_timing();
+    int alive = 0;
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        alive += pool.count_alive();
+        do_not_optimize(alive);
+    }
+    state.items_processed = state.iterations * LEADERBOARD_GAMES;
+}
+
+// 游戏池：排行榜前10名
+void TetrisBench::bm_pool_top_scores(BenchState& state) {
+    const TetrisPool& pool = leaderboard_pool();
+    int slots[10];
+    int32_t scores[10];
+    state.start_timing();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        pool.top_scores(10, slots, scores);
+        do_not_optimize(slots);
+    }
+    state.items_processed = state.iterations * LEADERBOARD_GAMES;
+}
+
+// 游戏池：分数直方图（64个桶，每桶500分）
+void TetrisBench::bm_pool_score_histogram(BenchState& state) {
+    const TetrisPool& pool = leaderboard_pool();
+    uint32_t counts[64];
+    state.start_timing();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        pool.score_histogram(500, 64, counts);
+        do_not_optimize(counts);
+    }
+    state.items_processed = state.iterations * LEADERBOARD_GAMES;
+}
+
+// 编码一条存档记录（中盘局面，检查点中每个会话的开销）
+void TetrisBench::bm_save_encode(BenchState& state) {
+    GameState prepared = make_midgame_state(7, 2000);
+    SaveRecord record;
+    state.start_timing();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        prepared.score = static_cast<int>(i); // 每次的输入都不同，编码不会被提到循环外
+        encode_save_record(prepared, &record);
+        do_not_optimize(record);
+    }
+}
+
+// 校验并解码一条存档记录（从检查点恢复时每个会话的开销）
+void TetrisBench::bm_save_decode(BenchState& state) {
+    SaveRecord record;
+    encode_save_record(make_midgame_state(7, 2000), &record);
+    GameState decoded;
+    int failures = 0;
+    state.start_timing();
+    for (uint64_t i = 0; i < state.iterations; ++i) {
+        if (!decode_save_record(record, &decoded)) failures++;
+        do_not_optimize(decoded);
+    }
+    do_not_optimize(failures);
+}
+
+std::vector<TetrisBench::Benchmark> TetrisBench::all() {
+    std::vector<Benchmark> benchmarks;
+    benchmarks.push_back(Benchmark{"check_collision", bm_check_collision, "checks"});
+    benchmarks.push_back(Benchmark{"clear_full_lines/0", bm_clear_full_lines_0, "ops"});
+    benchmarks.push_back(Benchmark{"clear_full_lines/1", bm_clear_full_lines_1, "ops"});
+    benchmarks.push_back(Benchmark{"clear_full_lines/4", bm_clear_full_lines_4, "ops"});
+    benchmarks.push_back(Benchmark{"restore_state", bm_restore_state, "ops"});
+    benchmarks.push_back(Benchmark{"game_tick", bm_game_tick, "moves"});
+    benchmarks.push_back(Benchmark{"drop_piece", bm_drop_piece, "moves"});
+    benchmarks.push_back(Benchmark{"move_blocked", bm_move_blocked, "moves"});
+    benchmarks.push_back(Benchmark{"rotate_wall", bm_rotate_wall, "moves"});
+    benchmarks.push_back(Benchmark{"move_get_board", bm_move_get_board, "moves"});
+    benchmarks.push_back(Benchmark{"input_queue", bm_input_queue, "moves"});
+    benchmarks.push_back(Benchmark{"piece_queue/bag7", bm_piece_queue, "pieces"});
+    benchmarks.push_back(Benchmark{"random_game", bm_random_game, "moves"});
+    benchmarks.push_back(Benchmark{"random_game/6x12", bm_random_game_sized<6, 12>, "moves"});
+    benchmarks.push_back(Benchmark{"random_game/20x20", bm_random_game_sized<20, 20>, "moves"});
+    benchmarks.push_back(Benchmark{"random_game/10x40", bm_random_game_sized<10, 40>, "moves"});
+    benchmarks.push_back(Benchmark{"construct", bm_construct, "games"});
+    benchmarks.push_back(Benchmark{"create_destroy_api", bm_create_destroy_api, "games"});
+    benchmarks.push_back(Benchmark{"create_reset", bm_create_reset, "games"});
+    benchmarks.push_back(Benchmark{"solver_suggest/1", bm_solver_suggest, "moves"});
+    benchmarks.push_back(Benchmark{"pool_count_alive/100k", bm_pool_count_alive, "games"});
+    benchmarks.push_back(Benchmark{"pool_top_scores/100k", bm_pool_top_scores, "games"});
+    benchmarks.push_back(Benchmark{"pool_score_histogram/100k", bm_pool_score_histogram, "games"});
+    benchmarks.push_back(Benchmark{"save_encode", bm_save_encode, "games"});
+    benchmarks.push_back(Benchmark{"save_decode", bm_save_decode, "games"});
+    return benchmarks;
+}
+
+BenchResult TetrisBench::run(const Benchmark& benchmark, double min_time_seconds) {
+    const double min_time_ns = min_time_seconds * 1e9;
+    uint64_t iterations = 1;
+    for (;;) {
+        BenchState state(iterations);
+        benchmark.function(state);
+        state.stop_timing();
+
+        // 运行时间足够长，或者迭代次数已经大到没有意义时停止
+        if (state.elapsed_ns() >= min_time_ns || iterations >= (1ull << 40)) {
+            BenchResult result;
+            result.name = benchmark.name;
+            result.iterations = iterations;
+            result.ns_per_op = state.elapsed_ns() / iterations;
+            uint64_t items = state.items_processed ? state.items_processed : iterations;
+            result.items_per_second = state.elapsed_ns() > 0 ? items * 1e9 / state.elapsed_ns() : 0;
+            result.allocs_per_op = static_cast<double>(state.allocations()) / iterations;
+            result.item_label = benchmark.item_label;
+            return result;
+        }
+
+        // 按目前的速度估算需要的迭代次数（多估10%），每轮最多增长10倍
+        double per_op = state.elapsed_ns() > 0 ? state.elapsed_ns() / iterations : 1;
+        uint64_t estimate = static_cast<uint64_t>(min_time_ns * 1.1 / per_op) + 1;
+        iterations = std::max(iterations + 1, std::min(estimate, iterations * 10));
+    }
+}
+
+//------------------------------------------------------------------------------
+// 输出
+//------------------------------------------------------------------------------
+
+// 以JSON格式输出结果（context是运行环境信息，便于比较不同机器和版本的结果）
+static void write_json(FILE* out, const std::vector<BenchResult>& results, double min_time_seconds) {
+    char date[64];
+    time_t now = time(nullptr);
+    strftime(date, sizeof(date), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+#ifdef __OPTIMIZE__
+    const char* build = "optimized";
+#else
+    const char* build = "unoptimized";
+#endif
+
+    fprintf(out, "{\n");
+    fprintf(out, "  \"context\": {\n");
+    fprintf(out, "    \"date\": \"%s\",\n", date);
+    fprintf(out, "    \"num_cpus\": %u,\n", std::thread::hardware_concurrency());
+    fprintf(out, "    \"build\": \"%s\",\n", build);
+    fprintf(out, "    \"min_time\": %.3f,\n", min_time_seconds);
+    fprintf(out, "    \"board_width\": %d,\n", BOARD_WIDTH);
+    fprintf(out, "    \"board_height\": %d\n", BOARD_HEIGHT);
+    fprintf(out, "  },\n");
+    fprintf(out, "  \"benchmarks\": [\n");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        fprintf(out, "    {\"name\": \"%s\", \"iterations\": %llu, \"time_unit\": \"ns\", "
+                     "\"ns_per_op\": %.3f, \"items_per_second\": %.1f, \"item\": \"%s\", "
+                     "\"allocs_per_op\": %.3f}%s\n",
+                r.name.c_str(), static_cast<unsigned long long>(r.iterations), r.ns_per_op,
+                r.items_per_second, r.item_label, r.allocs_per_op, i + 1 < results.size() ? "," : "");
+    }
+    fprintf(out, "  ]\n");
+    fprintf(out, "}\n");
+}
+
+static void write_table(FILE* out, const std::vector<BenchResult>& results) {
+    fprintf(out, "%-22s %14s %14s %18s %12s\n", "benchmark", "iterations", "ns/op", "items/s", "allocs/op");
+    for (size_t i = 0; i < results.size(); ++i) {
+        const BenchResult& r = results[i];
+        char rate[64];
+        snprintf(rate, sizeof(rate), "%.4g %s", r.items_per_second, r.item_label);
+        fprintf(out, "%-22s %14llu %14.2f %18s %12.3f\n", r.name.c_str(),
+                static_cast<unsigned long long>(r.iterations), r.ns_per_op, rate, r.allocs_per_op);
+    }
+}
+
+int main(int argc, char** argv) {
+    bool json = false;
+    std::string out_path;
+    std::string filter;
+    double min_time_seconds = 0.5;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--json") {
+            json = true;
+        } else if (arg.compare(0, 6, "--out=") == 0) {
+            out_path = arg.substr(6);
+        } else if (arg.compare(0, 9, "--filter=") == 0) {
+            filter = arg.substr(9);
+        } else if (arg.compare(0, 11, "--min-time=") == 0) {
+            min_time_seconds = atof(arg.c_str() + 11);
+        } else {
+            fprintf(stderr, "用法: %s [--json] [--out=文件] [--filter=子串] [--min-time=秒]\n", argv[0]);
+            return 2;
+        }
+    }
+
+#ifndef __OPTIMIZE__
+    fprintf(stderr, "警告: 未开启编译优化，结果没有参考价值（请使用 -DCMAKE_BUILD_TYPE=Release 构建）\n");
+#endif
+
+    std::vector<BenchResult> results;
+    std::vector<TetrisBench::Benchmark> benchmarks = TetrisBench::all();
+    for (size_t i = 0; i < benchmarks.size(); ++i) {
+        if (!filter.empty() && std::string(benchmarks[i].name).find(filter) == std::string::npos) continue;
+        results.push_back(TetrisBench::run(benchmarks[i], min_time_seconds));
+        if (!json) fprintf(stderr, "完成: %s\n", benchmarks[i].name);
+    }
+
+    FILE* out = stdout;
+    if (!out_path.empty()) {
+        out = fopen(out_path.c_str(), "w");
+        if (!out) {
+            fprintf(stderr, "无法写入 %s\n", out_path.c_str());
+            return 1;
+        }
+    }
+    if (json) {
+        write_json(out, results, min_time_seconds);
+    } else {
+        write_table(out, results);
+    }
+    if (out != stdout) fclose(out);
+    return 0;
+}
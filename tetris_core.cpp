@@ -0,0 +1,73 @@
+// tetris_core.cpp
+// 进程内共享的核心上下文和游戏实例板块的实现
+#include "tetris_core.h"
+#include <chrono> // 基础种子的时钟部分
+#include <new>    // placement new
+#include <random> // std::random_device
+
+// 上下文故意不析构：Python等调用方可能在静态对象析构之后才销毁最后几局游戏
+TetrisCore& TetrisCore::instance() {
+    static TetrisCore* core = new TetrisCore();
+    return *core;
+}
+
+TetrisCore::TetrisCore()
+    : base_seed_((static_cast<uint64_t>(std::random_device()()) << 32) ^
+                 static_cast<uint64_t>(std::chrono::high_resolution_clock::now().time_since_epoch().count())),
+      sequence_(0), free_list_(nullptr), live_games_(0), capacity_(0) {
+    grow_locked(); // 预先分配第一个板块，此时还没有其他线程能访问上下文
+}
+
+uint64_t TetrisCore::next_seed() {
+    uint64_t x = base_seed_ + sequence_.fetch_add(1, std::memory_order_relaxed);
+    return TetrisRng::splitmix64(x);
+}
+
+TetrisGame* TetrisCore::create_game() {
+    return create_game(next_seed());
+}
+
+// 构造在锁外进行：锁只保护链表操作
+TetrisGame* TetrisCore::create_game(uint64_t seed) {
+    Slot* slot = acquire_slot();
+    return new (&slot->storage) TetrisGame(seed);
+}
+
+void TetrisCore::destroy_game(TetrisGame* game) {
+    if (!game) return;
+    game->~TetrisGame();
+    Slot* slot = reinterpret_cast<Slot*>(game); // storage是union的第一个成员，地址与槽位相同
+    std::lock_guard<std::mutex> lock(mutex_);
+    slot->next = free_list_;
+    free_list_ = slot;
+    live_games_--;
+}
+
+TetrisCore::Slot* TetrisCore::acquire_slot() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    if (!free_list_) grow_locked();
+    Slot* slot = free_list_;
+    free_list_ = slot->next;
+    live_games_++;
+    return slot;
+}
+
+// 板块一旦分配就不再释放：槽位会被反复复用，游戏数回落后保留的内存就是下一次高峰需要的内存
+void TetrisCore::grow_locked() {
+    Slot* slab = new Slot[GAMES_PER_SLAB];
+    for (int i = GAMES_PER_SLAB - 1; i >= 0; --i) { // 倒序挂入，取用时按地址顺序
+        slab[i].next = free_list_;
+        free_list_ = &slab[i];
+    }
+    capacity_ += GAMES_PER_SLAB;
+}
+
+size_t TetrisCore::live_games() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return live_games_;
+}
+
+size_t TetrisCore::capacity() const {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return capacity_;
+}
@@ -0,0 +1,68 @@
+// tetris_core.h
+// 进程内共享的核心上下文
+// 所有游戏共享的只读表（方块形状和踢墙表PieceTable、各等级的下落间隔）都是编译期常量，不需要初始化；
+// 上下文持有其余的进程级状态：默认种子序列的基础种子（第一次使用时取一次）和游戏实例的板块。
+//
+// 上下文同时管理游戏实例的内存：实例放在预先分配的板块（slab）里，每个板块有GAMES_PER_SLAB个槽位，
+// 空闲槽位串成一个链表。create_game从链表头取一个槽位、原地构造游戏，destroy_game原地析构后
+// 把槽位还回链表，两者都只是一次加锁的链表操作，不调用new/delete；只有所有槽位都用完时才再分配一个板块。
+// 构造只清零状态，开局（start_new_game）在原地重置棋盘和分数，因此创建一局游戏没有任何堆分配。
+#ifndef TETRIS_CORE_H // 防止头文件被重复包含的保护宏
+#define TETRIS_CORE_H
+
+#include <cstddef>      // size_t
+#include <cstdint>      // 固定宽度整数类型
+#include <atomic>       // 默认种子的序号
+#include <mutex>        // 保护空闲槽位链表
+#include <type_traits>  // 槽位的对齐存储
+#include "tetris_game.h" // TetrisGame
+
+class TetrisCore {
+public:
+    static const int GAMES_PER_SLAB = 64; // 每个板块的槽位数
+
+    // 获取进程内唯一的上下文（第一次调用时初始化，并预先分配第一个板块）
+    static TetrisCore& instance();
+
+    // 生成一个新的默认种子：基础种子加上递增的序号，再经过SplitMix64打散
+    // 不同游戏的种子一定不同，而且不需要每次都访问random_device
+    uint64_t next_seed();
+
+    // 从板块中取一个槽位原地构造游戏（种子由默认种子序列生成/使用指定的种子）
+    TetrisGame* create_game();
+    TetrisGame* create_game(uint64_t seed);
+
+    // 原地析构游戏并把槽位还回空闲链表（game必须来自create_game；nullptr什么也不做）
+    void destroy_game(TetrisGame* game);
+
+    // 正在使用的游戏实例数和已分配的槽位总数
+    size_t live_games() const;
+    size_t capacity() const;
+
+private:
+    // 一个槽位：空闲时存放链表指针，使用时存放一个TetrisGame
+    union Slot {
+        std::aligned_storage<sizeof(TetrisGame), alignof(TetrisGame)>::type storage;
+        Slot* next;
+    };
+
+    TetrisCore();
+    TetrisCore(const TetrisCore&);            // 禁止复制
+    TetrisCore& operator=(const TetrisCore&); // 禁止赋值
+
+    // 取一个空闲槽位，没有时先分配一个新板块
+    Slot* acquire_slot();
+
+    // 分配一个新板块并把它的槽位全部挂到空闲链表上（调用方持有mutex_）
+    void grow_locked();
+
+    const uint64_t base_seed_;        // 进程启动时从random_device和时钟取一次的基础种子
+    std::atomic<uint64_t> sequence_;  // 已经发出的默认种子数
+
+    mutable std::mutex mutex_; // 保护下面三个字段
+    Slot* free_list_;          // 空闲槽位链表
+    size_t live_games_;        // 正在使用的槽位数
+    size_t capacity_;          // 所有板块的槽位总数
+};
+
+#endif // TETRIS_CORE_H
@@ -1,360 +1,762 @@
 // tetris_game.cpp
 // 俄罗斯方块游戏的C++核心实现
-// 本文件包含TetrisGame类的所有实现，负责游戏的核心逻辑
+// 本文件包含BasicTetrisGame类模板的所有实现，负责游戏的核心逻辑
+// 成员函数都定义在这里，文件末尾为TETRIS_BOARD_SIZES中的每个尺寸显式实例化
 #include "tetris_game.h"
+#include "tetris_stats.h"  // 插桩计数器（未开启时为空）
+#include "tetris_core.h"   // 进程内共享的上下文：默认种子序列和游戏实例板块
+#include "tetris_input_queue.h" // 会话中的游戏才分配的输入队列
 #include <stdexcept> // 用于抛出std::out_of_range异常
 #include <algorithm> // 用于std::fill, std::copy等算法函数
+#if defined(__AVX2__)
+#include <immintrin.h> // AVX2：一次比较16行的占用掩码
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h> // SSE2：一次比较8行的占用掩码
+#define TETRIS_USE_SSE2
+#endif
+
+// 统计掩码中1的个数
+static inline int count_bits(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(mask);
+#else
+    int count = 0;
+    for (; mask; mask &= mask - 1) ++count;
+    return count;
+#endif
+}
+
+static inline int count_bits(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcountll(mask);
+#else
+    int count = 0;
+    for (; mask; mask &= mask - 1) ++count;
+    return count;
+#endif
+}
+
+// 掩码中最高的1所在的位（mask不能为0）
+static inline int highest_bit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 31 - __builtin_clz(mask);
+#else
+    int bit = 0;
+    while (mask >>= 1) ++bit;
+    return bit;
+#endif
+}
+
+static inline int highest_bit(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(mask);
+#else
+    int bit = 0;
+    while (mask >>= 1) ++bit;
+    return bit;
+#endif
+}
+
+// 掩码中最低的1所在的位（mask不能为0）
+static inline int lowest_bit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    int bit = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+static inline int lowest_bit(uint64_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctzll(mask);
+#else
+    int bit = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+// SIMD满行判断需要的最少行数（一组向量比较覆盖的行数）；没有SIMD指令集时不走向量路径
+#if defined(__AVX2__)
+static const int SIMD_FULL_ROW_GROUP = 16;
+#elif defined(TETRIS_USE_SSE2)
+static const int SIMD_FULL_ROW_GROUP = 8;
+#else
+static const int SIMD_FULL_ROW_GROUP = 65;
+#endif
+
+// 一次求出所有满行：返回掩码，第r位为1表示第r行已满
+// 通用路径逐行比较，行数是编译期常量，编译器可以完全展开
+template <int Width, int Height,
+          bool UseSimd = (Width <= 16 && Height >= SIMD_FULL_ROW_GROUP && Height <= 32)>
+struct FullRowFinder {
+    typedef BoardTraits<Width, Height> Traits;
+
+    static typename Traits::RowSet find(const typename Traits::Row* rows) {
+        typedef typename Traits::RowSet RowSet;
+        RowSet mask = 0;
+        for (int row = 0; row < Height; ++row) {
+            mask |= static_cast<RowSet>(rows[row] == Traits::full_row()) << row;
+        }
+        return mask;
+    }
+};
 
-// 俄罗斯方块形状的原始整数编码
-// 这些整数是从原始tinytetris.cpp中获取的，每个整数包含了一个方块的所有信息
-// 包括4个组成块的位置和方块的边界框尺寸
-const int val_x_shape = 431424;   // 实际解码为Z形 {(0,0),(1,0),(1,1),(2,1)}, 宽3, 高2 (原注释称I形)
-const int val_y_shape = 598356;   // 实际解码为垂直S/Z形 {(1,0),(1,1),(0,1),(0,2)}, 宽2, 高3 (原注释称I形旋转)
-const int val_r_shape = 427089;   // L形方块的编码
-const int val_p_shape_orig = 615696; // L形方块旋转90度的编码
-const int val_c_shape = 348480;   // O形方块的编码（四个旋转态相同）
-const int val_px_shape = 247872;  // 实际解码为{(0,0),(0,0),(1,0),(2,0)} (注意:block[0]和block[1]坐标相同), 宽4, 高1 (原注释称J形)
-const int val_py_shape = 799248;  // 实际解码为{(0,0),(0,1),(0,2),(3,0)}, 编码宽1, 高4 (注意:点(3,0)超出声明宽度1). (原注释称J形旋转)
-
-// initial_block_data存储每种方块类型所有旋转状态的原始编码
-// 7种基本方块类型，每种有4种旋转状态
-const int TetrisGame::initial_block_data[7][4] = {
-    {val_x_shape, val_y_shape, val_x_shape, val_y_shape}, // 方块0 (原注释称I形; val_x_shape实际为Z形, val_y_shape实际为垂直S/Z形): 长条，只有两种有效旋转状态
-    {val_r_shape, val_p_shape_orig, val_r_shape, val_p_shape_orig}, // 方块1 (L形): L型，只有两种有效旋转状态
-    {val_c_shape, val_c_shape, val_c_shape, val_c_shape}, // 方块2 (O形): 方块，所有旋转状态相同
-    {599636, 431376, 598336, 432192},                     // 方块3 (S形; 注意: 部分旋转解码为非标准/问题形状): S型，有四种旋转状态
-    {411985, 610832, 415808, 595540},                     // 方块4 (Z形; 注意: 部分旋转解码为非标准/问题形状或S形): Z型，有四种旋转状态
-    {val_px_shape, val_py_shape, val_px_shape, val_py_shape}, // 方块5 (原注释称J形; val_px_shape解码为{(0,0),(0,0),(1,0),(2,0)}, val_py_shape解码为{(0,0),(0,1),(0,2),(3,0)} (编码宽1,高4;点(3,0)超出声明宽度)): 反L型，只有两种有效旋转状态
-    {614928, 399424, 615744, 428369}                      // 方块6 (T形): T型，有四种旋转状态
+// 16位行掩码、不超过32行的棋盘（包括标准棋盘）：AVX2用两次（SSE2用三次）向量比较就能覆盖整个棋盘，
+// 最后一组与前一组重叠加载，不会读到数组之外
+template <int Width, int Height>
+struct FullRowFinder<Width, Height, true> {
+    typedef BoardTraits<Width, Height> Traits;
+
+    static uint32_t find(const uint16_t* rows) {
+#if defined(__AVX2__)
+        const __m256i full = _mm256_set1_epi16(static_cast<short>(Traits::full_row()));
+        uint32_t mask = 0;
+        for (int base = 0; base < Height; base += 16) {
+            int row = base + 16 <= Height ? base : Height - 16; // 最后一组重叠加载
+            __m256i eq = _mm256_cmpeq_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(rows + row)), full);
+            // 每个128位半边各自把8个16位结果压成8个字节：movemask的第0-7位对应前8行，第16-23位对应后8行
+            uint32_t bits = static_cast<uint32_t>(_mm256_movemask_epi8(_mm256_packs_epi16(eq, _mm256_setzero_si256())));
+            mask |= ((bits & 0xFFu) | ((bits >> 8) & 0xFF00u)) << row;
+        }
+        return mask;
+#elif defined(TETRIS_USE_SSE2)
+        const __m128i full = _mm_set1_epi16(static_cast<short>(Traits::full_row()));
+        uint32_t mask = 0;
+        for (int base = 0; base < Height; base += 8) {
+            int row = base + 8 <= Height ? base : Height - 8; // 最后一组重叠加载
+            __m128i eq = _mm_cmpeq_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(rows + row)), full);
+            uint32_t bits = static_cast<uint32_t>(_mm_movemask_epi8(_mm_packs_epi16(eq, _mm_setzero_si128())));
+            mask |= bits << row;
+        }
+        return mask;
+#else
+        return FullRowFinder<Width, Height, false>::find(rows);
+#endif
+    }
 };
 
 // 构造函数：初始化游戏对象
-TetrisGame::TetrisGame() : score_(0), game_over_(false), current_piece_type_(0), current_rotation_(0), tick_speed_control_(0) {
-    srand(static_cast<unsigned int>(time(nullptr))); // 初始化随机数生成器的种子
-    initialize_piece_definitions(); // 解码方块定义
-    memset(board_, 0, sizeof(board_)); // 将整个棋盘初始化为0（空格）
+template <int Width, int Height>
+BasicTetrisGame<Width, Height>::BasicTetrisGame() {
+    initialize(TetrisCore::instance().next_seed());
 }
 
-// 析构函数：清理资源
-TetrisGame::~TetrisGame() {
-    // 在这个版本中，没有需要在析构函数中清理的动态资源
-}
-
-// 从方块形状的整数编码中提取2位的值
-// piece_raw_data: 包含方块信息的整数
-// bit_offset: 要提取的2位值在整数中的位置
-// 返回值: 提取的2位值（0-3的整数）
-int TetrisGame::get_two_bit_value(int piece_raw_data, int bit_offset) const {
-    // 右移bit_offset位，然后与3（二进制：11）进行按位与操作，提取最低2位
-    return (piece_raw_data >> bit_offset) & 3;
-}
-
-// 初始化所有方块形状定义
-// 这个函数解码initial_block_data中的整数，将其转换为更容易使用的TetrominoShape结构
-void TetrisGame::initialize_piece_definitions() {
-    piece_definitions_.resize(7); // 为7种方块类型分配空间
-    for (int i = 0; i < 7; ++i) {
-        piece_definitions_[i].resize(4); // 每种方块有4种旋转状态
-        for (int j = 0; j < 4; ++j) {
-            int raw_data = initial_block_data[i][j]; // 获取整数编码
-            TetrominoShape current_shape;
-
-            // 解码4个组成块的相对坐标
-            // 在整数编码中，每2位表示一个坐标值
-            // 0-1位表示第一个块的y坐标，2-3位表示第一个块的x坐标，以此类推
-            current_shape.blocks[0].y = get_two_bit_value(raw_data, 0);  // 第一个块的y坐标
-            current_shape.blocks[0].x = get_two_bit_value(raw_data, 2);  // 第一个块的x坐标
-            current_shape.blocks[1].y = get_two_bit_value(raw_data, 4);  // 第二个块的y坐标
-            current_shape.blocks[1].x = get_two_bit_value(raw_data, 6);  // 第二个块的x坐标
-            current_shape.blocks[2].y = get_two_bit_value(raw_data, 8);  // 第三个块的y坐标
-            current_shape.blocks[2].x = get_two_bit_value(raw_data, 10); // 第三个块的x坐标
-            current_shape.blocks[3].y = get_two_bit_value(raw_data, 12); // 第四个块的y坐标
-            current_shape.blocks[3].x = get_two_bit_value(raw_data, 14); // 第四个块的x坐标
-
-            // 解码方块边界框的宽度和高度
-            // 在编码中，width-1和height-1分别存储在16-17位和18-19位
-            // 所以我们需要加1才能得到实际的宽度和高度
-            current_shape.width  = get_two_bit_value(raw_data, 16) + 1; // 方块宽度
-            current_shape.height = get_two_bit_value(raw_data, 18) + 1; // 方块高度
-            
-            piece_definitions_[i][j] = current_shape; // 存储解码后的方块形状
-        }
-    }
+// 构造函数：使用指定的种子
+template <int Width, int Height>
+BasicTetrisGame<Width, Height>::BasicTetrisGame(uint64_t seed) {
+    initialize(seed);
 }
 
-// 开始新游戏
-void TetrisGame::start_new_game() {
-    memset(board_, 0, sizeof(board_)); // 清空棋盘，所有格子设为0（空）
-    score_ = 0;        // 重置分数
-    game_over_ = false; // 重置游戏状态
-    tick_speed_control_ = 0; // 重置下落速度控制器
-    spawn_new_piece();  // 生成第一个方块
+// 构造函数的公共初始化部分
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::initialize(uint64_t seed) {
+    recording_ = false;
+    input_queue_ = nullptr; // 由注册表按需分配
+    pending_randomizer_ = RANDOMIZER_BAG7;
+    memset(&state_, 0, sizeof(state_)); // 棋盘、占用层、分数等全部清零
+    state_.dirty_rows = Traits::all_rows();
+    stale_rows_ = Traits::all_rows(); // 合成棋盘还没有内容
+    state_.rng.seed(seed); // 初始化本局游戏的随机数生成器
+    state_.next_pieces.reset(RANDOMIZER_BAG7); // 默认使用7袋
 }
 
-// 获取特定类型和旋转状态的方块形状数据
-const TetrominoShape& TetrisGame::get_shape_data(int piece_type, int rotation) const {
-    return piece_definitions_[piece_type][rotation];
+// 析构函数：清理资源
+template <int Width, int Height>
+BasicTetrisGame<Width, Height>::~BasicTetrisGame() {
+    delete input_queue_; // 唯一的动态资源：会话用过的输入队列
 }
 
-// 获取当前方块的形状数据
-const TetrominoShape& TetrisGame::get_current_shape_data() const {
-    return get_shape_data(current_piece_type_, current_rotation_);
+// 开始新游戏：从自身的随机数生成器派生本局种子
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::start_new_game() {
+    start_new_game_seeded(state_.rng.next64());
 }
 
-// 在棋盘上放置或移除方块
+// 用指定的种子开始新游戏
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::start_new_game_seeded(uint64_t seed) {
+    state_.rng.seed(seed); // 本局的方块序列完全由seed和随机方式决定
+    state_.next_pieces.reset(pending_randomizer_); // 清空预览队列并换上设置的随机方式，第一个方块生成时补满
+    if (recording_) {
+        replay_log_.begin(seed, pending_randomizer_); // 回放日志从开局种子和随机方式开始
+    }
+    memset(state_.board, 0, sizeof(state_.board)); // 清空棋盘，所有格子设为0（空）
+    memset(state_.rows, 0, sizeof(state_.rows)); // 清空占用层
+    memset(state_.column_heights, 0, sizeof(state_.column_heights)); // 所有列都是空的
+    mark_rows(Traits::all_rows()); // 整个棋盘都需要重新发送和重新合成
+    state_.score = 0;        // 重置分数
+    state_.lines = 0;        // 重置消除行数
+    state_.cleared_rows = 0; // 还没有消除过任何行
+    state_.game_over = false; // 重置游戏状态
+    state_.tick_speed_control = 0; // 重置下落速度控制器
+    spawn_new_piece();  // 生成第一个方块
+}
+
+
+// 在已固定的棋盘上放置或移除方块（当前方块固定时调用）
 // pos: 方块在棋盘上的位置
 // piece_type: 方块类型
 // rotation: 旋转状态
 // value: 0表示移除，>0表示放置（值表示方块颜色）
-void TetrisGame::place_or_remove_piece(Point pos, int piece_type, int rotation, int value) {
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::place_or_remove_piece(Point pos, int piece_type, int rotation, int value) {
+    TETRIS_STAT_SCOPE(STAT_PLACE_OR_REMOVE_PIECE);
     const TetrominoShape& shape = get_shape_data(piece_type, rotation);
     for (int i = 0; i < 4; ++i) { // 遍历方块的4个组成块
         int board_x = pos.x + shape.blocks[i].x; // 计算在棋盘上的x坐标
         int board_y = pos.y + shape.blocks[i].y; // 计算在棋盘上的y坐标
         // 只有在棋盘范围内时才修改棋盘
-        if (board_x >= 0 && board_x < BOARD_WIDTH && board_y >= 0 && board_y < BOARD_HEIGHT) {
-            board_[board_y][board_x] = value; // 设置棋盘格子的值
+        if (board_x >= 0 && board_x < Width && board_y >= 0 && board_y < Height) {
+            state_.board[board_y][board_x] = value; // 设置棋盘格子的值（颜色平面）
+            // 同步更新占用层中对应的位
+            mark_rows(static_cast<RowSet>(1) << board_y); // 记录脏行
+            Row bit = static_cast<Row>(1u << board_x);
+            if (value != 0) {
+                state_.rows[board_y] |= bit;
+            } else {
+                state_.rows[board_y] &= static_cast<Row>(~bit);
+            }
         }
     }
 }
 
-// 检查方块在给定位置和旋转状态下是否会发生碰撞
-// pos: 方块在棋盘上的位置
-// piece_type: 方块类型
-// rotation: 旋转状态
-// 返回值: true表示会发生碰撞，false表示不会发生碰撞
-bool TetrisGame::check_collision(Point pos, int piece_type, int rotation) const {
-    const TetrominoShape& shape = get_shape_data(piece_type, rotation);
-    for (int i = 0; i < 4; ++i) { // 遍历方块的4个组成块
-        int board_x = pos.x + shape.blocks[i].x; // 计算在棋盘上的x坐标
-        int board_y = pos.y + shape.blocks[i].y; // 计算在棋盘上的y坐标
+// 方块放在pos时是否超出Width x Height的棋盘或与rows中的方块重叠
+template <int Width, int Height, typename Row>
+static bool collides(const Row* rows, Point pos, const TetrominoShape& shape) {
+    // 检查是否超出棋盘边界：用预计算的占用范围一次判断，无需逐块检查
+    if (pos.x + shape.min_x < 0 || pos.x + shape.max_x >= Width ||
+        pos.y + shape.min_y < 0 || pos.y + shape.max_y >= Height) {
+        return true; // 与棋盘边界碰撞
+    }
 
-        // 检查是否超出棋盘边界
-        if (board_x < 0 || board_x >= BOARD_WIDTH || board_y < 0 || board_y >= BOARD_HEIGHT) {
-            return true; // 与棋盘边界碰撞
-        }
-        // 检查是否与已有方块碰撞
-        if (board_[board_y][board_x] != 0) {
+    // 检查是否与已有方块碰撞：每行只需一次按位与
+    for (int row = shape.min_y; row <= shape.max_y; ++row) {
+        // pos.x可能为负（墙踢测试时），此时右移；范围检查已保证不会移出有效位
+        // 形状的行掩码先扩展到棋盘的行掩码类型再移位，宽棋盘上靠右的列不会被截掉
+        Row piece_row = pos.x >= 0 ? static_cast<Row>(static_cast<Row>(shape.row_masks[row]) << pos.x)
+                                   : static_cast<Row>(shape.row_masks[row] >> -pos.x);
+        if (rows[pos.y + row] & piece_row) {
             return true; // 与棋盘上已有的方块碰撞
         }
     }
     return false; // 没有发生碰撞
 }
 
-// 生成新的方块
-void TetrisGame::spawn_new_piece() {
-    current_piece_type_ = rand() % 7; // 随机选择一种方块类型 (0-6)
-    current_rotation_ = rand() % 4;   // 随机选择一个旋转状态 (0-3)
+// 检查方块在给定位置和旋转状态下是否会发生碰撞
+// pos: 方块在棋盘上的位置
+// piece_type: 方块类型
+// rotation: 旋转状态
+// 返回值: true表示会发生碰撞，false表示不会发生碰撞
+template <int Width, int Height>
+bool BasicTetrisGame<Width, Height>::check_collision(Point pos, int piece_type, int rotation) const {
+    TETRIS_STAT_SCOPE(STAT_CHECK_COLLISION);
+    return collides<Width, Height>(state_.rows, pos, get_shape_data(piece_type, rotation));
+}
 
-    const TetrominoShape& shape = get_current_shape_data();
-    
-    // 随机选择一个水平位置，确保方块完全在棋盘内
-    current_piece_pos_.x = rand() % (BOARD_WIDTH - shape.width + 1);
-    current_piece_pos_.y = 0; // 方块总是从棋盘顶部开始下落
+// 生成新的方块
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::spawn_new_piece() {
+    TETRIS_STAT_SCOPE(STAT_SPAWN_NEW_PIECE);
+    // 从预览队列取出下一个方块：类型、旋转状态和生成列在补满队列时已经成批抽好
+    uint16_t entry = state_.next_pieces.pop(state_.rng, Width);
+    state_.piece_type = PieceQueue::entry_type(entry);
+    state_.rotation = PieceQueue::entry_rotation(entry);
+    state_.piece_pos.x = PieceQueue::entry_x(entry); // 生成列保证方块完全在棋盘内
+    state_.piece_pos.y = 0; // 方块总是从棋盘顶部开始下落
 
     // 检查新生成的方块是否与棋盘上已有方块发生碰撞
-    if (check_collision(current_piece_pos_, current_piece_type_, current_rotation_)) {
-        game_over_ = true; // 如果一开始就碰撞，说明游戏结束
+    if (check_collision(state_.piece_pos, state_.piece_type, state_.rotation)) {
+        state_.game_over = true; // 如果一开始就碰撞，说明游戏结束
     } else {
-        // 将新方块放置在棋盘上
-        place_or_remove_piece(current_piece_pos_, current_piece_type_, current_rotation_, current_piece_type_ + 1);
+        touch_piece_rows(); // 新方块出现在棋盘顶部（只标记所在的行，不写棋盘）
     }
 }
 
+// 当前方块占据的行需要重新发送和重新合成
+// 方块的组成块是连通的，占据的行就是min_y到max_y之间的连续几行
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::touch_piece_rows() {
+    const TetrominoShape& shape = get_current_shape_data();
+    RowSet span = (static_cast<RowSet>(2) << (shape.max_y - shape.min_y)) - 1;
+    mark_rows(span << (state_.piece_pos.y + shape.min_y));
+}
+
 // 将当前方块向左移动一格
-bool TetrisGame::move_left() {
-    if (game_over_) return false; // 如果游戏已结束，不执行任何操作
+// 当前方块不在棋盘中，直接检查新位置；移动失败时不修改任何状态
+template <int Width, int Height>
+bool BasicTetrisGame<Width, Height>::move_left() {
+    if (state_.game_over) return false; // 如果游戏已结束，不执行任何操作
+    record_action(ACTION_LEFT);
 
-    Point new_pos = current_piece_pos_;
+    Point new_pos = state_.piece_pos;
     new_pos.x--; // 尝试向左移动一格
-
-    // 从棋盘上移除当前方块（先擦除再检查碰撞）
-    place_or_remove_piece(current_piece_pos_, current_piece_type_, current_rotation_, 0);
-    // 检查新位置是否会发生碰撞
-    bool collision = check_collision(new_pos, current_piece_type_, current_rotation_);
-    
-    if (!collision) {
-        // 如果没有碰撞，更新方块位置
-        current_piece_pos_ = new_pos;
+    if (check_collision(new_pos, state_.piece_type, state_.rotation)) {
+        return false; // 被墙壁或已固定的方块挡住
     }
-    // 在棋盘上重新绘制方块（无论是否移动成功）
-    place_or_remove_piece(current_piece_pos_, current_piece_type_, current_rotation_, current_piece_type_ + 1);
-    return !collision; // 返回移动是否成功
+    state_.piece_pos = new_pos;
+    touch_piece_rows(); // 左右移动不改变方块占据的行
+    return true;
 }
 
 // 将当前方块向右移动一格
-bool TetrisGame::move_right() {
-    if (game_over_) return false; // 如果游戏已结束，不执行任何操作
+template <int Width, int Height>
+bool BasicTetrisGame<Width, Height>::move_right() {
+    if (state_.game_over) return false; // 如果游戏已结束，不执行任何操作
+    record_action(ACTION_RIGHT);
 
-    Point new_pos = current_piece_pos_;
+    Point new_pos = state_.piece_pos;
     new_pos.x++; // 尝试向右移动一格
-
-    // 从棋盘上移除当前方块
-    place_or_remove_piece(current_piece_pos_, current_piece_type_, current_rotation_, 0);
-    // 检查新位置是否会发生碰撞
-    bool collision = check_collision(new_pos, current_piece_type_, current_rotation_);
-
-    if (!collision) {
-        // 如果没有碰撞，更新方块位置
-        current_piece_pos_ = new_pos;
+    if (check_collision(new_pos, state_.piece_type, state_.rotation)) {
+        return false; // 被墙壁或已固定的方块挡住
     }
-    // 在棋盘上重新绘制方块
-    place_or_remove_piece(current_piece_pos_, current_piece_type_, current_rotation_, current_piece_type_ + 1);
-    return !collision; // 返回移动是否成功
+    state_.piece_pos = new_pos;
+    touch_piece_rows(); // 左右移动不改变方块占据的行
+    return true;
 }
 
-// 旋转当前方块
-bool TetrisGame::rotate_piece() {
-    if (game_over_) return false; // 如果游戏已结束，不执行任何操作
+// 旋转当前方块（SRS）
+// 依次尝试踢墙表中的偏移，第一个不发生碰撞的位置就是旋转结果；每次尝试是一次边界判断加最多4次按位与
+template <int Width, int Height>
+bool BasicTetrisGame<Width, Height>::rotate_piece() {
+    if (state_.game_over) return false; // 如果游戏已结束，不执行任何操作
+    record_action(ACTION_ROTATE);
 
     // 计算下一个旋转状态（顺时针旋转）
-    int next_rotation = (current_rotation_ + 1) % piece_definitions_[current_piece_type_].size();
-
-    // 从棋盘上移除当前方块
-    place_or_remove_piece(current_piece_pos_, current_piece_type_, current_rotation_, 0);
-    
-    // 检查旋转后是否会发生碰撞
-    bool collision = check_collision(current_piece_pos_, current_piece_type_, next_rotation);
-    Point test_pos = current_piece_pos_;
-
-    // 墙壁反弹：如果旋转后与墙壁碰撞，尝试调整位置
-    if (collision) {
-        // 尝试向左移动一格
-        test_pos.x--; 
-        if (!check_collision(test_pos, current_piece_type_, next_rotation)) {
-            current_piece_pos_ = test_pos;
-            collision = false; // 旋转成功
-        } else {
-            // 尝试向右移动两格（从原始位置）
-            test_pos.x += 2; 
-             if (!check_collision(test_pos, current_piece_type_, next_rotation)) {
-                current_piece_pos_ = test_pos;
-                collision = false; // 旋转成功
-            } else {
-                // 如果向左向右都不行，可以尝试其他位置调整（如向上）
-                // 或者更复杂的超级旋转系统（SRS）
-                test_pos = current_piece_pos_; // 重置位置
-            }
-        }
+    int next_rotation = (state_.rotation + 1) % PieceTable::ROTATIONS;
+    const RotationKicks& kicks = PieceTable::kicks(state_.piece_type, state_.rotation);
+
+    for (int k = 0; k < kicks.count; ++k) {
+        Point test_pos = state_.piece_pos;
+        test_pos.x += kicks.offsets[k].dx;
+        test_pos.y += kicks.offsets[k].dy;
+        if (check_collision(test_pos, state_.piece_type, next_rotation)) continue; // 这个位置放不下，尝试下一个偏移
+
+        touch_piece_rows(); // 旋转前占据的行
+        state_.piece_pos = test_pos;
+        state_.rotation = next_rotation;
+        touch_piece_rows(); // 旋转后占据的行
+        return true;
     }
-
-    if (!collision) {
-        // 如果旋转不会发生碰撞，更新旋转状态
-        current_rotation_ = next_rotation;
-    }
-    // 在棋盘上重新绘制方块
-    place_or_remove_piece(current_piece_pos_, current_piece_type_, current_rotation_, current_piece_type_ + 1);
-    return !collision; // 返回旋转是否成功
+    return false; // 所有偏移都放不下，旋转失败，状态不变
 }
 
 // 将当前方块固定在棋盘上
-void TetrisGame::solidify_current_piece() {
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::solidify_current_piece() {
+    // 当前方块写入已固定的棋盘，这是方块唯一一次写棋盘
+    place_or_remove_piece(state_.piece_pos, state_.piece_type, state_.rotation, state_.piece_type + 1);
+    raise_column_heights();
     // 尝试清除满行并增加分数
-    score_ += clear_full_lines(); 
+    state_.cleared_rows = clear_full_lines();
+    int lines = count_bits(state_.cleared_rows);
+    state_.lines += lines;
+    state_.score += lines; 
     // 生成下一个方块
     spawn_new_piece(); 
 }
 
 // 游戏时钟：推进游戏一个时间单位
-bool TetrisGame::game_tick() {
-    if (game_over_) return false; // 如果游戏已结束，不执行任何操作
+template <int Width, int Height>
+bool BasicTetrisGame<Width, Height>::game_tick() {
+    if (state_.game_over) return false; // 如果游戏已结束，不执行任何操作
+    record_action(ACTION_TICK);
 
-    Point new_pos = current_piece_pos_;
+    Point new_pos = state_.piece_pos;
     new_pos.y++; // 尝试向下移动一格
 
-    // 从棋盘上移除当前方块
-    place_or_remove_piece(current_piece_pos_, current_piece_type_, current_rotation_, 0); 
-    // 检查下方是否有碰撞
-    bool collision_below = check_collision(new_pos, current_piece_type_, current_rotation_);
-
-    if (!collision_below) {
+    if (!check_collision(new_pos, state_.piece_type, state_.rotation)) {
         // 如果下方没有碰撞，更新方块位置
-        current_piece_pos_ = new_pos;
-        // 在新位置重新绘制方块
-        place_or_remove_piece(current_piece_pos_, current_piece_type_, current_rotation_, current_piece_type_ + 1); 
+        touch_piece_rows(); // 下移前占据的行
+        state_.piece_pos = new_pos;
+        touch_piece_rows(); // 下移后占据的行
     } else {
         // 如果下方有碰撞，将方块固定在当前位置
-        place_or_remove_piece(current_piece_pos_, current_piece_type_, current_rotation_, current_piece_type_ + 1);
         solidify_current_piece(); // 固定方块并生成新方块
     }
-    return !game_over_; // 返回游戏是否继续
+    return !state_.game_over; // 返回游戏是否继续
 }
 
 // 硬降：将方块直接下落到底部
-void TetrisGame::drop_piece() {
-    if (game_over_) return; // 如果游戏已结束，不执行任何操作
-    
-    // 从棋盘上移除当前方块
-    place_or_remove_piece(current_piece_pos_, current_piece_type_, current_rotation_, 0); 
-    
-    // 不断向下移动，直到发生碰撞
-    while (!check_collision(current_piece_pos_, current_piece_type_, current_rotation_)) {
-        current_piece_pos_.y++;
-    }
-    current_piece_pos_.y--; // 回退一步，找到最后一个不发生碰撞的位置
- 
-    // 在最终位置重新绘制方块
-    place_or_remove_piece(current_piece_pos_, current_piece_type_, current_rotation_, current_piece_type_ + 1); 
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::drop_piece() {
+    if (state_.game_over) return; // 如果游戏已结束，不执行任何操作
+    record_action(ACTION_DROP);
+
+    // 由表面高度直接算出落点，不再逐行下移检查碰撞
+    int landing_y = find_landing_y();
+    if (landing_y != state_.piece_pos.y) {
+        touch_piece_rows(); // 方块离开原来的行
+        state_.piece_pos.y = landing_y;
+    }
     // 固定方块并生成新方块
     solidify_current_piece();
 }
 
-// 清除满行并计算分数
-int TetrisGame::clear_full_lines() {
-    int lines_cleared = 0; // 记录清除的行数
-    
-    // 从底部向上检查每一行
-    for (int row = BOARD_HEIGHT - 1; row >= 0; --row) {
-        bool line_full = true; // 假设当前行是满的
-        
-        // 检查当前行的每一列
-        for (int col = 0; col < BOARD_WIDTH; ++col) {
-            if (board_[row][col] == 0) { // 如果找到空格
-                line_full = false; // 行不满
-                break;
-            }
-        }
+// 当前方块硬降后的锚点y
+// 方块每列最低的组成块在表面之上时，这一列允许的最低锚点是“表面所在行 - 1 - 该列底部的相对y”，
+// 各列取最小值就是落点（一列中的组成块是连续的，只有最低的那个会先碰到表面）
+template <int Width, int Height>
+int BasicTetrisGame<Width, Height>::find_landing_y() const {
+    const TetrominoShape& shape = get_current_shape_data();
+    const Point pos = state_.piece_pos;
+    int landing_y = Height;
+    for (int i = 0; i < 4; ++i) {
+        if (shape.bottom[i] < 0) continue; // 方块在这一列没有组成块
+        int surface = Height - state_.column_heights[pos.x + i]; // 表面之上第一个空行的下一行
+        if (pos.y + shape.bottom[i] >= surface) return scan_landing_y(); // 方块已经在表面之下（塞进了悬空方块下方）
+        int limit = surface - 1 - shape.bottom[i];
+        if (limit < landing_y) landing_y = limit;
+    }
+    return landing_y;
+}
 
-        if (line_full) { // 如果行满了
-            lines_cleared++; // 增加已清除行数
-            
-            // 将当前行以上的所有行下移一行
-            for (int k = row; k > 0; --k) {
-                memcpy(board_[k], board_[k - 1], BOARD_WIDTH * sizeof(int));
-            }
-            // 清空最顶行
-            memset(board_[0], 0, BOARD_WIDTH * sizeof(int));
-            
-            row++; // 因为当前行已被上方的行替换，需要重新检查当前行
+// 逐行下移检查落点（占用层中只有已固定的方块）
+template <int Width, int Height>
+int BasicTetrisGame<Width, Height>::scan_landing_y() const {
+    const TetrominoShape& shape = get_current_shape_data();
+    Point pos = state_.piece_pos;
+    do {
+        pos.y++;
+    } while (!collides<Width, Height>(state_.rows, pos, shape));
+    return pos.y - 1; // 最后一个不发生碰撞的位置
+}
+
+// 方块固定后更新它占用的各列的表面高度
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::raise_column_heights() {
+    const TetrominoShape& shape = get_current_shape_data();
+    for (int i = 0; i < 4; ++i) {
+        int x = state_.piece_pos.x + shape.blocks[i].x;
+        int height = Height - (state_.piece_pos.y + shape.blocks[i].y);
+        if (height > state_.column_heights[x]) state_.column_heights[x] = static_cast<uint8_t>(height);
+    }
+}
+
+// 由占用层重新计算所有列的表面高度：从上往下扫描，每列第一次出现方块的行决定该列高度
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::rebuild_column_heights() {
+    memset(state_.column_heights, 0, sizeof(state_.column_heights));
+    uint32_t pending = Traits::full_row(); // 还没有找到表面的列
+    for (int y = 0; y < Height && pending; ++y) {
+        uint32_t first = state_.rows[y] & pending;
+        pending &= ~first;
+        for (; first; first &= first - 1) {
+            state_.column_heights[lowest_bit(first)] = static_cast<uint8_t>(Height - y);
         }
     }
-    
+}
+
+// 落点预览：当前方块硬降后的位置
+template <int Width, int Height>
+bool BasicTetrisGame<Width, Height>::get_ghost_position(Point* out_pos) const {
+    if (state_.game_over) return false;
+    out_pos->x = state_.piece_pos.x;
+    out_pos->y = find_landing_y();
+    return true;
+}
+
+// 设置随机方式，从下一次开局起生效
+template <int Width, int Height>
+bool BasicTetrisGame<Width, Height>::set_randomizer(int randomizer) {
+    if (randomizer < 0 || randomizer >= RANDOMIZER_COUNT) return false;
+    pending_randomizer_ = static_cast<uint8_t>(randomizer); // 进行中的一局继续使用原来的方式
+    return true;
+}
+
+// 下一次开局使用的随机方式
+template <int Width, int Height>
+int BasicTetrisGame<Width, Height>::get_randomizer() const {
+    return pending_randomizer_;
+}
+
+// 后续方块预览：队列在生成方块后总有至少PREVIEW_MAX项
+template <int Width, int Height>
+int BasicTetrisGame<Width, Height>::get_next_pieces(int* out_types, int n) const {
+    if (state_.game_over) return 0;
+    if (n > state_.next_pieces.count) n = state_.next_pieces.count;
+    if (n > PieceQueue::PREVIEW_MAX) n = PieceQueue::PREVIEW_MAX;
+    for (int i = 0; i < n; ++i) {
+        out_types[i] = PieceQueue::entry_type(state_.next_pieces.peek(i));
+    }
+    return n < 0 ? 0 : n;
+}
+
+// 开启/关闭回放日志记录
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::set_replay_recording(bool enabled) {
+    recording_ = enabled;
+    replay_log_.clear(); // 开启时从下一次开局开始记录；关闭时释放已有内容
+}
+
+// 获取当前这一局的回放日志
+template <int Width, int Height>
+const ReplayLog& BasicTetrisGame<Width, Height>::get_replay_log() const {
+    return replay_log_;
+}
+
+// 记录一个动作到回放日志
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::record_action(int action) {
+    if (recording_) replay_log_.record(action);
+}
+
+// 分配输入队列
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::enable_input_queue() {
+    if (!input_queue_) input_queue_ = new InputQueue();
+}
+
+// 把动作放进输入队列（任意线程）
+template <int Width, int Height>
+bool BasicTetrisGame<Width, Height>::enqueue_input(int action, uint64_t timestamp_us) {
+    if (action <= ACTION_NONE || action >= ACTION_COUNT) return false; // 空动作没有必要排队
+    return input_queue_ ? input_queue_->push(action, timestamp_us) : false;
+}
+
+// 执行排队的输入，再推进游戏时钟（持有游戏的线程）
+template <int Width, int Height>
+int BasicTetrisGame<Width, Height>::drain_inputs_and_step(int max_inputs, int ticks, uint64_t* out_max_wait_us) {
+    int applied = 0;
+    uint64_t oldest = 0; // 最早的入队时间（0表示还没有）
+    InputEvent event;
+    while (input_queue_ && (max_inputs <= 0 || applied < max_inputs) && input_queue_->pop(&event)) {
+        apply_action(event.action); // 游戏已结束时各操作什么也不做
+        if (applied == 0 || event.timestamp_us < oldest) oldest = event.timestamp_us;
+        applied++;
+    }
+    for (int i = 0; i < ticks && !state_.game_over; ++i) {
+        game_tick();
+    }
+    if (out_max_wait_us) {
+        uint64_t now = applied > 0 ? InputQueue::now_us() : 0;
+        *out_max_wait_us = now > oldest ? now - oldest : 0;
+    }
+    return applied;
+}
+
+// 丢弃排队中的输入
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::discard_inputs() {
+    if (input_queue_) input_queue_->clear();
+}
+
+// 获取当前的全部可变状态
+template <int Width, int Height>
+const BasicGameState<Width, Height>& BasicTetrisGame<Width, Height>::get_state() const {
+    return state_;
+}
+
+// 用快照覆盖当前状态
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::restore_state(const State& state) {
+    memcpy(&state_, &state, sizeof(state_));
+    pending_randomizer_ = state_.next_pieces.randomizer; // 恢复的游戏在以后的开局中沿用它的随机方式
+    stale_rows_ = Traits::all_rows(); // 合成棋盘需要整体重新合成
+    replay_log_.clear(); // 日志与恢复后的状态不再对应
+}
+
+// 按动作编码执行一次操作
+template <int Width, int Height>
+bool BasicTetrisGame<Width, Height>::apply_action(int action) {
+    switch (action) {
+        case ACTION_NONE:   return true;            // 空动作：什么都不做
+        case ACTION_LEFT:   return move_left();
+        case ACTION_RIGHT:  return move_right();
+        case ACTION_ROTATE: return rotate_piece();
+        case ACTION_DROP:   drop_piece(); return true; // 硬降总是会改变状态
+        case ACTION_TICK:   return game_tick();
+        default:            return false;           // 无效的动作编码
+    }
+}
+
+// 清除满行并计算分数
+// 先用一次向量比较找出所有满行，再从最低的满行开始自下而上压缩：
+// 每个保留下来的行只移动一次（直接移到最终位置），一次消4行也只扫一遍棋盘
+template <int Width, int Height>
+typename BoardTraits<Width, Height>::RowSet BasicTetrisGame<Width, Height>::clear_full_lines() {
+    TETRIS_STAT_SCOPE(STAT_CLEAR_FULL_LINES);
+    RowSet cleared = FullRowFinder<Width, Height>::find(state_.rows);
+    if (cleared == 0) return 0; // 绝大多数调用没有满行
+
+    int lowest = highest_bit(cleared); // 最低的满行（行号越大越靠下），它下面的行不动
+    int write = lowest;                // 下一个保留行要写入的位置
+    for (int row = lowest - 1; row >= 0; --row) {
+        if (cleared & (static_cast<RowSet>(1) << row)) continue; // 满行直接丢弃
+        memcpy(state_.board[write], state_.board[row], sizeof(state_.board[0]));
+        state_.rows[write] = state_.rows[row];
+        write--;
+    }
+    // 顶部空出来的行清零
+    memset(state_.board[0], 0, (write + 1) * sizeof(state_.board[0]));
+    memset(state_.rows, 0, (write + 1) * sizeof(state_.rows[0]));
+    mark_rows((static_cast<RowSet>(2) << lowest) - 1); // 第0行到最低的满行全部改变（64行时移出的位回绕为全1）
+    rebuild_column_heights(); // 消行后各列表面整体下移，被消掉的行可能正是某列的表面
+
     // 根据清除的行数增加分数
+    int lines_cleared = count_bits(cleared);
     if (lines_cleared > 0) {
         // 经典俄罗斯方块的计分规则
-        if (lines_cleared == 1) score_ += 40;       // 消除1行：40分
-        else if (lines_cleared == 2) score_ += 100; // 消除2行：100分
-        else if (lines_cleared == 3) score_ += 300; // 消除3行：300分
-        else if (lines_cleared >= 4) score_ += 1200; // 消除4行：1200分（俄罗斯方块中的"Tetris"）
+        if (lines_cleared == 1) state_.score += 40;       // 消除1行：40分
+        else if (lines_cleared == 2) state_.score += 100; // 消除2行：100分
+        else if (lines_cleared == 3) state_.score += 300; // 消除3行：300分
+        else if (lines_cleared >= 4) state_.score += 1200; // 消除4行：1200分（俄罗斯方块中的"Tetris"）
     }
-    return lines_cleared; // 返回清除的行数
+    return cleared; // 返回被清除的行
+}
+
+// 获取当前棋盘状态：把过期的行从已固定的棋盘复制到合成棋盘，再叠加当前方块落在这些行中的格子
+// 连续的读取之间没有改动时直接返回缓存；方块移动一次只需要重新合成它前后占据的几行
+template <int Width, int Height>
+const int* BasicTetrisGame<Width, Height>::get_board() const {
+    RowSet stale = stale_rows_;
+    if (stale != 0) {
+        for (RowSet pending = stale; pending; pending &= pending - 1) {
+            int row = lowest_bit(pending);
+            memcpy(composed_[row], state_.board[row], sizeof(composed_[row]));
+        }
+        if (!state_.game_over) {
+            const TetrominoShape& shape = get_current_shape_data();
+            for (int i = 0; i < 4; ++i) {
+                int board_x = state_.piece_pos.x + shape.blocks[i].x;
+                int board_y = state_.piece_pos.y + shape.blocks[i].y;
+                if (board_x >= 0 && board_x < Width && board_y >= 0 && board_y < Height &&
+                    (stale & (static_cast<RowSet>(1) << board_y))) {
+                    composed_[board_y][board_x] = state_.piece_type + 1;
+                }
+            }
+        }
+        stale_rows_ = 0;
+    }
+    return &composed_[0][0]; // 返回合成棋盘的指针
 }
 
-// 获取当前棋盘状态
-const int* TetrisGame::get_board() const {
-    return &board_[0][0]; // 返回棋盘数组的指针
+// 把第y行的棋盘加上当前方块写入out_row
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::compose_row(int y, uint8_t* out_row) const {
+    for (int col = 0; col < Width; ++col) {
+        out_row[col] = static_cast<uint8_t>(state_.board[y][col]);
+    }
+    if (state_.game_over) return;
+    const TetrominoShape& shape = get_current_shape_data();
+    int row = y - state_.piece_pos.y; // 在方块形状中的相对行
+    if (row < shape.min_y || row > shape.max_y) return;
+    const int pos_x = state_.piece_pos.x;
+    uint32_t piece_row = pos_x >= 0 ? static_cast<uint32_t>(shape.row_masks[row]) << pos_x
+                                    : static_cast<uint32_t>(shape.row_masks[row]) >> -pos_x;
+    piece_row &= Traits::full_row();
+    for (; piece_row; piece_row &= piece_row - 1) {
+        out_row[lowest_bit(piece_row)] = static_cast<uint8_t>(state_.piece_type + 1);
+    }
+}
+
+// 把当前棋盘按字节写出
+template <int Width, int Height>
+void BasicTetrisGame<Width, Height>::write_board(uint8_t* out_board) const {
+    for (int row = 0; row < Height; ++row) {
+        compose_row(row, out_board + row * Width);
+    }
 }
 
 // 获取当前得分
-int TetrisGame::get_score() const {
-    return score_;
+template <int Width, int Height>
+int BasicTetrisGame<Width, Height>::get_score() const {
+    return state_.score;
+}
+
+// 获取本局累计消除的行数
+template <int Width, int Height>
+int BasicTetrisGame<Width, Height>::get_lines_cleared() const {
+    return state_.lines;
+}
+
+// 获取最近一次固定方块时消除的行
+template <int Width, int Height>
+typename BoardTraits<Width, Height>::RowSet BasicTetrisGame<Width, Height>::get_cleared_rows() const {
+    return state_.cleared_rows;
+}
+
+// 各等级的自动下落间隔：0级与原来前端的500ms节拍一致，之后逐级加快
+template <int Width, int Height>
+const int BasicTetrisGame<Width, Height>::GRAVITY_INTERVAL_MS[GRAVITY_LEVELS] = {
+    500, 450, 400, 350, 300, 260, 220, 180, 150, 120,
+    100, 100, 100, 80, 80, 80, 60, 60, 60, 40
+};
+
+// 获取当前等级
+template <int Width, int Height>
+int BasicTetrisGame<Width, Height>::get_level() const {
+    return state_.lines / LINES_PER_LEVEL;
+}
+
+// 指定等级的自动下落间隔
+template <int Width, int Height>
+int BasicTetrisGame<Width, Height>::gravity_interval_ms(int level) {
+    if (level < 0) level = 0;
+    if (level >= GRAVITY_LEVELS) level = GRAVITY_LEVELS - 1;
+    return GRAVITY_INTERVAL_MS[level];
 }
 
 // 检查游戏是否结束
-bool TetrisGame::is_game_over() const {
-    return game_over_;
+template <int Width, int Height>
+bool BasicTetrisGame<Width, Height>::is_game_over() const {
+    return state_.game_over;
+}
+
+// 获取脏行掩码
+template <int Width, int Height>
+typename BoardTraits<Width, Height>::RowSet BasicTetrisGame<Width, Height>::get_dirty_rows() const {
+    return state_.dirty_rows;
+}
+
+// 获取当前帧序号
+template <int Width, int Height>
+uint32_t BasicTetrisGame<Width, Height>::get_frame_seq() const {
+    return state_.frame_seq;
+}
+
+// 读取增量：只导出脏行
+template <int Width, int Height>
+typename BoardTraits<Width, Height>::RowSet BasicTetrisGame<Width, Height>::take_board_delta(uint8_t* out_rows, uint32_t* out_seq) {
+    RowSet dirty = state_.dirty_rows;
+    if (dirty != 0) {
+        state_.frame_seq++; // 有改动才产生新的一帧
+        uint8_t* out = out_rows;
+        for (int row = 0; row < Height; ++row) {
+            if (!(dirty & (static_cast<RowSet>(1) << row))) continue; // 跳过未改动的行
+            compose_row(row, out); // 已固定的方块加上当前方块
+            out += Width;
+        }
+        state_.dirty_rows = 0;
+    }
+    if (out_seq) *out_seq = state_.frame_seq;
+    return dirty;
+}
+
+// 读取完整棋盘（关键帧）
+template <int Width, int Height>
+uint32_t BasicTetrisGame<Width, Height>::take_board_packed(uint8_t* out_board) {
+    if (state_.dirty_rows != 0) {
+        state_.frame_seq++; // 关键帧包含了所有未读取的改动，视为新的一帧
+        state_.dirty_rows = 0;
+    }
+    write_board(out_board);
+    return state_.frame_seq;
 }
 
+// 显式实例化预先列出的尺寸：其他翻译单元只能使用这些尺寸（成员函数的定义不在头文件中）
+#define TETRIS_INSTANTIATE_BOARD(W, H) template class BasicTetrisGame<W, H>;
+TETRIS_BOARD_SIZES(TETRIS_INSTANTIATE_BOARD)
+#undef TETRIS_INSTANTIATE_BOARD
+
 //------------------------------------------------------------------------------
 // C语言风格的API函数实现
 // 这些函数为外部语言（如Python）提供了调用C++代码的接口
@@ -362,46 +764,92 @@ bool TetrisGame::is_game_over() const {
 
 // 创建游戏实例
 API_EXPORT TetrisGame* create_game() {
-    return new TetrisGame(); // 创建一个新的TetrisGame对象
+    TETRIS_STAT_SCOPE(STAT_API_CREATE_GAME);
+    return TetrisCore::instance().create_game(); // 在共享上下文的板块中原地构造，不做堆分配
+}
+
+// 用指定种子创建游戏实例
+API_EXPORT TetrisGame* create_game_seeded(uint64_t seed) {
+    TETRIS_STAT_SCOPE(STAT_API_CREATE_GAME);
+    return TetrisCore::instance().create_game(seed);
 }
 
 // 销毁游戏实例
 API_EXPORT void destroy_game(TetrisGame* game) {
-    delete game; // 释放TetrisGame对象的内存
+    TETRIS_STAT_SCOPE(STAT_API_DESTROY_GAME);
+    TetrisCore::instance().destroy_game(game); // 原地析构，槽位还回板块
 }
 
 // 开始新游戏
 API_EXPORT void start_new_game_api(TetrisGame* game) {
+    TETRIS_STAT_SCOPE(STAT_API_START_NEW_GAME);
     if (game) game->start_new_game(); // 如果game不为空，调用start_new_game方法
 }
 
+// 用指定种子开始新游戏
+API_EXPORT void start_new_game_seeded_api(TetrisGame* game, uint64_t seed) {
+    TETRIS_STAT_SCOPE(STAT_API_START_NEW_GAME);
+    if (game) game->start_new_game_seeded(seed);
+}
+
+// 设置随机方式
+API_EXPORT bool set_randomizer_api(TetrisGame* game, int randomizer) {
+    return game ? game->set_randomizer(randomizer) : false;
+}
+
 // 向左移动
 API_EXPORT bool move_left_api(TetrisGame* game) {
+    TETRIS_STAT_SCOPE(STAT_API_MOVE_LEFT);
     return game ? game->move_left() : false; // 如果game不为空，调用move_left方法
 }
 
 // 向右移动
 API_EXPORT bool move_right_api(TetrisGame* game) {
+    TETRIS_STAT_SCOPE(STAT_API_MOVE_RIGHT);
     return game ? game->move_right() : false; // 如果game不为空，调用move_right方法
 }
 
 // 旋转方块
 API_EXPORT bool rotate_piece_api(TetrisGame* game) {
+    TETRIS_STAT_SCOPE(STAT_API_ROTATE_PIECE);
     return game ? game->rotate_piece() : false; // 如果game不为空，调用rotate_piece方法
 }
 
 // 直接下落
 API_EXPORT void drop_piece_api(TetrisGame* game) {
+    TETRIS_STAT_SCOPE(STAT_API_DROP_PIECE);
     if (game) game->drop_piece(); // 如果game不为空，调用drop_piece方法
 }
 
 // 游戏时钟
 API_EXPORT bool game_tick_api(TetrisGame* game) {
+    TETRIS_STAT_SCOPE(STAT_API_GAME_TICK);
     return game ? game->game_tick() : false; // 如果game不为空，调用game_tick方法
 }
 
+// 为游戏分配输入队列
+API_EXPORT void enable_input_queue_api(TetrisGame* game) {
+    if (game) game->enable_input_queue();
+}
+
+// 把动作放进输入队列
+API_EXPORT bool enqueue_input_api(TetrisGame* game, int action, uint64_t timestamp_us) {
+    if (!game) return false;
+    return game->enqueue_input(action, timestamp_us ? timestamp_us : InputQueue::now_us());
+}
+
+// 执行排队的输入并推进游戏
+API_EXPORT int drain_and_step_api(TetrisGame* game, int max_inputs, int ticks, uint64_t* out_max_wait_us) {
+    if (!game) {
+        if (out_max_wait_us) *out_max_wait_us = 0;
+        return 0;
+    }
+    return game->drain_inputs_and_step(max_inputs, ticks, out_max_wait_us);
+}
+
 // 获取棋盘状态
 API_EXPORT const int* get_board_api(TetrisGame* game) {
+    TETRIS_STAT_SCOPE(STAT_API_GET_BOARD);
     return game ? game->get_board() : nullptr; // 如果game不为空，调用get_board方法
 }
 
@@ -415,6 +863,90 @@ API_EXPORT bool is_game_over_api(TetrisGame* game) {
     return game ? game->is_game_over() : true; // 如果game不为空，调用is_game_over方法
 }
 
+// 获取当前等级的API
+API_EXPORT int get_level_api(TetrisGame* game) {
+    return game ? game->get_level() : 0;
+}
+
+// 获取落点预览的API
+API_EXPORT bool get_ghost_position_api(TetrisGame* game, int* out_x, int* out_y, int* out_cells) {
+    Point pos;
+    if (!game || !game->get_ghost_position(&pos)) return false;
+    if (out_x) *out_x = pos.x;
+    if (out_y) *out_y = pos.y;
+    if (out_cells) {
+        const GameState& state = game->get_state();
+        const TetrominoShape& shape = PieceTable::shape(state.piece_type, state.rotation);
+        for (int i = 0; i < 4; ++i) {
+            out_cells[i * 2] = pos.x + shape.blocks[i].x;
+            out_cells[i * 2 + 1] = pos.y + shape.blocks[i].y;
+        }
+    }
+    return true;
+}
+
+// 获取后续方块预览的API
+API_EXPORT int get_next_pieces_api(TetrisGame* game, int n, int* out_types) {
+    return game && out_types ? game->get_next_pieces(out_types, n) : 0;
+}
+
+// 获取指定等级的自动下落间隔的API
+API_EXPORT int get_gravity_interval_ms_api(int level) {
+    return TetrisGame::gravity_interval_ms(level);
+}
+
+// 读取脏行增量
+API_EXPORT uint32_t get_board_delta_api(TetrisGame* game, uint8_t* out_rows, uint32_t* out_seq) {
+    TETRIS_STAT_SCOPE(STAT_API_GET_BOARD_DELTA);
+    if (!game || !out_rows) {
+        if (out_seq) *out_seq = 0;
+        return 0;
+    }
+    return game->take_board_delta(out_rows, out_seq);
+}
+
+// 获取最近一次固定方块时消除的行
+API_EXPORT uint32_t get_cleared_rows_api(TetrisGame* game) {
+    return game ? game->get_cleared_rows() : 0;
+}
+
+// 读取完整棋盘（关键帧）
+API_EXPORT uint32_t get_board_packed_api(TetrisGame* game, uint8_t* out_board) {
+    TETRIS_STAT_SCOPE(STAT_API_GET_BOARD_PACKED);
+    return (game && out_board) ? game->take_board_packed(out_board) : 0;
+}
+
+// 开启/关闭回放记录
+API_EXPORT void set_replay_recording_api(TetrisGame* game, bool enabled) {
+    if (game) game->set_replay_recording(enabled);
+}
+
+// 获取当前这一局的回放日志
+API_EXPORT const uint8_t* get_replay_log_api(TetrisGame* game, size_t* out_size) {
+    if (!game) {
+        if (out_size) *out_size = 0;
+        return nullptr;
+    }
+    const ReplayLog& log = game->get_replay_log();
+    if (out_size) *out_size = log.size();
+    return log.data();
+}
+
+// 获取状态快照的字节数
+API_EXPORT size_t get_state_size_api() {
+    return sizeof(GameState);
+}
+
+// 保存当前状态
+API_EXPORT void clone_state_api(TetrisGame* game, GameState* out_state) {
+    if (game && out_state) memcpy(out_state, &game->get_state(), sizeof(GameState));
+}
+
+// 恢复到保存的状态
+API_EXPORT void restore_state_api(TetrisGame* game, const GameState* state) {
+    if (game && state) game->restore_state(*state);
+}
+
 // 获取棋盘宽度
 API_EXPORT int get_board_width_api() {
     return BOARD_WIDTH; // 返回棋盘宽度常量
@@ -5,44 +5,168 @@
 #define TETRIS_GAME_H
 
 // 包含必要的标准库
-#include <vector>       // 用于存储可变大小的数组（方块定义）
 #include <string>       // 字符串操作（可能用于扩展功能）
-#include <cstdlib>      // 包含rand(), srand()等随机数生成函数
-#include <ctime>        // 用于time()函数，为随机数生成器提供种子
 #include <cstring>      // 用于内存操作函数如memcpy(), memset()
+#include <cstdint>      // 固定宽度整数类型，用于位棋盘的行掩码
+#include <type_traits>  // 检查GameState是否可以按字节复制
+#include "tetris_pieces.h" // 所有游戏共享的只读方块表
+#include "tetris_random.h" // 每局游戏独立的随机数生成器
+#include "tetris_randomizer.h" // 方块生成器和预览队列
+#include "tetris_replay.h" // 回放日志
+
+class InputQueue; // 多线程输入队列（见tetris_input_queue.h），只有会话中的游戏才分配
 
 // 定义棋盘维度（常量）
+// 这是标准棋盘的尺寸：TetrisGame、C API、回放和存档格式、会话、求解器都使用它
+// 其他尺寸见下面的BasicTetrisGame和tetris_sized_game.h
 const int BOARD_WIDTH = 10;   // 棋盘宽度，即列数
 const int BOARD_HEIGHT = 20;  // 棋盘高度，即行数
 
-// 定义一个二维点或坐标的结构体
-// 在游戏中用于表示方块位置和相对位置
-struct Point {
-    int x;  // 水平坐标（列）
-    int y;  // 垂直坐标（行）
+// 位棋盘（bitboard）：棋盘的每一行用一个16位掩码（RowMask）表示占用情况
+// 第x位为1表示该行第x列有方块，颜色另存于颜色平面中
+static_assert(BOARD_WIDTH <= 16, "RowMask只能容纳16列");
+const RowMask FULL_ROW_MASK = static_cast<RowMask>((1u << BOARD_WIDTH) - 1); // 满行掩码：低BOARD_WIDTH位全为1
+
+// 预先实例化的棋盘尺寸（宽, 高）
+// 棋盘引擎是以宽高为模板参数的类模板，成员函数定义在tetris_game.cpp中，只为这里列出的尺寸显式实例化；
+// create_game_sized按这个列表在运行时选择对应的实例。新增尺寸只需要在这里加一项
+#define TETRIS_BOARD_SIZES(X) \
+    X(6, 12)   \
+    X(8, 16)   \
+    X(10, 20)  \
+    X(10, 40)  \
+    X(16, 32)  \
+    X(20, 20)  \
+    X(32, 32)
+
+// 指定尺寸的棋盘用到的整数类型，全部在编译期确定
+// 宽度不超过16列时行掩码是uint16_t（标准棋盘，满行判断可以走SIMD），不超过32列时是uint32_t；
+// 脏行、过期行、消行这些“行集合”掩码在不超过32行时是uint32_t，否则是uint64_t
+template <int Width, int Height>
+struct BoardTraits {
+    static_assert(Width >= 4 && Width <= 32, "棋盘宽度必须在4到32列之间");
+    static_assert(Height >= 4 && Height <= 64, "棋盘高度必须在4到64行之间");
+
+    typedef typename std::conditional<(Width <= 16), uint16_t, uint32_t>::type Row;    // 一行的占用掩码
+    typedef typename std::conditional<(Height <= 32), uint32_t, uint64_t>::type RowSet; // 行集合：第r位表示第r行
+
+    // 满行掩码：低Width位全为1
+    static constexpr Row full_row() {
+        return static_cast<Row>((1ull << Width) - 1);
+    }
+
+    // 所有行的集合：低Height位全为1（64行时移位会越界，单独处理）
+    static constexpr RowSet all_rows() {
+        return static_cast<RowSet>(Height == 64 ? ~0ull : (1ull << (Height % 64)) - 1);
+    }
+};
+
+// 游戏动作编码
+// 批量接口等需要用一个字节描述一次操作的场景共用这套编码
+enum TetrisAction {
+    ACTION_NONE = 0,    // 不执行任何操作
+    ACTION_LEFT = 1,    // 向左移动
+    ACTION_RIGHT = 2,   // 向右移动
+    ACTION_ROTATE = 3,  // 顺时针旋转
+    ACTION_DROP = 4,    // 硬降
+    ACTION_TICK = 5,    // 游戏时钟（下落一格）
+    ACTION_COUNT = 6    // 动作种类数量（不是有效动作）
 };
 
-// 定义一个俄罗斯方块形状的结构体
-// 包含方块的组成部分和尺寸信息
-struct TetrominoShape {
-    Point blocks[4];  // 存储4个组成块相对于锚点的坐标
-    int width;        // 方块边界框的宽度
-    int height;       // 方块边界框的高度
+// 一局游戏的全部可变状态
+// 这是一个POD结构体：复制/保存/恢复一局游戏只需要一次memcpy，
+// 机器人和提示功能可以低成本地尝试走法再回退
+//
+// 棋盘只保存已固定的方块；正在下落的当前方块由piece_type/rotation/piece_pos描述，
+// 不写进棋盘（它是叠加在棋盘上的一层），移动和旋转只修改这几个字段，方块固定时才写棋盘
+template <int Width, int Height>
+struct BasicGameState {
+    typedef typename BoardTraits<Width, Height>::Row Row;
+    typedef typename BoardTraits<Width, Height>::RowSet RowSet;
+
+    // 已固定方块的颜色平面：0表示空格，1-7表示不同颜色的方块（不包括当前方块）
+    int board[Height][Width];
+
+    // 已固定方块的占用层：每行一个位掩码，与board始终保持一致
+    // 碰撞检测和满行判断只需要读这一层
+    Row rows[Height];
+
+    // 每列已固定方块的表面高度：该列最高的已固定方块到棋盘底部的行数（空列为0）
+    // 不包括当前方块；方块固定时和消行后增量更新，硬降和落点预览据此直接算出落点
+    uint8_t column_heights[Width];
+
+    RowSet dirty_rows;   // 脏行掩码：第r位表示第r行自上次读取增量以来被修改过
+    uint32_t frame_seq;  // 帧序号：每读取一次非空增量加1
+
+    int score;       // 当前游戏得分
+    int lines;       // 本局累计消除的行数
+    RowSet cleared_rows; // 最近一次固定方块时消除的行：第r位表示消除前的第r行（没有消行时为0）
+    bool game_over;  // 游戏是否结束的标志
+
+    int piece_type;   // 当前方块的类型（0-6）
+    int rotation;     // 当前方块的旋转状态（0-3）
+    Point piece_pos;  // 当前方块在棋盘上的位置（左上角锚点）
+
+    int tick_speed_control;   // 控制自动下落速度的计数器
+
+    TetrisRng rng;    // 本局游戏的随机数生成器（决定方块序列）
+    PieceQueue next_pieces; // 接下来要出现的方块和随机方式的状态（当前方块已经从中取出）
 };
 
+// 标准棋盘的状态：回放、存档、求解器、对象池等都按这个布局读写
+typedef BasicGameState<BOARD_WIDTH, BOARD_HEIGHT> GameState;
+static_assert(std::is_same<GameState::RowSet, uint32_t>::value, "标准棋盘的脏行掩码是32位");
+static_assert(std::is_trivially_copyable<GameState>::value, "GameState必须可以按字节复制");
+
 // 俄罗斯方块游戏核心逻辑的主类
 // 管理游戏状态、方块移动和游戏规则
-class TetrisGame {
+//
+// 棋盘尺寸是模板参数：每个实例的行掩码类型、棋盘数组和所有按行/按列的循环边界都是编译期常量，
+// 不需要为可变尺寸在每个热路径上付出运行时的代价。只有TETRIS_BOARD_SIZES中的尺寸被实例化；
+// 标准尺寸的实例就是TetrisGame
+template <int Width, int Height>
+class BasicTetrisGame {
 public:
-    // 构造函数：初始化游戏对象
-    TetrisGame();
+    typedef BoardTraits<Width, Height> Traits;
+    typedef typename Traits::Row Row;        // 行掩码类型
+    typedef typename Traits::RowSet RowSet;  // 行集合掩码类型
+    typedef BasicGameState<Width, Height> State;
+
+    static const int WIDTH = Width;   // 棋盘宽度
+    static const int HEIGHT = Height; // 棋盘高度
+
+    // 构造函数：初始化游戏对象，随机数种子由进程内的种子序列自动生成
+    // （同一秒内创建的多局游戏也会得到不同的种子）
+    BasicTetrisGame();
+
+    // 构造函数：使用指定的种子，之后的所有开局和方块序列都可以复现
+    explicit BasicTetrisGame(uint64_t seed);
     
     // 析构函数：清理游戏资源
-    ~TetrisGame();
+    ~BasicTetrisGame();
 
     // 开始新游戏：重置棋盘、分数和游戏状态
+    // 本局的种子从游戏自身的随机数生成器中派生
     void start_new_game();
 
+    // 用指定的种子开始新游戏（回放引擎用它复现一局游戏）
+    void start_new_game_seeded(uint64_t seed);
+
+    // 设置方块类型的随机方式（见RandomizerKind），从下一次开局起生效
+    // 进行中的这一局不受影响：它的方块序列和回放日志头部记录的随机方式保持一致
+    // 新建的游戏默认使用7袋；无效的编码返回false
+    bool set_randomizer(int randomizer);
+
+    // 下一次开局将使用的随机方式（即最近一次set_randomizer设置的值）
+    int get_randomizer() const;
+
+    // 回放日志记录
+    // 开启后从下一次开局起记录本局的种子和所有动作；关闭时清空日志
+    void set_replay_recording(bool enabled);
+    
+    // 获取当前这一局的回放日志（格式见tetris_replay.h）
+    const ReplayLog& get_replay_log() const;
+
     // 游戏控制函数 - 返回true表示操作成功执行
     
     // 将当前方块向左移动一格
@@ -64,70 +188,187 @@ public:
     // 如果游戏仍在继续，返回true；如果游戏结束，返回false
     bool game_tick();
 
+    // 按动作编码执行一次操作（见TetrisAction）
+    // 返回对应操作函数的返回值；drop和none总是返回true，无效编码返回false
+    bool apply_action(int action);
+
     // 获取游戏状态函数
     
-    // 获取当前棋盘状态的指针
+    // 获取当前棋盘状态的指针（已固定的方块加上当前方块）
     // 返回一维数组指针，按行优先顺序存储棋盘
+    // 合成结果缓存在游戏对象中，只重新合成上次读取之后改动过的行；指针在下一次修改游戏前有效
     const int* get_board() const;
+
+    // 把当前棋盘（已固定的方块加上当前方块）按行优先写入Height * Width字节
+    // 直接从棋盘和当前方块合成，不读写缓存，也不影响脏行和帧序号
+    void write_board(uint8_t* out_board) const;
     
     // 获取当前得分
     int get_score() const;
+
+    // 获取本局累计消除的行数
+    int get_lines_cleared() const;
+
+    // 获取最近一次固定方块时消除的行（消除前的行号掩码），渲染消行动画或编码增量时使用
+    RowSet get_cleared_rows() const;
+
+    // 获取当前等级：每消除LINES_PER_LEVEL行升一级
+    int get_level() const;
+
+    // 指定等级下方块自动下落一格（一次game_tick）的间隔（毫秒），等级越高越快
+    static int gravity_interval_ms(int level);
+
+    static const int LINES_PER_LEVEL = 10; // 升一级需要消除的行数
     
     // 检查游戏是否结束
     bool is_game_over() const;
 
-private:
-    // 原始方块形状的整数编码数据
-    // 来自原始tinytetris的数据，通过位操作解码使用
-    static const int initial_block_data[7][4];
+    // 后续方块预览：把接下来的最多n个方块类型（0-6）按出现顺序写入out_types
+    // 返回写入的个数（最多PieceQueue::PREVIEW_MAX个；游戏已结束时为0）
+    int get_next_pieces(int* out_types, int n) const;
+
+    // 落点预览（ghost piece）：当前方块硬降后的锚点位置，旋转状态不变
+    // 游戏已结束时返回false
+    bool get_ghost_position(Point* out_pos) const;
+
+    // 增量棋盘导出（脏行跟踪）
+    // 每次棋盘被修改时记录改动的行；读取增量会清空脏行并推进帧序号，
+    // 每个帧序号对应唯一的棋盘状态，客户端据此判断是否漏掉了帧
+
+    // 获取自上次读取以来改动过的行：第r位为1表示第r行改动过
+    RowSet get_dirty_rows() const;
+
+    // 获取当前帧序号
+    uint32_t get_frame_seq() const;
+
+    // 读取增量：把所有脏行按行号从小到大依次写入out_rows（每行Width字节）
+    // out_rows至少需要Height * Width字节；out_seq接收本帧序号（可为nullptr）
+    // 返回脏行掩码；没有改动时返回0且帧序号不变
+    RowSet take_board_delta(uint8_t* out_rows, uint32_t* out_seq);
+
+    // 读取完整棋盘（关键帧）：按行优先写入Height * Width字节
+    // 同时清空脏行，返回该棋盘对应的帧序号
+    uint32_t take_board_packed(uint8_t* out_board);
+
+    // 输入队列（见tetris_input_queue.h）
+    // 队列不属于GameState：快照和恢复不影响排队中的输入
+    // 只有会话中的游戏需要队列，游戏对象里只放一个指针，由注册表在把游戏交给会话时分配；
+    // 池、批量环境、求解器的临时实例等其他游戏不为它付出空间
 
-    // 解码后的方块形状数据：第一维是方块类型，第二维是旋转状态
-    std::vector<std::vector<TetrominoShape>> piece_definitions_;
+    // 分配输入队列（已有时什么也不做）。必须在其他线程能够访问这局游戏之前调用
+    void enable_input_queue();
 
-    // 游戏棋盘：0表示空格，1-7表示不同颜色的方块
-    int board_[BOARD_HEIGHT][BOARD_WIDTH];
+    // 把动作放进本局的输入队列：任意线程都可以调用，不加锁也不修改游戏
+    // timestamp_us是入队时间（InputQueue::now_us的时钟）；没有队列、队列已满或动作编码无效时返回false
+    bool enqueue_input(int action, uint64_t timestamp_us);
+
+    // 按入队顺序执行队列中的输入（最多max_inputs个，<=0表示全部），再执行ticks次游戏时钟
+    // （游戏结束后不再执行）。只能由当前持有这局游戏的线程调用，同一时刻只能有一个
+    // 返回执行的输入数；out_max_wait_us（可为nullptr）接收其中最长的排队时间（微秒）
+    int drain_inputs_and_step(int max_inputs, int ticks, uint64_t* out_max_wait_us);
+
+    // 丢弃排队中的输入（游戏实例被回收复用时调用，调用方的要求同drain_inputs_and_step）
+    void discard_inputs();
+
+    // 状态快照
     
-    int score_;       // 当前游戏得分
-    bool game_over_;  // 游戏是否结束的标志
+    // 获取当前的全部可变状态（只读）
+    const State& get_state() const;
+
+    // 用快照覆盖当前状态（一次memcpy）
+    // 快照不包含回放日志：恢复后当前这一局的回放日志不再有效，会被清空，
+    // 从下一次开局起重新记录
+    void restore_state(const State& state);
+
+private:
+    BasicTetrisGame(const BasicTetrisGame&);            // 禁止复制（输入队列归这个对象所有）
+    BasicTetrisGame& operator=(const BasicTetrisGame&); // 禁止赋值
+
+    friend class TetrisBench; // 基准测试程序（tetris_bench.cpp）需要单独测量碰撞检测、消行等内部函数
+
+    // 各等级的自动下落间隔（毫秒），超过最后一级的等级沿用最后一级的速度
+    static const int GRAVITY_LEVELS = 20;
+    static const int GRAVITY_INTERVAL_MS[GRAVITY_LEVELS];
 
-    int current_piece_type_;   // 当前方块的类型（0-6）
-    int current_rotation_;     // 当前方块的旋转状态（0-3）
-    Point current_piece_pos_;  // 当前方块在棋盘上的位置（左上角锚点）
+    State state_;              // 本局游戏的全部可变状态
+    ReplayLog replay_log_;     // 本局的回放日志
+    bool recording_;           // 是否记录回放日志
+    uint8_t pending_randomizer_; // 下一次开局使用的随机方式，开局时才复制到预览队列
+    InputQueue* input_queue_;  // 其他线程送来的输入，由持有游戏的线程执行（未分配时为nullptr）
 
-    int tick_speed_control_;   // 控制自动下落速度的计数器
-    static const int FALL_SPEED_THRESHOLD = 30;  // 下落速度阈值
+    // get_board()返回的合成棋盘（已固定的方块加上当前方块），只在读取时更新
+    mutable int composed_[Height][Width];
+    mutable RowSet stale_rows_; // 合成棋盘中过期的行：第r位表示第r行自上次合成以来改动过
 
     // 辅助函数
     
-    // 初始化所有方块形状的定义
-    void initialize_piece_definitions();
-    
-    // 从整数编码中提取2位值（位操作辅助函数）
-    int get_two_bit_value(int piece_raw_data, int bit_offset) const;
+    // 构造函数的公共初始化部分
+    void initialize(uint64_t seed);
 
+    // 记录一个动作到回放日志（未开启记录时什么也不做）
+    void record_action(int action);
+    
     // 在棋盘上生成新的方块
     void spawn_new_piece();
     
     // 检查方块在给定位置和旋转状态下是否会发生碰撞
     bool check_collision(Point pos, int piece_type, int rotation) const;
 
-    // 在棋盘上放置或移除方块
+    // 在已固定的棋盘上放置或移除方块（方块固定时写入棋盘）
     // value为0表示移除，value>0表示放置（value对应方块颜色）
     void place_or_remove_piece(Point pos, int piece_type, int rotation, int value);
 
+    // 当前方块占据的行需要重新发送和重新合成：方块移动或旋转前后各调用一次
+    void touch_piece_rows();
+
+    // 标记改动过的行（脏行和合成棋盘的过期行）
+    void mark_rows(RowSet rows) {
+        state_.dirty_rows |= rows;
+        stale_rows_ |= rows;
+    }
+
+    // 把第y行的棋盘加上当前方块写入out_row（每个格子一个字节）
+    void compose_row(int y, uint8_t* out_row) const;
+
     // 将当前方块固定在棋盘上，并检查行消除和游戏状态
     void solidify_current_piece();
     
-    // 清除已满的行并返回清除的行数
-    int clear_full_lines();
+    // 清除已满的行，返回被清除的行的掩码（第r位表示消除前的第r行）
+    RowSet clear_full_lines();
 
-    // 获取特定类型和旋转状态的方块形状数据
-    const TetrominoShape& get_shape_data(int piece_type, int rotation) const;
+    // 获取特定类型和旋转状态的方块形状数据（直接访问编译期方块表）
+    static const TetrominoShape& get_shape_data(int piece_type, int rotation) {
+        return PieceTable::shape(piece_type, rotation);
+    }
     
+    // 当前方块硬降后的锚点y（不修改棋盘）
+    // 方块在表面之上时，由每列的表面高度和方块的底部轮廓直接算出，只看方块占用的几列；
+    // 方块已经塞进悬空方块下方时退回逐行下移检查
+    int find_landing_y() const;
+
+    // 逐行下移检查落点（find_landing_y的后备路径）
+    int scan_landing_y() const;
+
+    // 方块固定后更新它占用的各列的表面高度
+    void raise_column_heights();
+
+    // 由占用层重新计算所有列的表面高度（消行后调用）
+    void rebuild_column_heights();
+
     // 获取当前方块的形状数据
-    const TetrominoShape& get_current_shape_data() const;
+    const TetrominoShape& get_current_shape_data() const {
+        return PieceTable::shape(state_.piece_type, state_.rotation);
+    }
 };
 
+// 标准尺寸的游戏：C API、会话、批量接口、回放、存档和求解器都使用它
+typedef BasicTetrisGame<BOARD_WIDTH, BOARD_HEIGHT> TetrisGame;
+
+// 游戏对象只比GameState多一份合成棋盘缓存和几个标量字段：会话、池、批量环境中的每局游戏都要付出这些空间，
+// 新增的按游戏数据（例如只有部分游戏才用到的缓冲区）应该按需分配，不要直接放进游戏对象
+static_assert(sizeof(TetrisGame) <= sizeof(GameState) + sizeof(int) * BOARD_WIDTH * BOARD_HEIGHT + 64,
+              "TetrisGame比状态加合成棋盘大得太多");
+
 // 为不同操作系统定义导出宏，用于创建动态链接库
 #ifdef _WIN32
     #define API_EXPORT __declspec(dllexport)  // Windows导出符号
@@ -139,13 +380,20 @@ private:
 // extern "C" 确保函数名不被C++编译器修饰，使得其他语言（如Python）可以调用这些函数
 extern "C" {
     // 创建游戏实例
+    // 实例在共享上下文的板块中原地构造（见tetris_core.h），不做堆分配
     API_EXPORT TetrisGame* create_game();
+
+    // 用指定种子创建游戏实例（方块序列可复现）
+    API_EXPORT TetrisGame* create_game_seeded(uint64_t seed);
     
-    // 销毁游戏实例
+    // 销毁游戏实例（只能是create_game/create_game_seeded返回的实例），槽位还回板块
     API_EXPORT void destroy_game(TetrisGame* game);
     
     // 开始新游戏
     API_EXPORT void start_new_game_api(TetrisGame* game);
+    API_EXPORT void start_new_game_seeded_api(TetrisGame* game, uint64_t seed); // 用指定种子开始新游戏
+    // 设置方块类型的随机方式（0均匀、1七袋、2历史，见RandomizerKind），从下一次开局起生效，不影响进行中的一局；无效时返回false
+    API_EXPORT bool set_randomizer_api(TetrisGame* game, int randomizer);
 
     // 游戏控制函数
     API_EXPORT bool move_left_api(TetrisGame* game);
@@ -154,10 +402,52 @@ extern "C" {
     API_EXPORT void drop_piece_api(TetrisGame* game);
     API_EXPORT bool game_tick_api(TetrisGame* game); // 推进游戏一个节拍，返回!game_over
 
+    // 输入队列函数（多线程服务）
+    // 为游戏分配输入队列（已有时什么也不做）：只有会话中的游戏自动带队列，
+    // create_game/create_game_seeded返回的游戏要使用下面两个函数，必须先在其他线程能够访问游戏之前调用一次
+    API_EXPORT void enable_input_queue_api(TetrisGame* game);
+    // 把动作（TetrisAction）放进游戏的输入队列：分配过队列之后任意线程都可以调用，不加锁；timestamp_us为0时使用当前时间
+    // 调用方必须保证game在调用期间有效；会话中的游戏请改用enqueue_session_input_api（见tetris_session.h）
+    // 游戏没有输入队列（没有调用过enable_input_queue_api）、队列已满或动作无效时返回false，
+    // 调用方可以改为持有游戏后直接调用操作函数
+    API_EXPORT bool enqueue_input_api(TetrisGame* game, int action, uint64_t timestamp_us);
+    // 由持有游戏的线程调用：按入队顺序执行最多max_inputs个输入（<=0表示全部），再执行ticks次游戏时钟
+    // 返回执行的输入数；out_max_wait_us可为NULL，否则接收其中最长的排队时间（微秒）
+    API_EXPORT int drain_and_step_api(TetrisGame* game, int max_inputs, int ticks, uint64_t* out_max_wait_us);
+
     // 获取游戏状态函数
-    API_EXPORT const int* get_board_api(TetrisGame* game); // 获取棋盘数据
+    API_EXPORT const int* get_board_api(TetrisGame* game); // 获取棋盘数据（已固定的方块加上当前方块）
     API_EXPORT int get_score_api(TetrisGame* game);        // 获取得分
     API_EXPORT bool is_game_over_api(TetrisGame* game);    // 检查游戏是否结束
+    API_EXPORT int get_level_api(TetrisGame* game);        // 获取当前等级
+    API_EXPORT int get_gravity_interval_ms_api(int level); // 获取指定等级的自动下落间隔（毫秒）
+    // 获取落点预览（当前方块硬降后的位置），前端据此绘制虚影；游戏已结束时返回false
+    // out_x/out_y接收锚点；out_cells可为NULL，否则接收4个组成块的(x, y)共8个整数
+    API_EXPORT bool get_ghost_position_api(TetrisGame* game, int* out_x, int* out_y, int* out_cells);
+    // 获取后续方块预览：把接下来的最多n个方块类型（0-6）写入out_types，返回写入的个数
+    // （最多PieceQueue::PREVIEW_MAX即8个；游戏已结束时为0）
+    API_EXPORT int get_next_pieces_api(TetrisGame* game, int n, int* out_types);
+
+    // 增量棋盘导出函数（每个格子一个字节）
+    // 读取脏行：按行号升序写入out_rows，返回脏行掩码，out_seq接收帧序号
+    API_EXPORT uint32_t get_board_delta_api(TetrisGame* game, uint8_t* out_rows, uint32_t* out_seq);
+    // 获取最近一次固定方块时消除的行：第r位表示消除前的第r行
+    API_EXPORT uint32_t get_cleared_rows_api(TetrisGame* game);
+    // 读取完整棋盘（关键帧），返回帧序号
+    API_EXPORT uint32_t get_board_packed_api(TetrisGame* game, uint8_t* out_board);
+    
+    // 回放日志函数
+    API_EXPORT void set_replay_recording_api(TetrisGame* game, bool enabled); // 开启/关闭回放记录
+    // 获取当前这一局的回放日志，out_size接收字节数；没有日志时返回NULL
+    API_EXPORT const uint8_t* get_replay_log_api(TetrisGame* game, size_t* out_size);
+    // 重新模拟一段回放日志，输出最终分数和结束标志；日志无效时返回false
+    API_EXPORT bool replay_log_api(const uint8_t* data, size_t size, int* out_score, bool* out_game_over);
+    
+    // 状态快照函数
+    // GameState是固定大小的POD结构体，调用方按get_state_size_api()分配缓冲区
+    API_EXPORT size_t get_state_size_api();
+    API_EXPORT void clone_state_api(TetrisGame* game, GameState* out_state);      // 保存当前状态
+    API_EXPORT void restore_state_api(TetrisGame* game, const GameState* state);  // 恢复到保存的状态
     
     // 获取棋盘尺寸的工具函数
     API_EXPORT int get_board_width_api();   // 返回棋盘宽度
@@ -0,0 +1,205 @@
+// tetris_gravity.cpp
+// 服务器端重力调度器的实现
+#include "tetris_gravity.h"
+#include "tetris_thread_pool.h"
+#include <algorithm> // std::min
+#include <chrono>    // 驱动线程的节拍计时
+
+// 每个线程池任务处理的会话数：一次game_tick只要几十纳秒，太小的任务分发开销比执行还大
+static const int FIRE_CHUNK = 64;
+
+// 获取进程内唯一的调度器
+GravityScheduler& GravityScheduler::instance() {
+    static GravityScheduler scheduler;
+    return scheduler;
+}
+
+GravityScheduler::GravityScheduler()
+    : next_generation_(0), tick_ms_(DEFAULT_TICK_MS), running_(false), stop_requested_(false) {
+    // 先构造驱动线程会用到的单例：局部静态对象按构造的相反顺序析构，
+    // 保证进程退出时它们在调度器停止之后才被析构
+    SessionRegistry::instance();
+    ThreadPool::shared();
+}
+
+GravityScheduler::~GravityScheduler() {
+    stop();
+}
+
+// 启动驱动线程
+bool GravityScheduler::start(int tick_ms) {
+    std::lock_guard<std::mutex> run_lock(run_mutex_);
+    if (running_.load()) return false;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        tick_ms_ = tick_ms > 0 ? tick_ms : DEFAULT_TICK_MS;
+    }
+    stop_requested_ = false;
+    running_.store(true);
+    driver_ = std::thread(&GravityScheduler::run, this);
+    return true;
+}
+
+// 停止驱动线程
+void GravityScheduler::stop() {
+    {
+        std::lock_guard<std::mutex> run_lock(run_mutex_);
+        if (!running_.load()) return;
+        stop_requested_ = true;
+    }
+    stop_cv_.notify_all();
+    driver_.join();
+    running_.store(false);
+}
+
+// 把等级对应的下落间隔换算成节拍数（向上取整，至少1个节拍）
+uint64_t GravityScheduler::interval_ticks(int level) const {
+    int interval = TetrisGame::gravity_interval_ms(level);
+    return static_cast<uint64_t>((interval + tick_ms_ - 1) / tick_ms_);
+}
+
+// 登记会话
+bool GravityScheduler::add(SessionId id) {
+    // 先读出当前等级（不能在持有mutex_时锁会话，否则会与fire中的加锁顺序相反）
+    TetrisGame* game = SessionRegistry::instance().acquire(id, false);
+    if (!game) return false;
+    int level = game->get_level();
+    SessionRegistry::instance().release(id);
+
+    std::lock_guard<std::mutex> lock(mutex_);
+    uint32_t generation = ++next_generation_;
+    generations_[id] = generation; // 已登记时旧的定时器因版本号不匹配而作废
+    wheel_.schedule(id, generation, interval_ticks(level));
+    return true;
+}
+
+// 取消登记：时间轮里的定时器留在原处，到期时因找不到登记而被忽略
+bool GravityScheduler::remove(SessionId id) {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return generations_.erase(id) > 0;
+}
+
+// 已登记的会话数量
+int GravityScheduler::size() {
+    std::lock_guard<std::mutex> lock(mutex_);
+    return static_cast<int>(generations_.size());
+}
+
+// 推进时间轮并执行到期的下落
+int GravityScheduler::advance(uint64_t ticks) {
+    std::vector<TimerEntry> due;
+    {
+        std::lock_guard<std::mutex> lock(mutex_);
+        wheel_.advance_to(wheel_.now() + ticks, due);
+        // 去掉已取消（未登记或已重新登记）的定时器
+        size_t kept = 0;
+        for (size_t i = 0; i < due.size(); ++i) {
+            std::unordered_map<SessionId, uint32_t>::const_iterator it = generations_.find(due[i].key);
+            if (it != generations_.end() && it->second == due[i].generation) {
+                due[kept++] = due[i];
+            }
+        }
+        due.resize(kept);
+    }
+    return due.empty() ? 0 : fire(due);
+}
+
+// 对到期的会话执行下落
+int GravityScheduler::fire(const std::vector<TimerEntry>& due) {
+    // 下落后的等级，-1表示不再继续（会话已过期或游戏已结束）
+    std::vector<int> next_level(due.size());
+    auto fire_range = [&due, &next_level](size_t begin, size_t end) {
+        SessionRegistry& registry = SessionRegistry::instance();
+        for (size_t i = begin; i < end; ++i) {
+            TetrisGame* game = registry.acquire(due[i].key, false);
+            if (!game) {
+                next_level[i] = -1;
+                continue;
+            }
+            // 先按顺序执行其他线程排进输入队列的按键，再下落一格
+            game->drain_inputs_and_step(0, 1, nullptr);
+            next_level[i] = game->is_game_over() ? -1 : game->get_level();
+            registry.release_changed(due[i].key); // 推送流在这里醒来发送新的一帧
+        }
+    };
+
+    int count = static_cast<int>(due.size());
+    if (count <= FIRE_CHUNK) {
+        fire_range(0, due.size());
+    } else {
+        int chunks = (count + FIRE_CHUNK - 1) / FIRE_CHUNK;
+        ThreadPool::shared().parallel_for(chunks, [&fire_range, count](int chunk) {
+            size_t begin = static_cast<size_t>(chunk) * FIRE_CHUNK;
+            size_t end = std::min(begin + FIRE_CHUNK, static_cast<size_t>(count));
+            fire_range(begin, end);
+        });
+    }
+
+    // 重新登记下一次下落
+    int fired = 0;
+    std::lock_guard<std::mutex> lock(mutex_);
+    for (size_t i = 0; i < due.size(); ++i) {
+        if (next_level[i] >= 0) fired++;
+        std::unordered_map<SessionId, uint32_t>::iterator it = generations_.find(due[i].key);
+        if (it == generations_.end() || it->second != due[i].generation) continue; // 执行期间被取消或重新登记
+        if (next_level[i] < 0) {
+            generations_.erase(it); // 游戏结束后由下一次开局重新登记
+        } else {
+            wheel_.schedule(due[i].key, due[i].generation, interval_ticks(next_level[i]));
+        }
+    }
+    return fired;
+}
+
+// 驱动线程主循环
+void GravityScheduler::run() {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    const int tick_ms = tick_ms_; // start()在启动线程前设置，运行期间不变
+    uint64_t ticks_done = 0;
+
+    std::unique_lock<std::mutex> run_lock(run_mutex_);
+    while (!stop_requested_) {
+        Clock::time_point next = start + std::chrono::milliseconds(tick_ms * (ticks_done + 1));
+        stop_cv_.wait_until(run_lock, next, [this] { return stop_requested_; });
+        if (stop_requested_) break;
+
+        // 按实际经过的时间计算应到的节拍；处理较慢时一次追赶多个节拍，不会累积误差
+        uint64_t target = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count() / tick_ms);
+        if (target <= ticks_done) continue;
+        run_lock.unlock(); // 执行下落时不阻塞stop()
+        advance(target - ticks_done);
+        run_lock.lock();
+        ticks_done = target;
+    }
+}
+
+//------------------------------------------------------------------------------
+// C语言风格的重力调度API函数实现
+//------------------------------------------------------------------------------
+
+// 启动重力调度器
+API_EXPORT bool start_gravity_api(int tick_ms) {
+    return GravityScheduler::instance().start(tick_ms);
+}
+
+// 停止重力调度器
+API_EXPORT void stop_gravity_api() {
+    GravityScheduler::instance().stop();
+}
+
+// 登记会话
+API_EXPORT bool gravity_add_session_api(uint64_t session_id) {
+    return GravityScheduler::instance().add(session_id);
+}
+
+// 取消登记
+API_EXPORT bool gravity_remove_session_api(uint64_t session_id) {
+    return GravityScheduler::instance().remove(session_id);
+}
+
+// 已登记的会话数量
+API_EXPORT int get_gravity_session_count_api() {
+    return GravityScheduler::instance().size();
+}
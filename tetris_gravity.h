@@ -0,0 +1,100 @@
+// tetris_gravity.h
+// 服务器端重力调度器：由核心库推动所有会话的方块自动下落
+// 以前每个浏览器每500ms发一次HTTP请求调用game_tick，请求量与玩家数成正比；
+// 现在登记到调度器的会话由核心库按各自等级对应的间隔自动下落，客户端只需要发送真正的按键。
+//
+// 所有会话的下一次下落时间放在一个分层时间轮里，由一个驱动线程按固定节拍推进；
+// 每个节拍到期的会话分发到工作窃取线程池并行执行game_tick。
+// 操作游戏时通过SessionRegistry::acquire加锁，与网页请求互斥；下落之前先执行游戏输入队列中排队的按键。
+#ifndef TETRIS_GRAVITY_H // 防止头文件被重复包含的保护宏
+#define TETRIS_GRAVITY_H
+
+#include "tetris_session.h"
+#include "tetris_timing_wheel.h"
+#include <atomic>              // 运行标志
+#include <condition_variable>  // 驱动线程的定时休眠和停止
+#include <mutex>               // 保护时间轮和登记表
+#include <thread>              // 驱动线程
+#include <unordered_map>       // 会话ID -> 登记版本号
+#include <vector>
+
+// 重力调度器（进程内单例）
+class GravityScheduler {
+public:
+    // 获取进程内唯一的调度器
+    static GravityScheduler& instance();
+
+    // 启动驱动线程，tick_ms是时间轮一个节拍的毫秒数（下落间隔会向上取整到节拍）
+    // 已经在运行时返回false
+    bool start(int tick_ms);
+
+    // 停止驱动线程（已登记的会话保留，重新启动后继续下落）
+    void stop();
+
+    // 是否正在运行
+    bool running() const { return running_.load(); }
+
+    // 登记会话：从现在起按当前等级的间隔自动下落
+    // 已登记的会话会重新计时（例如在同一会话上重新开局后调用）。会话不存在时返回false
+    bool add(SessionId id);
+
+    // 取消登记。返回false表示会话未登记
+    bool remove(SessionId id);
+
+    // 已登记的会话数量
+    int size();
+
+    // 让时间轮前进ticks个节拍并执行到期的下落，返回执行下落的会话数
+    // 驱动线程内部使用；未启动驱动线程时也可以手动调用（例如无界面的测试和模拟）
+    int advance(uint64_t ticks);
+
+    // 默认的节拍长度（毫秒）
+    static const int DEFAULT_TICK_MS = 10;
+
+private:
+    GravityScheduler();
+    ~GravityScheduler();
+    GravityScheduler(const GravityScheduler&);            // 禁止复制
+    GravityScheduler& operator=(const GravityScheduler&); // 禁止赋值
+
+    std::mutex mutex_;                                    // 保护以下成员
+    TimingWheel wheel_;                                   // 所有会话的下一次下落时间
+    std::unordered_map<SessionId, uint32_t> generations_; // 已登记会话的版本号，时间轮中版本号不一致的定时器已被取消
+    uint32_t next_generation_;
+    int tick_ms_;                                         // 一个节拍的毫秒数
+
+    std::atomic<bool> running_;
+    std::mutex run_mutex_;          // 配合stop_cv_使用，同时串行化start/stop
+    std::condition_variable stop_cv_;
+    bool stop_requested_;
+    std::thread driver_;
+
+    // 驱动线程主循环：按节拍休眠，醒来后追赶到当前时间
+    void run();
+
+    // 对一批到期的定时器执行下落，并重新登记下一次下落
+    int fire(const std::vector<TimerEntry>& due);
+
+    // 把下落间隔（毫秒）换算成节拍数（调用方持有mutex_）
+    uint64_t interval_ticks(int level) const;
+};
+
+// 定义C风格的重力调度API接口
+extern "C" {
+    // 启动重力调度器（tick_ms <= 0时使用默认节拍），已经在运行时返回false
+    API_EXPORT bool start_gravity_api(int tick_ms);
+
+    // 停止重力调度器
+    API_EXPORT void stop_gravity_api();
+
+    // 登记会话，使其方块自动下落；会话不存在时返回false
+    API_EXPORT bool gravity_add_session_api(uint64_t session_id);
+
+    // 取消登记
+    API_EXPORT bool gravity_remove_session_api(uint64_t session_id);
+
+    // 已登记的会话数量
+    API_EXPORT int get_gravity_session_count_api();
+}
+
+#endif // TETRIS_GRAVITY_H
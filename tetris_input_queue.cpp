@@ -0,0 +1,64 @@
+// tetris_input_queue.cpp
+// 多生产者、单消费者无锁输入队列的实现
+#include "tetris_input_queue.h"
+#include <chrono> // 单调时钟
+
+static_assert((InputQueue::CAPACITY & (InputQueue::CAPACITY - 1)) == 0, "队列容量必须是2的幂");
+
+InputQueue::InputQueue() : tail_(0), head_(0) {
+    for (uint32_t i = 0; i < CAPACITY; ++i) {
+        cells_[i].sequence.store(i, std::memory_order_relaxed);
+        cells_[i].action = 0;
+        cells_[i].timestamp_us = 0;
+    }
+}
+
+// 入队：槽位序号等于写位置说明槽位空闲，CAS占住它之后写入数据，最后发布序号
+// 序号落后于写位置说明这个槽位还没被消费者读走，也就是队列已满
+// 序号和位置都是32位计数器，按有符号差值比较，计数器回绕也不影响判断
+bool InputQueue::push(int action, uint64_t timestamp_us) {
+    uint32_t pos = tail_.load(std::memory_order_relaxed);
+    Cell* cell;
+    for (;;) {
+        cell = &cells_[pos & (CAPACITY - 1)];
+        uint32_t sequence = cell->sequence.load(std::memory_order_acquire);
+        int32_t diff = static_cast<int32_t>(sequence - pos);
+        if (diff == 0) {
+            // 失败时pos被更新为最新的写位置，直接重试
+            if (tail_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) break;
+        } else if (diff < 0) {
+            return false; // 队列已满
+        } else {
+            pos = tail_.load(std::memory_order_relaxed); // 其他生产者已经占住了这个位置
+        }
+    }
+    cell->action = action;
+    cell->timestamp_us = timestamp_us;
+    cell->sequence.store(pos + 1, std::memory_order_release); // 发布：消费者看到序号后才读数据
+    return true;
+}
+
+// 出队：槽位序号等于读位置+1说明数据已发布；读完后把序号推进一圈，槽位留给下一轮的生产者
+bool InputQueue::pop(InputEvent* out) {
+    Cell& cell = cells_[head_ & (CAPACITY - 1)];
+    uint32_t sequence = cell.sequence.load(std::memory_order_acquire);
+    if (sequence != head_ + 1) return false; // 队列为空，或者生产者还没写完
+    out->action = cell.action;
+    out->timestamp_us = cell.timestamp_us;
+    cell.sequence.store(head_ + CAPACITY, std::memory_order_release);
+    head_++;
+    return true;
+}
+
+// 丢弃全部输入
+void InputQueue::clear() {
+    InputEvent event;
+    while (pop(&event)) {
+    }
+}
+
+// 单调时钟的当前时间（微秒）
+uint64_t InputQueue::now_us() {
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::microseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+}
@@ -0,0 +1,57 @@
+// tetris_input_queue.h
+// 每局游戏的输入队列：多生产者、单消费者的无锁环形缓冲区
+// 多线程的网页服务中，同一局游戏的几个按键可能同时由不同的工作线程处理。
+// 生产者只把(动作, 时间戳)放进队列，不锁定也不修改游戏；持有这局游戏的一方（消费者：
+// 重力调度器的工作线程、持有会话锁的请求）在读取或推进游戏之前按入队顺序取出并执行。
+//
+// 实现是有界环形缓冲区，每个槽位带一个序号（Dmitry Vyukov的有界队列）：
+// 生产者用一次CAS占住写位置，写完数据后再发布槽位的序号；消费者只有一个，读位置是普通变量。
+// 某个生产者占住槽位但还没发布时，消费者在这个槽位停下（之后的输入也不会越过它），保证先进先出。
+// 队列容量固定，满时入队失败，由调用方决定丢弃还是改走加锁的同步路径。
+#ifndef TETRIS_INPUT_QUEUE_H // 防止头文件被重复包含的保护宏
+#define TETRIS_INPUT_QUEUE_H
+
+#include <atomic>  // 槽位序号和写位置
+#include <cstdint> // 固定宽度整数类型
+
+// 一个输入事件
+struct InputEvent {
+    uint64_t timestamp_us; // 入队时间（单调时钟，微秒）
+    int action;            // 动作编码（TetrisAction）
+};
+
+class InputQueue {
+public:
+    static const uint32_t CAPACITY = 16; // 槽位数（2的幂）：两次消费之间玩家的按键数远少于这个数
+
+    InputQueue();
+
+    // 入队（任意线程都可以调用），队列已满时返回false
+    bool push(int action, uint64_t timestamp_us);
+
+    // 出队（只能由消费者调用），队列为空或队首的输入还没有写完时返回false
+    bool pop(InputEvent* out);
+
+    // 丢弃队列中的全部输入（只能由消费者调用）
+    void clear();
+
+    // 单调时钟的当前时间（微秒），生产者不提供时间戳时使用
+    static uint64_t now_us();
+
+private:
+    InputQueue(const InputQueue&);            // 禁止复制
+    InputQueue& operator=(const InputQueue&); // 禁止赋值
+
+    // 槽位：sequence等于写位置时可写，等于写位置+1时数据已发布、可读
+    struct Cell {
+        std::atomic<uint32_t> sequence;
+        int action;
+        uint64_t timestamp_us;
+    };
+
+    Cell cells_[CAPACITY];
+    std::atomic<uint32_t> tail_; // 下一个写位置（所有生产者共享）
+    uint32_t head_;              // 下一个读位置（只有消费者访问）
+};
+
+#endif // TETRIS_INPUT_QUEUE_H
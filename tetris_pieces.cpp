@@ -0,0 +1,9 @@
+// tetris_pieces.cpp
+// 方块表的存储定义
+// 方块表本身在tetris_pieces.h中于编译期解码；C++11要求被按引用使用的
+// static constexpr数据成员在某个翻译单元中另有一份定义（不能再写初始值）
+#include "tetris_pieces.h"
+
+constexpr int PieceTable::srs_block_data[PIECE_TYPES][ROTATIONS];
+constexpr TetrominoShape PieceTable::shapes_[PIECE_TYPES][ROTATIONS];
+constexpr RotationKicks PieceTable::kicks_[PIECE_TYPES][ROTATIONS];
@@ -0,0 +1,257 @@
+// tetris_pieces.h
+// 方块形状定义：所有游戏共享的只读方块表
+// 方块表在编译期由srs_block_data解码（constexpr），作为静态常量数组存放在只读数据段：
+// 程序启动和创建游戏时都不需要解码，查表就是一次数组下标访问，没有任何间接寻址
+//
+// 形状和旋转遵循超级旋转系统（SRS）：每种方块在固定的边界框（I为4x4，O为2x2，其余为3x3）内
+// 绕框的中心旋转，旋转被挡住时按SRS的踢墙表依次尝试最多5个偏移位置
+#ifndef TETRIS_PIECES_H // 防止头文件被重复包含的保护宏
+#define TETRIS_PIECES_H
+
+#include <cstdint> // 固定宽度整数类型，用于行掩码
+
+// 位棋盘（bitboard）的行掩码类型：第x位为1表示该行第x列有方块
+typedef uint16_t RowMask;
+
+// 定义一个二维点或坐标的结构体
+// 在游戏中用于表示方块位置和相对位置
+struct Point {
+    int x;  // 水平坐标（列）
+    int y;  // 垂直坐标（行）
+};
+
+// 定义一个俄罗斯方块形状的结构体
+// 包含方块的组成部分和尺寸信息
+struct TetrominoShape {
+    Point blocks[4];  // 存储4个组成块相对于锚点的坐标
+    int width;        // 方块边界框的宽度
+    int height;       // 方块边界框的高度
+
+    // 预计算的派生数据（由blocks推导，用于快速碰撞检测和落点计算）
+    RowMask row_masks[4]; // 第i个元素是方块第i行（相对y）的占用掩码，第x位对应相对x
+    int min_x, max_x;     // 左右边界：组成块实际占用的最小/最大相对x（编码中的宽度并不总是可靠）
+    int min_y, max_y;     // 组成块实际占用的最小/最大相对y
+    int8_t bottom[4];     // 底部轮廓：第i个元素是相对x为i的列中最低组成块的相对y，-1表示该列没有组成块
+    int8_t spawn_min_x;   // 生成时锚点x的最小值
+    int8_t spawn_extent;  // 生成时为方块预留的列数：宽为W的棋盘上，生成的锚点x范围是[spawn_min_x, W - spawn_extent]
+
+    // 宽为board_width的棋盘上可选的生成位置数量
+    constexpr int spawn_x_count(int board_width) const {
+        return board_width - spawn_extent - spawn_min_x + 1;
+    }
+};
+
+// 方块形状原始编码的编译期解码函数
+// C++11的constexpr函数只能包含一条return语句，因此每个字段都写成一个独立的表达式
+namespace piece_decode {
+    // 从整数编码中提取从bit_offset开始的2位值（0-3）
+    constexpr int two_bits(int raw_data, int bit_offset) {
+        return (raw_data >> bit_offset) & 3;
+    }
+
+    // 第k个组成块的坐标：每个块占4位，低2位是y，高2位是x
+    constexpr int block_x(int raw_data, int k) { return two_bits(raw_data, k * 4 + 2); }
+    constexpr int block_y(int raw_data, int k) { return two_bits(raw_data, k * 4); }
+
+    // 编码中的宽度和高度（16-17位和18-19位存的是宽度-1和高度-1）
+    constexpr int width(int raw_data) { return two_bits(raw_data, 16) + 1; }
+    constexpr int height(int raw_data) { return two_bits(raw_data, 18) + 1; }
+
+    constexpr int min2(int a, int b) { return a < b ? a : b; }
+    constexpr int max2(int a, int b) { return a > b ? a : b; }
+
+    // 第k个组成块在第row行时对该行掩码的贡献
+    constexpr unsigned row_bit(int raw_data, int k, int row) {
+        return block_y(raw_data, k) == row ? 1u << block_x(raw_data, k) : 0u;
+    }
+
+    // 第row行的占用掩码（用按位或，编码中重复的组成块只计一次）
+    constexpr RowMask row_mask(int raw_data, int row) {
+        return static_cast<RowMask>(row_bit(raw_data, 0, row) | row_bit(raw_data, 1, row) |
+                                    row_bit(raw_data, 2, row) | row_bit(raw_data, 3, row));
+    }
+
+    // 组成块的实际占用范围
+    constexpr int min_x(int raw_data) {
+        return min2(min2(block_x(raw_data, 0), block_x(raw_data, 1)),
+                    min2(block_x(raw_data, 2), block_x(raw_data, 3)));
+    }
+    constexpr int max_x(int raw_data) {
+        return max2(max2(block_x(raw_data, 0), block_x(raw_data, 1)),
+                    max2(block_x(raw_data, 2), block_x(raw_data, 3)));
+    }
+    constexpr int min_y(int raw_data) {
+        return min2(min2(block_y(raw_data, 0), block_y(raw_data, 1)),
+                    min2(block_y(raw_data, 2), block_y(raw_data, 3)));
+    }
+    constexpr int max_y(int raw_data) {
+        return max2(max2(block_y(raw_data, 0), block_y(raw_data, 1)),
+                    max2(block_y(raw_data, 2), block_y(raw_data, 3)));
+    }
+
+    // 第k个组成块在第column列时的相对y，否则为-1
+    constexpr int y_in_column(int raw_data, int k, int column) {
+        return block_x(raw_data, k) == column ? block_y(raw_data, k) : -1;
+    }
+
+    // 第column列的底部轮廓
+    constexpr int8_t bottom(int raw_data, int column) {
+        return static_cast<int8_t>(max2(max2(y_in_column(raw_data, 0, column), y_in_column(raw_data, 1, column)),
+                                        max2(y_in_column(raw_data, 2, column), y_in_column(raw_data, 3, column))));
+    }
+
+    // 编码：decode的逆运算，用4个组成块的坐标和边界框边长写出方块表
+    constexpr int encode(int x0, int y0, int x1, int y1, int x2, int y2, int x3, int y3, int box) {
+        return (y0 | x0 << 2) | (y1 | x1 << 2) << 4 | (y2 | x2 << 2) << 8 | (y3 | x3 << 2) << 12 |
+               (box - 1) << 16 | (box - 1) << 18;
+    }
+
+    // 16位掩码中1的个数
+    constexpr int bit_count(unsigned mask) {
+        return mask == 0 ? 0 : static_cast<int>(mask & 1u) + bit_count(mask >> 1);
+    }
+
+    // 解码一个完整的形状
+    // 生成范围沿用原始游戏的规则：锚点从0开始，按编码中的宽度预留列数
+    constexpr TetrominoShape decode(int raw_data) {
+        return TetrominoShape{
+            { {block_x(raw_data, 0), block_y(raw_data, 0)}, {block_x(raw_data, 1), block_y(raw_data, 1)},
+              {block_x(raw_data, 2), block_y(raw_data, 2)}, {block_x(raw_data, 3), block_y(raw_data, 3)} },
+            width(raw_data), height(raw_data),
+            { row_mask(raw_data, 0), row_mask(raw_data, 1), row_mask(raw_data, 2), row_mask(raw_data, 3) },
+            min_x(raw_data), max_x(raw_data), min_y(raw_data), max_y(raw_data),
+            { bottom(raw_data, 0), bottom(raw_data, 1), bottom(raw_data, 2), bottom(raw_data, 3) },
+            0, static_cast<int8_t>(width(raw_data))
+        };
+    }
+
+    // 形状是否恰好占4个不同的格子（编码中有重复的组成块时不满足）
+    constexpr bool has_four_cells(const TetrominoShape& shape) {
+        return bit_count(shape.row_masks[0]) + bit_count(shape.row_masks[1]) +
+               bit_count(shape.row_masks[2]) + bit_count(shape.row_masks[3]) == 4;
+    }
+}
+
+// 旋转时尝试的一个位置偏移（棋盘坐标：x向右，y向下）
+struct KickOffset {
+    int8_t dx;
+    int8_t dy;
+};
+
+// 从某个旋转状态顺时针转到下一个状态时依次尝试的偏移，第一个能放下的就是旋转结果
+struct RotationKicks {
+    int8_t count;           // 尝试的位置数（O形只有原位置）
+    KickOffset offsets[5];  // 第0个总是(0, 0)
+};
+
+// 只读方块表（只有静态成员，不需要创建实例）
+// 第一维是方块类型，第二维是旋转状态（0为生成状态，1、2、3依次顺时针旋转90度）
+// 方块类型的顺序与前端的颜色表一致：棋盘上的颜色值是类型+1
+class PieceTable {
+public:
+    static const int PIECE_TYPES = 7; // 方块类型数量
+    static const int ROTATIONS = 4;   // 每种方块的旋转状态数量
+    static const int MAX_KICKS = 5;   // 一次旋转最多尝试的位置数
+
+    // 方块类型
+    enum PieceType { PIECE_I = 0, PIECE_J = 1, PIECE_L = 2, PIECE_O = 3, PIECE_S = 4, PIECE_T = 5, PIECE_Z = 6 };
+
+    // 获取特定类型和旋转状态的方块形状数据
+    static constexpr const TetrominoShape& shape(int piece_type, int rotation) {
+        return shapes_[piece_type][rotation];
+    }
+
+    // 获取从rotation顺时针旋转时依次尝试的偏移（旋转后的形状是shape(piece_type, (rotation + 1) % 4)）
+    static constexpr const RotationKicks& kicks(int piece_type, int rotation) {
+        return kicks_[piece_type][rotation];
+    }
+
+private:
+    PieceTable(); // 禁止创建实例
+
+// 编码一个形状：4个组成块的(x, y)和边界框边长
+#define TETRIS_SHAPE(x0, y0, x1, y1, x2, y2, x3, y3, box) piece_decode::encode(x0, y0, x1, y1, x2, y2, x3, y3, box)
+
+    // SRS方块形状的原始编码（格式见piece_decode：每个组成块4位，最后4位是边界框的宽度-1和高度-1）
+    // 原始tinytetris.cpp的编码有一半解码后不是标准形状（Z形冒充I形、J形解码成I形，
+    // S/Z的部分旋转状态不连通），这里按SRS重新写出全部28个形状
+    static constexpr int srs_block_data[PIECE_TYPES][ROTATIONS] = {
+        { TETRIS_SHAPE(0, 1, 1, 1, 2, 1, 3, 1, 4), TETRIS_SHAPE(2, 0, 2, 1, 2, 2, 2, 3, 4),   // I
+          TETRIS_SHAPE(0, 2, 1, 2, 2, 2, 3, 2, 4), TETRIS_SHAPE(1, 0, 1, 1, 1, 2, 1, 3, 4) },
+        { TETRIS_SHAPE(0, 0, 0, 1, 1, 1, 2, 1, 3), TETRIS_SHAPE(1, 0, 2, 0, 1, 1, 1, 2, 3),   // J
+          TETRIS_SHAPE(0, 1, 1, 1, 2, 1, 2, 2, 3), TETRIS_SHAPE(1, 0, 1, 1, 0, 2, 1, 2, 3) },
+        { TETRIS_SHAPE(2, 0, 0, 1, 1, 1, 2, 1, 3), TETRIS_SHAPE(1, 0, 1, 1, 1, 2, 2, 2, 3),   // L
+          TETRIS_SHAPE(0, 1, 1, 1, 2, 1, 0, 2, 3), TETRIS_SHAPE(0, 0, 1, 0, 1, 1, 1, 2, 3) },
+        { TETRIS_SHAPE(0, 0, 1, 0, 0, 1, 1, 1, 2), TETRIS_SHAPE(0, 0, 1, 0, 0, 1, 1, 1, 2),   // O
+          TETRIS_SHAPE(0, 0, 1, 0, 0, 1, 1, 1, 2), TETRIS_SHAPE(0, 0, 1, 0, 0, 1, 1, 1, 2) },
+        { TETRIS_SHAPE(1, 0, 2, 0, 0, 1, 1, 1, 3), TETRIS_SHAPE(1, 0, 1, 1, 2, 1, 2, 2, 3),   // S
+          TETRIS_SHAPE(1, 1, 2, 1, 0, 2, 1, 2, 3), TETRIS_SHAPE(0, 0, 0, 1, 1, 1, 1, 2, 3) },
+        { TETRIS_SHAPE(1, 0, 0, 1, 1, 1, 2, 1, 3), TETRIS_SHAPE(1, 0, 1, 1, 2, 1, 1, 2, 3),   // T
+          TETRIS_SHAPE(0, 1, 1, 1, 2, 1, 1, 2, 3), TETRIS_SHAPE(1, 0, 0, 1, 1, 1, 1, 2, 3) },
+        { TETRIS_SHAPE(0, 0, 1, 0, 1, 1, 2, 1, 3), TETRIS_SHAPE(2, 0, 1, 1, 2, 1, 1, 2, 3),   // Z
+          TETRIS_SHAPE(0, 1, 1, 1, 1, 2, 2, 2, 3), TETRIS_SHAPE(1, 0, 0, 1, 1, 1, 0, 2, 3) }
+    };
+
+#undef TETRIS_SHAPE
+
+// 解码一种方块的全部旋转状态
+#define TETRIS_DECODE_PIECE(type) \
+    { piece_decode::decode(srs_block_data[type][0]), piece_decode::decode(srs_block_data[type][1]), \
+      piece_decode::decode(srs_block_data[type][2]), piece_decode::decode(srs_block_data[type][3]) }
+
+    // 编译期解码好的方块形状（扁平数组）
+    static constexpr TetrominoShape shapes_[PIECE_TYPES][ROTATIONS] = {
+        TETRIS_DECODE_PIECE(0), TETRIS_DECODE_PIECE(1), TETRIS_DECODE_PIECE(2), TETRIS_DECODE_PIECE(3),
+        TETRIS_DECODE_PIECE(4), TETRIS_DECODE_PIECE(5), TETRIS_DECODE_PIECE(6)
+    };
+
+#undef TETRIS_DECODE_PIECE
+
+// SRS踢墙表（顺时针），已经换成y向下的棋盘坐标（SRS原表的y向上，这里y取反）
+// 第r行是从旋转状态r转到r+1时依次尝试的偏移
+#define TETRIS_KICKS_JLSTZ \
+    { { 5, { {0, 0}, {-1, 0}, {-1, -1}, {0, 2}, {-1, 2} } },  /* 0 -> R */ \
+      { 5, { {0, 0}, {1, 0}, {1, 1}, {0, -2}, {1, -2} } },    /* R -> 2 */ \
+      { 5, { {0, 0}, {1, 0}, {1, -1}, {0, 2}, {1, 2} } },     /* 2 -> L */ \
+      { 5, { {0, 0}, {-1, 0}, {-1, 1}, {0, -2}, {-1, -2} } } } /* L -> 0 */
+#define TETRIS_KICKS_I \
+    { { 5, { {0, 0}, {-2, 0}, {1, 0}, {-2, 1}, {1, -2} } },   /* 0 -> R */ \
+      { 5, { {0, 0}, {-1, 0}, {2, 0}, {-1, -2}, {2, 1} } },   /* R -> 2 */ \
+      { 5, { {0, 0}, {2, 0}, {-1, 0}, {2, -1}, {-1, 2} } },   /* 2 -> L */ \
+      { 5, { {0, 0}, {1, 0}, {-2, 0}, {1, 2}, {-2, -1} } } }  /* L -> 0 */
+#define TETRIS_KICKS_O \
+    { { 1, { {0, 0} } }, { 1, { {0, 0} } }, { 1, { {0, 0} } }, { 1, { {0, 0} } } } // O形旋转后形状不变
+
+    // 每种方块每个旋转状态的踢墙偏移（按方块类型展开，旋转时一次查表就得到全部候选位置）
+    static constexpr RotationKicks kicks_[PIECE_TYPES][ROTATIONS] = {
+        TETRIS_KICKS_I, TETRIS_KICKS_JLSTZ, TETRIS_KICKS_JLSTZ, TETRIS_KICKS_O,
+        TETRIS_KICKS_JLSTZ, TETRIS_KICKS_JLSTZ, TETRIS_KICKS_JLSTZ
+    };
+
+#undef TETRIS_KICKS_JLSTZ
+#undef TETRIS_KICKS_I
+#undef TETRIS_KICKS_O
+};
+
+// 编译期检查解码结果（如果解码发生在运行期，这些断言无法通过编译）
+#define TETRIS_CHECK_PIECE(type) \
+    (piece_decode::has_four_cells(PieceTable::shape(type, 0)) && piece_decode::has_four_cells(PieceTable::shape(type, 1)) && \
+     piece_decode::has_four_cells(PieceTable::shape(type, 2)) && piece_decode::has_four_cells(PieceTable::shape(type, 3)))
+static_assert(TETRIS_CHECK_PIECE(0) && TETRIS_CHECK_PIECE(1) && TETRIS_CHECK_PIECE(2) && TETRIS_CHECK_PIECE(3) &&
+              TETRIS_CHECK_PIECE(4) && TETRIS_CHECK_PIECE(5) && TETRIS_CHECK_PIECE(6), "每个形状必须恰好占4个格子");
+#undef TETRIS_CHECK_PIECE
+static_assert(PieceTable::shape(PieceTable::PIECE_O, 0).row_masks[0] == 0x3 &&
+              PieceTable::shape(PieceTable::PIECE_O, 0).row_masks[1] == 0x3, "O形方块应占据2x2的区域");
+static_assert(PieceTable::shape(PieceTable::PIECE_I, 0).row_masks[1] == 0xF &&
+              PieceTable::shape(PieceTable::PIECE_I, 0).spawn_x_count(10) == 7, "I形生成状态应为水平的一行");
+static_assert(PieceTable::shape(PieceTable::PIECE_I, 1).min_x == 2 && PieceTable::shape(PieceTable::PIECE_I, 1).max_y == 3 &&
+              PieceTable::shape(PieceTable::PIECE_I, 1).bottom[2] == 3 &&
+              PieceTable::shape(PieceTable::PIECE_I, 1).bottom[1] == -1, "I形旋转一次应为第2列的竖条");
+static_assert(PieceTable::shape(PieceTable::PIECE_T, 0).row_masks[0] == 0x2 && PieceTable::shape(PieceTable::PIECE_T, 0).row_masks[1] == 0x7 &&
+              PieceTable::shape(PieceTable::PIECE_T, 2).bottom[1] == 2 && PieceTable::shape(PieceTable::PIECE_T, 2).bottom[3] == -1,
+              "T形解码错误");
+static_assert(PieceTable::kicks(PieceTable::PIECE_I, 0).offsets[1].dx == -2 &&
+              PieceTable::kicks(PieceTable::PIECE_T, 3).offsets[4].dy == -2 &&
+              PieceTable::kicks(PieceTable::PIECE_O, 0).count == 1, "踢墙表错误");
+
+#endif // TETRIS_PIECES_H
@@ -0,0 +1,309 @@
+// tetris_pool.cpp
+// 结构数组游戏池的实现
+#include "tetris_pool.h"
+#include <algorithm> // std::push_heap, std::pop_heap, std::sort
+#include <climits>   // INT32_MIN
+#include <utility>   // std::pair
+#if defined(__AVX2__)
+#include <immintrin.h> // AVX2：一次比较32个状态字节或8个分数
+#elif defined(__SSE2__) || defined(_M_X64) || (defined(_M_IX86_FP) && _M_IX86_FP >= 2)
+#include <emmintrin.h> // SSE2：一次比较16个状态字节或4个分数
+#define TETRIS_USE_SSE2
+#endif
+
+// 空闲槽位的分数：比任何真实分数都小，前K名和直方图的扫描不需要再单独检查槽位状态
+static const int32_t FREE_SLOT_SCORE = INT32_MIN;
+
+// 掩码中最低的1所在的位（mask不能为0）
+static inline int lowest_bit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    int bit = 0;
+    while (!(mask & 1u)) {
+        mask >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+// 构造函数：所有游戏实例一次性创建，槽位号小的先分配
+TetrisPool::TetrisPool(int capacity)
+    : games_(capacity > 0 ? capacity : 0),
+      scores_(games_.size(), FREE_SLOT_SCORE),
+      status_(games_.size(), POOL_SLOT_FREE) {
+    free_slots_.reserve(games_.size());
+    for (int slot = static_cast<int>(games_.size()) - 1; slot >= 0; --slot) {
+        free_slots_.push_back(slot);
+    }
+}
+
+// 分配槽位并用指定种子开局
+int TetrisPool::acquire(uint64_t seed) {
+    if (free_slots_.empty()) return -1;
+    int slot = free_slots_.back();
+    free_slots_.pop_back();
+    games_[slot].start_new_game_seeded(seed);
+    sync(slot);
+    return slot;
+}
+
+// 分配槽位并开局
+int TetrisPool::acquire() {
+    if (free_slots_.empty()) return -1;
+    int slot = free_slots_.back();
+    free_slots_.pop_back();
+    games_[slot].start_new_game();
+    sync(slot);
+    return slot;
+}
+
+// 释放槽位
+bool TetrisPool::release(int slot) {
+    if (!in_use(slot)) return false;
+    status_[slot] = POOL_SLOT_FREE;
+    scores_[slot] = FREE_SLOT_SCORE;
+    free_slots_.push_back(slot);
+    return true;
+}
+
+// 同步一个槽位的分数和状态
+void TetrisPool::sync(int slot) {
+    const TetrisGame& game = games_[slot];
+    scores_[slot] = game.get_score();
+    status_[slot] = static_cast<uint8_t>(game.is_game_over() ? POOL_SLOT_OVER : POOL_SLOT_ALIVE);
+}
+
+// 对一个槽位执行动作
+bool TetrisPool::apply_action(int slot, int action) {
+    if (!in_use(slot)) return false;
+    bool result = games_[slot].apply_action(action);
+    sync(slot);
+    return result;
+}
+
+// 在一个槽位上重新开始游戏
+bool TetrisPool::restart(int slot) {
+    if (!in_use(slot)) return false;
+    games_[slot].start_new_game();
+    sync(slot);
+    return true;
+}
+
+// 推进所有已分配的槽位一步
+void TetrisPool::step(const uint8_t* actions, bool auto_reset) {
+    for (size_t slot = 0; slot < games_.size(); ++slot) {
+        uint8_t status = status_[slot];
+        if (status == POOL_SLOT_FREE) continue;
+        TetrisGame& game = games_[slot];
+        if (status == POOL_SLOT_OVER) {
+            if (!auto_reset) continue; // 已结束且不自动重开：保持最终状态
+            game.start_new_game();
+        }
+        game.apply_action(actions[slot]);
+        scores_[slot] = game.get_score();
+        status_[slot] = static_cast<uint8_t>(game.is_game_over() ? POOL_SLOT_OVER : POOL_SLOT_ALIVE);
+    }
+}
+
+// 统计进行中的游戏：把状态字节与POOL_SLOT_ALIVE比较，比较结果（0或-1）逐字节累加到计数向量中，
+// 每255组（字节计数器溢出之前）用psadbw横向求和一次；不依赖popcnt指令
+int TetrisPool::count_alive() const {
+    const uint8_t* status = status_.data();
+    const size_t n = status_.size();
+    size_t i = 0;
+    int count = 0;
+#if defined(__AVX2__)
+    const __m256i alive = _mm256_set1_epi8(POOL_SLOT_ALIVE);
+    while (i + 32 <= n) {
+        __m256i counters = _mm256_setzero_si256();
+        for (int group = 0; group < 255 && i + 32 <= n; ++group, i += 32) {
+            __m256i eq = _mm256_cmpeq_epi8(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(status + i)), alive);
+            counters = _mm256_sub_epi8(counters, eq);
+        }
+        __m256i sums = _mm256_sad_epu8(counters, _mm256_setzero_si256()); // 4个64位部分和
+        __m128i half = _mm_add_epi64(_mm256_castsi256_si128(sums), _mm256_extracti128_si256(sums, 1));
+        count += _mm_cvtsi128_si32(half) + _mm_cvtsi128_si32(_mm_srli_si128(half, 8));
+    }
+#elif defined(TETRIS_USE_SSE2)
+    const __m128i alive = _mm_set1_epi8(POOL_SLOT_ALIVE);
+    while (i + 16 <= n) {
+        __m128i counters = _mm_setzero_si128();
+        for (int group = 0; group < 255 && i + 16 <= n; ++group, i += 16) {
+            __m128i eq = _mm_cmpeq_epi8(_mm_loadu_si128(reinterpret_cast<const __m128i*>(status + i)), alive);
+            counters = _mm_sub_epi8(counters, eq);
+        }
+        __m128i sums = _mm_sad_epu8(counters, _mm_setzero_si128()); // 2个64位部分和
+        count += _mm_cvtsi128_si32(sums) + _mm_cvtsi128_si32(_mm_srli_si128(sums, 8));
+    }
+#endif
+    for (; i < n; ++i) {
+        count += status[i] == POOL_SLOT_ALIVE;
+    }
+    return count;
+}
+
+// 前K名使用的小根堆：堆顶是目前入选的K局中排名最低的一局
+// 排名先比分数，分数相同时槽位号小的排名高
+typedef std::pair<int32_t, int> ScoreEntry; // (分数, 槽位号)
+
+static inline bool ranks_higher(const ScoreEntry& a, const ScoreEntry& b) {
+    return a.first != b.first ? a.first > b.first : a.second < b.second;
+}
+
+// 用于std::*_heap的比较：让排名最低的元素位于堆顶
+struct RanksHigher {
+    bool operator()(const ScoreEntry& a, const ScoreEntry& b) const {
+        return ranks_higher(a, b);
+    }
+};
+
+// 取前K名
+// 扫描时用SIMD把一组分数与当前门槛（堆顶分数）比较，整组都不超过门槛时直接跳过；
+// 堆装满之后门槛很快升高，绝大多数分组只需要一次比较
+int TetrisPool::top_scores(int k, int* out_slots, int32_t* out_scores) const {
+    if (k <= 0) return 0;
+    k = std::min(k, used());
+    if (k == 0) return 0;
+
+    std::vector<ScoreEntry> heap;
+    heap.reserve(k);
+    int32_t threshold = FREE_SLOT_SCORE; // 分数必须大于门槛才可能入选；堆未满时只排除空闲槽位
+
+    // 考虑一个槽位（调用前已确认分数大于入组时的门槛，这里按最新的门槛再判断一次）
+    auto consider = [&](int slot) {
+        int32_t score = scores_[slot];
+        if (score <= threshold) return; // 分数相同时先出现的槽位号更小，排名更高，保持不变
+        if (static_cast<int>(heap.size()) < k) {
+            heap.push_back(ScoreEntry(score, slot));
+            std::push_heap(heap.begin(), heap.end(), RanksHigher());
+            if (static_cast<int>(heap.size()) == k) threshold = heap.front().first;
+        } else {
+            std::pop_heap(heap.begin(), heap.end(), RanksHigher());
+            heap.back() = ScoreEntry(score, slot);
+            std::push_heap(heap.begin(), heap.end(), RanksHigher());
+            threshold = heap.front().first;
+        }
+    };
+
+    const int32_t* scores = scores_.data();
+    const int n = static_cast<int>(scores_.size());
+    int i = 0;
+#if defined(__AVX2__)
+    for (; i + 8 <= n; i += 8) {
+        __m256i gt = _mm256_cmpgt_epi32(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(scores + i)),
+                                        _mm256_set1_epi32(threshold));
+        uint32_t mask = static_cast<uint32_t>(_mm256_movemask_ps(_mm256_castsi256_ps(gt)));
+        for (; mask; mask &= mask - 1) consider(i + lowest_bit(mask));
+    }
+#elif defined(TETRIS_USE_SSE2)
+    for (; i + 4 <= n; i += 4) {
+        __m128i gt = _mm_cmpgt_epi32(_mm_loadu_si128(reinterpret_cast<const __m128i*>(scores + i)),
+                                     _mm_set1_epi32(threshold));
+        uint32_t mask = static_cast<uint32_t>(_mm_movemask_ps(_mm_castsi128_ps(gt)));
+        for (; mask; mask &= mask - 1) consider(i + lowest_bit(mask));
+    }
+#endif
+    for (; i < n; ++i) {
+        if (scores[i] > threshold) consider(i);
+    }
+
+    std::sort(heap.begin(), heap.end(), ranks_higher);
+    for (size_t r = 0; r < heap.size(); ++r) {
+        if (out_scores) out_scores[r] = heap[r].first;
+        if (out_slots) out_slots[r] = heap[r].second;
+    }
+    return static_cast<int>(heap.size());
+}
+
+// 分数直方图
+// 除法换成乘以预先算好的倒数（定点数），结果最多小1，再用一次比较修正；
+// 四组计数交替累加，相邻的槽位落在同一个桶时不会互相等待
+int TetrisPool::score_histogram(int bucket_width, int bucket_count, uint32_t* out_counts) const {
+    if (bucket_width <= 0 || bucket_count <= 0 || !out_counts) return 0;
+    const uint64_t width = static_cast<uint64_t>(bucket_width);
+    const uint64_t reciprocal = (1ull << 32) / width; // floor(2^32 / width)
+    const uint32_t last = static_cast<uint32_t>(bucket_count - 1);
+
+    std::vector<uint32_t> partial(4 * static_cast<size_t>(bucket_count), 0);
+    const int32_t* scores = scores_.data();
+    const size_t n = scores_.size();
+    for (size_t i = 0; i < n; ++i) {
+        int32_t score = scores[i];
+        if (score < 0) continue; // 空闲槽位
+        uint64_t value = static_cast<uint64_t>(score);
+        uint64_t bucket = (value * reciprocal) >> 32;
+        if ((bucket + 1) * width <= value) bucket++;
+        uint32_t b = bucket < last ? static_cast<uint32_t>(bucket) : last;
+        partial[(i & 3) * bucket_count + b]++;
+    }
+
+    int total = 0;
+    for (int b = 0; b < bucket_count; ++b) {
+        out_counts[b] = partial[b] + partial[bucket_count + b] + partial[2 * bucket_count + b] +
+                        partial[3 * bucket_count + b];
+        total += static_cast<int>(out_counts[b]);
+    }
+    return total;
+}
+
+//------------------------------------------------------------------------------
+// C语言风格的游戏池API函数实现
+//------------------------------------------------------------------------------
+
+// 创建游戏池
+API_EXPORT TetrisPool* create_pool(int capacity) {
+    return new TetrisPool(capacity);
+}
+
+// 销毁游戏池
+API_EXPORT void destroy_pool(TetrisPool* pool) {
+    delete pool;
+}
+
+// 分配槽位；seed为0时从槽位自身的随机数生成器派生种子
+API_EXPORT int pool_acquire_api(TetrisPool* pool, uint64_t seed) {
+    if (!pool) return -1;
+    return seed ? pool->acquire(seed) : pool->acquire();
+}
+
+// 释放槽位
+API_EXPORT bool pool_release_api(TetrisPool* pool, int slot) {
+    return pool ? pool->release(slot) : false;
+}
+
+// 获取槽位上的游戏
+API_EXPORT TetrisGame* pool_get_game_api(TetrisPool* pool, int slot) {
+    return (pool && pool->in_use(slot)) ? &pool->game(slot) : nullptr;
+}
+
+// 同步槽位
+API_EXPORT void pool_sync_api(TetrisPool* pool, int slot) {
+    if (pool && pool->in_use(slot)) pool->sync(slot);
+}
+
+// 对一个槽位执行动作
+API_EXPORT bool pool_apply_action_api(TetrisPool* pool, int slot, int action) {
+    return pool ? pool->apply_action(slot, action) : false;
+}
+
+// 推进所有已分配的槽位一步
+API_EXPORT void pool_step_api(TetrisPool* pool, const uint8_t* actions, bool auto_reset) {
+    if (pool && actions) pool->step(actions, auto_reset);
+}
+
+// 进行中的游戏局数
+API_EXPORT int pool_count_alive_api(TetrisPool* pool) {
+    return pool ? pool->count_alive() : 0;
+}
+
+// 分数最高的k局
+API_EXPORT int pool_top_scores_api(TetrisPool* pool, int k, int* out_slots, int32_t* out_scores) {
+    return pool ? pool->top_scores(k, out_slots, out_scores) : 0;
+}
+
+// 分数直方图
+API_EXPORT int pool_score_histogram_api(TetrisPool* pool, int bucket_width, int bucket_count, uint32_t* out_counts) {
+    return pool ? pool->score_histogram(bucket_width, bucket_count, out_counts) : 0;
+}
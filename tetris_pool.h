@@ -0,0 +1,126 @@
+// tetris_pool.h
+// 结构数组（SoA）游戏池：锦标赛和压测中同时存在的大量游戏
+// 通过C API逐局创建游戏时，每局都是一次单独的堆分配，刷新一次排行榜要沿着十万个指针逐个调用get_score_api。
+// 游戏池一次性分配全部游戏实例（连续存放，空闲槽位复用），并把批量查询需要的字段
+// （分数、状态）按槽位号存放在平行的连续数组里：统计存活局数、取前K名分数和分数直方图
+// 都只需要顺序扫描这几个数组，扫描用SIMD指令一次比较多个槽位。
+//
+// 游戏逻辑仍然由TetrisGame完成；每次通过游戏池修改游戏后同步一次平行数组。
+// 直接通过game()修改游戏时，改完需要调用sync()。游戏池不是线程安全的，由使用者加锁。
+#ifndef TETRIS_POOL_H // 防止头文件被重复包含的保护宏
+#define TETRIS_POOL_H
+
+#include "tetris_game.h"
+#include <cstdint>  // 平行数组的元素类型
+#include <vector>   // 游戏实例和平行数组
+
+// 槽位状态
+enum PoolSlotStatus {
+    POOL_SLOT_FREE = 0,  // 空闲（未分配）
+    POOL_SLOT_ALIVE = 1, // 游戏进行中
+    POOL_SLOT_OVER = 2   // 游戏已结束（仍然参与排行榜和直方图）
+};
+
+class TetrisPool {
+public:
+    // 构造函数：一次性创建capacity局游戏，全部处于空闲状态
+    explicit TetrisPool(int capacity);
+
+    // 槽位总数
+    int capacity() const { return static_cast<int>(games_.size()); }
+
+    // 已分配的槽位数
+    int used() const { return capacity() - static_cast<int>(free_slots_.size()); }
+
+    // 分配一个槽位并用seed开始新游戏，返回槽位号；没有空闲槽位时返回-1
+    int acquire(uint64_t seed);
+
+    // 分配一个槽位并开始新游戏（种子从该槽位的随机数生成器派生）
+    int acquire();
+
+    // 释放槽位（游戏实例留在池中，下一次acquire复用）。槽位无效或已空闲时返回false
+    bool release(int slot);
+
+    // 槽位是否已分配
+    bool in_use(int slot) const {
+        return slot >= 0 && slot < capacity() && status_[slot] != POOL_SLOT_FREE;
+    }
+
+    // 访问槽位上的游戏；修改后需要调用sync(slot)
+    TetrisGame& game(int slot) { return games_[slot]; }
+    const TetrisGame& game(int slot) const { return games_[slot]; }
+
+    // 把槽位上游戏的分数和状态同步到平行数组
+    void sync(int slot);
+
+    // 对一个槽位执行动作（编码见TetrisAction）并同步，槽位未分配时返回false
+    bool apply_action(int slot, int action);
+
+    // 在一个槽位上重新开始游戏
+    bool restart(int slot);
+
+    // 推进所有已分配的槽位一步：actions长度为capacity()，空闲槽位的动作被忽略
+    // auto_reset为true时，已结束的游戏在本步开始前自动重新开始
+    void step(const uint8_t* actions, bool auto_reset);
+
+    // 批量查询
+
+    // 进行中的游戏局数
+    int count_alive() const;
+
+    // 分数最高的k局（已分配的槽位中，包括已结束的游戏）：按分数从高到低写入out_slots和out_scores，
+    // 分数相同时槽位号小的在前；返回写入的数量（已分配的槽位少于k时少于k）
+    int top_scores(int k, int* out_slots, int32_t* out_scores) const;
+
+    // 分数直方图：第b个桶统计分数在[b*bucket_width, (b+1)*bucket_width)内的局数，
+    // 超过最后一个桶的分数计入最后一个桶；返回统计的局数
+    int score_histogram(int bucket_width, int bucket_count, uint32_t* out_counts) const;
+
+    // 平行数组（只读），下标是槽位号；空闲槽位的分数为INT32_MIN
+    const int32_t* scores() const { return scores_.data(); }
+    const uint8_t* status() const { return status_.data(); }
+
+private:
+    std::vector<TetrisGame> games_; // 全部游戏实例（连续存放，只分配一次）
+    std::vector<int32_t> scores_;   // 每个槽位的分数
+    std::vector<uint8_t> status_;   // 每个槽位的状态（PoolSlotStatus）
+    std::vector<int> free_slots_;   // 空闲槽位号（栈）
+};
+
+// 定义C风格的游戏池API接口
+extern "C" {
+    // 创建可容纳capacity局游戏的游戏池
+    API_EXPORT TetrisPool* create_pool(int capacity);
+
+    // 销毁游戏池
+    API_EXPORT void destroy_pool(TetrisPool* pool);
+
+    // 分配一个槽位并开始新游戏（seed为0时自动派生种子），返回槽位号，没有空闲槽位时返回-1
+    API_EXPORT int pool_acquire_api(TetrisPool* pool, uint64_t seed);
+
+    // 释放槽位
+    API_EXPORT bool pool_release_api(TetrisPool* pool, int slot);
+
+    // 获取槽位上的游戏，可以配合单局游戏的API使用（修改后需调用pool_sync_api）；槽位未分配时返回NULL
+    API_EXPORT TetrisGame* pool_get_game_api(TetrisPool* pool, int slot);
+
+    // 把槽位上游戏的分数和状态同步到游戏池
+    API_EXPORT void pool_sync_api(TetrisPool* pool, int slot);
+
+    // 对一个槽位执行动作
+    API_EXPORT bool pool_apply_action_api(TetrisPool* pool, int slot, int action);
+
+    // 推进所有已分配的槽位一步（actions长度为游戏池容量）
+    API_EXPORT void pool_step_api(TetrisPool* pool, const uint8_t* actions, bool auto_reset);
+
+    // 进行中的游戏局数
+    API_EXPORT int pool_count_alive_api(TetrisPool* pool);
+
+    // 分数最高的k局，返回写入的数量
+    API_EXPORT int pool_top_scores_api(TetrisPool* pool, int k, int* out_slots, int32_t* out_scores);
+
+    // 分数直方图，返回统计的局数
+    API_EXPORT int pool_score_histogram_api(TetrisPool* pool, int bucket_width, int bucket_count, uint32_t* out_counts);
+}
+
+#endif // TETRIS_POOL_H
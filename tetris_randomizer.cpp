@@ -0,0 +1,105 @@
+// tetris_randomizer.cpp
+// 方块生成器的实现：各随机方式的抽取函数和批量补满队列
+#include "tetris_randomizer.h"
+#include "tetris_pieces.h" // 方块表
+
+// 历史随机方式的初始历史：S、Z各两个，开局的头几个方块不容易是S或Z
+static const uint8_t INITIAL_HISTORY[PieceQueue::HISTORY_SIZE] = {
+    PieceTable::PIECE_Z, PieceTable::PIECE_S, PieceTable::PIECE_Z, PieceTable::PIECE_S
+};
+
+// 统计掩码中1的个数
+static inline int count_bits(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(mask);
+#else
+    int count = 0;
+    for (; mask; mask &= mask - 1) ++count;
+    return count;
+#endif
+}
+
+// 各随机方式的抽取函数：给出下一个方块的类型，并更新队列中该方式自己的状态
+
+// 均匀随机
+struct UniformDraw {
+    static int draw(PieceQueue&, TetrisRng& rng) {
+        return static_cast<int>(rng.next_below(PieceTable::PIECE_TYPES));
+    }
+};
+
+// 7袋：从这一袋剩下的类型中等概率选一个，袋子空了就换一袋新的
+struct Bag7Draw {
+    static int draw(PieceQueue& queue, TetrisRng& rng) {
+        if (queue.bag == 0) queue.bag = PieceQueue::FULL_BAG;
+        uint32_t remaining = queue.bag;
+        for (uint32_t k = rng.next_below(static_cast<uint32_t>(count_bits(remaining))); k > 0; --k) {
+            remaining &= remaining - 1; // 跳过前k个还在袋中的类型
+        }
+        uint32_t picked = remaining & (0u - remaining); // 第k个还在袋中的类型
+        queue.bag = static_cast<uint8_t>(queue.bag & ~picked);
+        return count_bits(picked - 1);
+    }
+};
+
+// 历史：与最近几个方块相同时重新抽取，最后一次抽到的结果无论如何都接受
+struct HistoryDraw {
+    static int draw(PieceQueue& queue, TetrisRng& rng) {
+        int type = 0;
+        for (int roll = 0; roll < PieceQueue::HISTORY_ROLLS; ++roll) {
+            type = static_cast<int>(rng.next_below(PieceTable::PIECE_TYPES));
+            bool seen = false;
+            for (int i = 0; i < PieceQueue::HISTORY_SIZE; ++i) {
+                seen |= queue.history[i] == type;
+            }
+            if (!seen) break;
+        }
+        for (int i = PieceQueue::HISTORY_SIZE - 1; i > 0; --i) {
+            queue.history[i] = queue.history[i - 1];
+        }
+        queue.history[0] = static_cast<uint8_t>(type);
+        return type;
+    }
+};
+
+// 按抽取函数Draw补满队列
+// 类型由Draw决定；旋转状态取一个随机数的最高2位，生成列用剩下的30位按乘法映射到该形状在
+// board_width列宽的棋盘上的生成范围
+template <typename Draw>
+static void fill_queue(PieceQueue& queue, TetrisRng& rng, int board_width) {
+    for (int i = queue.count; i < PieceQueue::CAPACITY; ++i) {
+        int type = Draw::draw(queue, rng);
+        uint32_t bits = rng.next();
+        int rotation = static_cast<int>(bits >> 30);
+        const TetrominoShape& shape = PieceTable::shape(type, rotation);
+        uint32_t span = static_cast<uint32_t>(shape.spawn_x_count(board_width));
+        int x = shape.spawn_min_x + static_cast<int>((static_cast<uint64_t>(bits << 2) * span) >> 32);
+        queue.entries[(queue.head + i) & (PieceQueue::CAPACITY - 1)] = PieceQueue::encode(type, rotation, x);
+    }
+    queue.count = static_cast<uint8_t>(PieceQueue::CAPACITY);
+}
+
+void PieceQueue::reset(int randomizer_kind) {
+    head = 0;
+    count = 0;
+    randomizer = static_cast<uint8_t>(randomizer_kind);
+    bag = 0;
+    for (int i = 0; i < HISTORY_SIZE; ++i) {
+        history[i] = INITIAL_HISTORY[i];
+    }
+}
+
+// 每次补满只在这里按随机方式分派一次，循环内部的抽取函数都是内联的
+void PieceQueue::refill(TetrisRng& rng, int board_width) {
+    switch (randomizer) {
+    case RANDOMIZER_UNIFORM:
+        fill_queue<UniformDraw>(*this, rng, board_width);
+        break;
+    case RANDOMIZER_HISTORY:
+        fill_queue<HistoryDraw>(*this, rng, board_width);
+        break;
+    default:
+        fill_queue<Bag7Draw>(*this, rng, board_width);
+        break;
+    }
+}
@@ -0,0 +1,78 @@
+// tetris_randomizer.h
+// 方块生成器：可替换的随机方式和后续方块的预览队列
+// 每局游戏有一个环形的预览队列，里面是接下来要出现的方块（类型、旋转状态和生成列）。
+// 生成新方块只是从队首取一项；队列剩下的项不足PREVIEW_MAX时，一次性用本局的随机数生成器
+// 补满整个队列，随机数的开销集中在一个紧凑的循环里，不落在每个方块的生成路径上。
+// 队列保证任何时候至少有PREVIEW_MAX项，界面的“下一个”预览和向后看的机器人都直接读它。
+//
+// 随机方式（RandomizerKind）决定方块类型的序列：
+//   均匀随机：每个方块独立地从7种中选一种，可能连续很多个同一种，也可能很久不出某一种
+//   7袋：每7个方块是7种方块的一个随机排列，同一种方块最多隔12个出现一次，对局长度和分数的方差小得多
+//   历史：记住最近4个方块，新方块与其中之一相同时重新抽取（最多HISTORY_ROLLS次）
+// 旋转状态和生成列与原来一样均匀随机，与类型合用一个随机数。
+// 新增随机方式只需要在枚举中加一项，并在tetris_randomizer.cpp中实现对应的抽取函数。
+//
+// PieceQueue是POD结构体，放在GameState中：快照、恢复、求解器的向后看都会带上队列和随机方式的状态。
+#ifndef TETRIS_RANDOMIZER_H // 防止头文件被重复包含的保护宏
+#define TETRIS_RANDOMIZER_H
+
+#include <cstdint>          // 固定宽度整数类型
+#include "tetris_random.h"  // 每局游戏的随机数生成器
+
+// 方块类型的随机方式
+enum RandomizerKind {
+    RANDOMIZER_UNIFORM = 0, // 均匀随机
+    RANDOMIZER_BAG7 = 1,    // 7袋（默认）
+    RANDOMIZER_HISTORY = 2, // 历史重抽
+    RANDOMIZER_COUNT = 3    // 随机方式数量（不是有效的随机方式）
+};
+
+// 预览队列
+// 每一项是一个16位编码：低3位类型，第3-4位旋转状态，高8位生成列（有符号）
+struct PieceQueue {
+    static const int CAPACITY = 16;     // 队列容量（2的幂）
+    static const int PREVIEW_MAX = 8;   // 随时可以预览的方块数
+    static const int HISTORY_SIZE = 4;  // 历史随机方式记住的方块数
+    static const int HISTORY_ROLLS = 6; // 历史随机方式的最多抽取次数
+    static const uint8_t FULL_BAG = 0x7f; // 7袋：7种方块都还没有抽出
+
+    uint16_t entries[CAPACITY]; // 环形缓冲区
+    uint8_t head;               // 队首下标
+    uint8_t count;              // 队列中的项数
+    uint8_t randomizer;         // 随机方式（RandomizerKind）
+    uint8_t bag;                // 7袋：当前这一袋中还没有抽出的类型（第t位对应类型t）
+    uint8_t history[HISTORY_SIZE]; // 历史：最近生成的方块类型，history[0]是最新的
+
+    // 清空队列，按指定的随机方式重新开始（开局时调用）
+    void reset(int randomizer_kind);
+
+    // 用rng把队列补满（只生成类型、旋转和生成列，不检查碰撞）
+    // 生成列按board_width列宽的棋盘计算，保证方块完全在棋盘内
+    void refill(TetrisRng& rng, int board_width);
+
+    // 取出队首的一项；队列不足PREVIEW_MAX项时先补满
+    uint16_t pop(TetrisRng& rng, int board_width) {
+        if (count <= PREVIEW_MAX) refill(rng, board_width);
+        uint16_t entry = entries[head];
+        head = static_cast<uint8_t>((head + 1) & (CAPACITY - 1));
+        count--;
+        return entry;
+    }
+
+    // 第i项（0是下一个方块），调用方保证i < count
+    uint16_t peek(int i) const {
+        return entries[(head + i) & (CAPACITY - 1)];
+    }
+
+    // 编码和解码一项
+    static uint16_t encode(int type, int rotation, int x) {
+        return static_cast<uint16_t>(type | (rotation << 3) | (static_cast<uint8_t>(x) << 8));
+    }
+    static int entry_type(uint16_t entry) { return entry & 7; }
+    static int entry_rotation(uint16_t entry) { return (entry >> 3) & 3; }
+    static int entry_x(uint16_t entry) { return static_cast<int8_t>(entry >> 8); }
+};
+static_assert((PieceQueue::CAPACITY & (PieceQueue::CAPACITY - 1)) == 0, "预览队列容量必须是2的幂");
+static_assert(PieceQueue::PREVIEW_MAX < PieceQueue::CAPACITY, "预览数必须小于队列容量");
+
+#endif // TETRIS_RANDOMIZER_H
@@ -0,0 +1,100 @@
+// tetris_replay.cpp
+// 回放日志编码器和回放引擎的实现
+#include "tetris_replay.h"
+#include "tetris_game.h"
+
+// 日志魔数
+static const uint8_t REPLAY_MAGIC[4] = {'T', 'T', 'R', 'P'};
+
+ReplayLog::ReplayLog() {
+}
+
+// 开始记录新的一局：写入魔数、版本、随机方式和种子
+void ReplayLog::begin(uint64_t seed, int randomizer) {
+    bytes_.assign(REPLAY_HEADER_SIZE, 0); // 保留字节为0
+    for (int i = 0; i < 4; ++i) {
+        bytes_[i] = REPLAY_MAGIC[i];
+    }
+    bytes_[4] = static_cast<uint8_t>(REPLAY_FORMAT_VERSION);
+    bytes_[5] = static_cast<uint8_t>(randomizer);
+    for (int i = 0; i < 8; ++i) {
+        bytes_[8 + i] = static_cast<uint8_t>(seed >> (8 * i)); // 小端序写入种子
+    }
+}
+
+// 清空日志
+void ReplayLog::clear() {
+    bytes_.clear();
+}
+
+// 追加一个动作（游程编码）
+void ReplayLog::record(int action) {
+    if (bytes_.size() < static_cast<size_t>(REPLAY_HEADER_SIZE)) return; // 还没有begin，不记录
+    if (bytes_.size() > static_cast<size_t>(REPLAY_HEADER_SIZE)) {
+        uint8_t& last = bytes_.back();
+        int last_action = last & 7;
+        int last_run = (last >> 3) + 1;
+        if (last_action == action && last_run < REPLAY_MAX_RUN) {
+            last = static_cast<uint8_t>(last_action | (last_run << 3)); // 次数加1
+            return;
+        }
+    }
+    bytes_.push_back(static_cast<uint8_t>(action & 7)); // 新的一段，次数为1
+}
+
+// 日志内容
+const uint8_t* ReplayLog::data() const {
+    return bytes_.empty() ? nullptr : &bytes_[0];
+}
+
+size_t ReplayLog::size() const {
+    return bytes_.size();
+}
+
+// 回放引擎：解析头部，用同一个随机方式和种子开局，然后依次执行所有动作
+bool replay_game(const uint8_t* data, size_t size, ReplayResult* out_result) {
+    if (!data || size < static_cast<size_t>(REPLAY_HEADER_SIZE)) return false;
+    for (int i = 0; i < 4; ++i) {
+        if (data[i] != REPLAY_MAGIC[i]) return false; // 不是回放日志
+    }
+    if (data[4] != REPLAY_FORMAT_VERSION) return false; // 不支持的格式版本
+
+    uint64_t seed = 0;
+    for (int i = 0; i < 8; ++i) {
+        seed |= static_cast<uint64_t>(data[8 + i]) << (8 * i);
+    }
+
+    TetrisGame game;
+    if (!game.set_randomizer(data[5])) return false; // 无效的随机方式
+    game.start_new_game_seeded(seed);
+    uint32_t actions = 0;
+    for (size_t i = REPLAY_HEADER_SIZE; i < size; ++i) {
+        int action = data[i] & 7;
+        int run = (data[i] >> 3) + 1;
+        if (action >= ACTION_COUNT) return false; // 无效的动作编码
+        for (int k = 0; k < run; ++k) {
+            game.apply_action(action);
+        }
+        actions += run;
+    }
+
+    if (out_result) {
+        out_result->score = game.get_score();
+        out_result->game_over = game.is_game_over();
+        out_result->actions = actions;
+    }
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// C语言风格的回放API函数实现
+//------------------------------------------------------------------------------
+
+// 回放一段日志，输出最终分数和结束标志
+API_EXPORT bool replay_log_api(const uint8_t* data, size_t size, int* out_score, bool* out_game_over) {
+    ReplayResult result;
+    if (!replay_game(data, size, &result)) return false;
+    if (out_score) *out_score = result.score;
+    if (out_game_over) *out_game_over = result.game_over;
+    return true;
+}
@@ -0,0 +1,61 @@
+// tetris_replay.h
+// 紧凑的二进制回放日志和回放引擎
+// 游戏是确定性的：只要知道开局种子、随机方式和依次执行的动作，就能完整复现一局游戏。
+// 因此日志只记录种子、随机方式和动作序列，服务器可以据此重新模拟、校验分数，复现线上问题，
+// 而不需要保存任何棋盘快照。
+//
+// 日志格式（小端序）：
+//   字节0-3   魔数 "TTRP"
+//   字节4     格式版本（REPLAY_FORMAT_VERSION）
+//   字节5     随机方式（RandomizerKind）
+//   字节6-7   保留，写0
+//   字节8-15  开局种子（start_new_game_seeded使用的种子）
+//   之后每个字节记录一段连续的相同动作：
+//     低3位 = 动作编码（见TetrisAction）
+//     高5位 = 重复次数 - 1（一个字节最多表示32次连续的相同动作）
+// 连续的tick占日志的绝大部分，游程编码后一般每次落块只需要几个字节
+#ifndef TETRIS_REPLAY_H // 防止头文件被重复包含的保护宏
+#define TETRIS_REPLAY_H
+
+#include <vector>   // 日志字节缓冲区
+#include <cstdint>  // 固定宽度整数类型
+#include <cstddef>  // size_t
+
+const int REPLAY_FORMAT_VERSION = 3;  // 当前日志格式版本（2：SRS方块和旋转规则；3：预览队列和随机方式）
+const int REPLAY_HEADER_SIZE = 16;    // 日志头部字节数
+const int REPLAY_MAX_RUN = 32;        // 一个字节能表示的最大连续次数
+
+// 回放日志编码器：记录一局游戏的种子和动作序列
+class ReplayLog {
+public:
+    ReplayLog();
+
+    // 开始记录新的一局：清空日志并写入头部
+    void begin(uint64_t seed, int randomizer);
+
+    // 清空日志（不再保留任何内容）
+    void clear();
+
+    // 追加一个动作；与上一个动作相同且未达到最大次数时合并到同一个字节
+    void record(int action);
+
+    // 日志内容
+    const uint8_t* data() const;
+    size_t size() const;
+
+private:
+    std::vector<uint8_t> bytes_; // 编码后的日志
+};
+
+// 回放结果
+struct ReplayResult {
+    int score;          // 回放结束时的分数
+    bool game_over;     // 回放结束时游戏是否已经结束
+    uint32_t actions;   // 回放的动作总数
+};
+
+// 回放引擎：按日志重新模拟一局游戏
+// 日志格式错误（魔数、版本、长度、随机方式不对）时返回false
+bool replay_game(const uint8_t* data, size_t size, ReplayResult* out_result);
+
+#endif // TETRIS_REPLAY_H
@@ -0,0 +1,374 @@
+// tetris_savestate.cpp
+// 存档记录的编解码和会话检查点的实现
+#include "tetris_savestate.h"
+#include "tetris_session.h"
+#include "tetris_gravity.h" // 恢复的会话重新登记自动下落
+#include <cerrno>  // 写入被信号打断时重试
+#include <cstdio>  // std::rename、Windows下的文件读写
+#include <mutex>   // 串行化检查点的写入
+#include <string>  // 临时文件名
+#include <vector>  // 检查点的内存映像
+
+#ifdef _WIN32
+#include <windows.h>  // MoveFileExA：覆盖已存在的目标文件
+#else
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // write、fsync、close
+#endif
+
+// 存档记录和检查点文件的魔数（按小端序读出的32位整数）
+static const uint32_t SAVE_MAGIC = 'T' | ('T' << 8) | ('S' << 16) | (static_cast<uint32_t>('V') << 24);
+static const uint32_t CHECKPOINT_MAGIC = 'T' | ('T' << 8) | ('C' << 16) | (static_cast<uint32_t>('K') << 24);
+
+// 校验和覆盖的范围：checksum字段之后直到记录末尾
+static const size_t CHECKSUM_OFFSET = 12;
+static_assert((sizeof(SaveRecord) - CHECKSUM_OFFSET) % 4 == 0, "校验和按32位字计算");
+
+// 解码后整个棋盘都是脏行
+static const uint32_t ALL_ROWS_DIRTY = static_cast<uint32_t>((1ull << BOARD_HEIGHT) - 1);
+
+// 最低的置位位置（mask不能为0）
+static inline int lowest_bit(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_ctz(mask);
+#else
+    int bit = 0;
+    while (!(mask & 1)) {
+        mask >>= 1;
+        ++bit;
+    }
+    return bit;
+#endif
+}
+
+// 记录的校验和：FNV-1a按32位字而不是按字节计算，每条记录只需要41次乘法
+static uint32_t record_checksum(const SaveRecord& record) {
+    const uint8_t* bytes = reinterpret_cast<const uint8_t*>(&record) + CHECKSUM_OFFSET;
+    uint32_t hash = 2166136261u;
+    for (size_t i = 0; i < sizeof(SaveRecord) - CHECKSUM_OFFSET; i += 4) {
+        uint32_t word;
+        memcpy(&word, bytes + i, 4);
+        hash = (hash ^ word) * 16777619u;
+    }
+    return hash;
+}
+
+// 编码：标量字段直接复制，棋盘按颜色的3个比特拆成3个位平面
+// 游戏状态中的棋盘只有已固定的方块；存档中的棋盘与客户端看到的一致，包括当前方块
+void encode_save_record(const GameState& state, SaveRecord* out) {
+    memset(out, 0, sizeof(SaveRecord)); // 保留字节和空行的位平面都为0
+    out->magic = SAVE_MAGIC;
+    out->version = static_cast<uint16_t>(SAVE_FORMAT_VERSION);
+    out->size = static_cast<uint16_t>(sizeof(SaveRecord));
+    out->score = state.score;
+    out->lines = state.lines;
+    out->cleared_rows = state.cleared_rows;
+    out->frame_seq = state.frame_seq;
+    out->tick_speed_control = state.tick_speed_control;
+    for (int i = 0; i < 4; ++i) {
+        out->rng[i] = state.rng.s[i];
+    }
+    out->piece_type = static_cast<uint8_t>(state.piece_type);
+    out->rotation = static_cast<uint8_t>(state.rotation);
+    out->piece_x = static_cast<int8_t>(state.piece_pos.x);
+    out->piece_y = static_cast<int8_t>(state.piece_pos.y);
+    out->game_over = state.game_over ? 1 : 0;
+    out->randomizer = state.next_pieces.randomizer;
+    out->queue_count = state.next_pieces.count;
+    out->bag = state.next_pieces.bag;
+    for (int i = 0; i < PieceQueue::HISTORY_SIZE; ++i) {
+        out->history[i] = state.next_pieces.history[i];
+    }
+    for (int i = 0; i < state.next_pieces.count; ++i) {
+        out->next_pieces[i] = state.next_pieces.peek(i);
+    }
+
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        RowMask occupied = state.rows[y];
+        // 只遍历有方块的格子；空行（通常是棋盘的大半）直接跳过
+        while (occupied) {
+            int x = lowest_bit(occupied);
+            occupied &= static_cast<RowMask>(occupied - 1);
+            int color = state.board[y][x];
+            for (int k = 0; k < SAVE_COLOR_PLANES; ++k) {
+                out->planes[k][y] |= static_cast<uint16_t>(((color >> k) & 1) << x);
+            }
+        }
+    }
+    if (!state.game_over) {
+        const TetrominoShape& shape = PieceTable::shape(state.piece_type, state.rotation);
+        int color = state.piece_type + 1;
+        for (int i = 0; i < 4; ++i) {
+            int x = state.piece_pos.x + shape.blocks[i].x;
+            int y = state.piece_pos.y + shape.blocks[i].y;
+            for (int k = 0; k < SAVE_COLOR_PLANES; ++k) {
+                out->planes[k][y] |= static_cast<uint16_t>(((color >> k) & 1) << x);
+            }
+        }
+    }
+    out->checksum = record_checksum(*out);
+}
+
+// 解码：先校验头部和校验和，再由位平面重建颜色平面和占用层
+bool decode_save_record(const SaveRecord& record, GameState* out) {
+    if (record.magic != SAVE_MAGIC) return false;                 // 不是存档记录
+    if (record.version != SAVE_FORMAT_VERSION) return false;      // 不支持的格式版本
+    if (record.size != sizeof(SaveRecord)) return false;          // 长度不对
+    if (record.checksum != record_checksum(record)) return false; // 内容损坏
+    // 校验和只能发现意外损坏，伪造的记录可以算出正确的校验和，所以每个字段还要核对是否是游戏可能产生的值
+    if (record.piece_type >= 7 || record.rotation >= 4 || record.game_over > 1) return false;
+    // 分数和行数只增不减；负分数会被游戏池当成空闲槽位（INT32_MIN正是空闲标记），打乱池的统计
+    if (record.score < 0 || record.lines < 0) return false;
+    if (record.tick_speed_control != 0) return false; // 游戏只会把它重置为0
+
+    GameState state;
+    memset(&state, 0, sizeof(state));
+    const RowMask outside = static_cast<RowMask>(~FULL_ROW_MASK);
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        RowMask occupied = static_cast<RowMask>(record.planes[0][y] | record.planes[1][y] | record.planes[2][y]);
+        if (occupied & outside) return false; // 棋盘之外的列不能有方块
+        state.rows[y] = occupied;
+        while (occupied) {
+            int x = lowest_bit(occupied);
+            occupied &= static_cast<RowMask>(occupied - 1);
+            state.board[y][x] = ((record.planes[0][y] >> x) & 1) |
+                                (((record.planes[1][y] >> x) & 1) << 1) |
+                                (((record.planes[2][y] >> x) & 1) << 2);
+        }
+    }
+
+    state.dirty_rows = ALL_ROWS_DIRTY;
+    state.frame_seq = record.frame_seq;
+    state.score = record.score;
+    state.lines = record.lines;
+    state.cleared_rows = record.cleared_rows;
+    state.game_over = record.game_over != 0;
+    state.piece_type = record.piece_type;
+    state.rotation = record.rotation;
+    state.piece_pos.x = record.piece_x;
+    state.piece_pos.y = record.piece_y;
+    state.tick_speed_control = record.tick_speed_control;
+    for (int i = 0; i < 4; ++i) {
+        state.rng.s[i] = record.rng[i];
+    }
+    if ((state.rng.s[0] | state.rng.s[1] | state.rng.s[2] | state.rng.s[3]) == 0) return false; // 全零状态无效
+
+    // 预览队列：每一项的类型、旋转和生成列都必须是补满队列时可能生成的值
+    if (record.randomizer >= RANDOMIZER_COUNT || record.queue_count > PieceQueue::CAPACITY) return false;
+    if (record.bag & ~PieceQueue::FULL_BAG) return false;
+    state.next_pieces.randomizer = record.randomizer;
+    state.next_pieces.bag = record.bag;
+    for (int i = 0; i < PieceQueue::HISTORY_SIZE; ++i) {
+        if (record.history[i] >= PieceTable::PIECE_TYPES) return false;
+        state.next_pieces.history[i] = record.history[i];
+    }
+    for (int i = 0; i < record.queue_count; ++i) {
+        uint16_t entry = record.next_pieces[i];
+        int type = PieceQueue::entry_type(entry);
+        if (type >= PieceTable::PIECE_TYPES || (entry & 0xe0) != 0) return false;
+        const TetrominoShape& next_shape = PieceTable::shape(type, PieceQueue::entry_rotation(entry));
+        int x = PieceQueue::entry_x(entry);
+        if (x < next_shape.spawn_min_x || x >= next_shape.spawn_min_x + next_shape.spawn_x_count(BOARD_WIDTH)) return false;
+        state.next_pieces.entries[i] = entry;
+    }
+    state.next_pieces.head = 0;
+    state.next_pieces.count = record.queue_count;
+
+    // 游戏进行中时，存档的棋盘包括当前方块：每个组成块都必须在棋盘内且颜色与方块类型一致，
+    // 核对后从棋盘中去掉，游戏状态中只保留已固定的方块
+    if (!state.game_over) {
+        const TetrominoShape& shape = PieceTable::shape(state.piece_type, state.rotation);
+        for (int i = 0; i < 4; ++i) {
+            int x = state.piece_pos.x + shape.blocks[i].x;
+            int y = state.piece_pos.y + shape.blocks[i].y;
+            if (x < 0 || x >= BOARD_WIDTH || y < 0 || y >= BOARD_HEIGHT) return false;
+            if (state.board[y][x] != state.piece_type + 1) return false;
+        }
+        for (int i = 0; i < 4; ++i) {
+            int x = state.piece_pos.x + shape.blocks[i].x;
+            int y = state.piece_pos.y + shape.blocks[i].y;
+            state.board[y][x] = 0;
+            state.rows[y] &= static_cast<RowMask>(~(1u << x));
+        }
+    }
+
+    // 表面高度不在存档中，由已固定的方块重新计算
+    uint32_t pending = FULL_ROW_MASK; // 还没有找到表面的列
+    for (int y = 0; y < BOARD_HEIGHT && pending; ++y) {
+        uint32_t first = state.rows[y] & pending;
+        pending &= ~first;
+        for (; first; first &= first - 1) {
+            state.column_heights[lowest_bit(first)] = static_cast<uint8_t>(BOARD_HEIGHT - y);
+        }
+    }
+
+    memcpy(out, &state, sizeof(state));
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// 检查点文件
+//------------------------------------------------------------------------------
+
+// 把内存中的检查点映像写入文件：先写临时文件并刷到磁盘，再改名覆盖目标文件
+static bool write_file_atomic(const std::string& path, const std::vector<uint8_t>& data) {
+    std::string temp_path = path + ".tmp";
+#ifdef _WIN32
+    FILE* file = fopen(temp_path.c_str(), "wb");
+    if (!file) return false;
+    bool ok = fwrite(data.data(), 1, data.size(), file) == data.size();
+    ok = fclose(file) == 0 && ok;
+    if (ok) ok = MoveFileExA(temp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != 0;
+#else
+    int fd = open(temp_path.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) return false;
+    bool ok = true;
+    for (size_t written = 0; ok && written < data.size(); ) {
+        ssize_t n = write(fd, data.data() + written, data.size() - written);
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0) ok = false;
+        else written += static_cast<size_t>(n);
+    }
+    ok = ok && fsync(fd) == 0; // 改名之前确保内容已经落盘，断电后不会得到半个文件
+    ok = close(fd) == 0 && ok;
+    if (ok) ok = std::rename(temp_path.c_str(), path.c_str()) == 0;
+#endif
+    if (!ok) std::remove(temp_path.c_str());
+    return ok;
+}
+
+// 把所有会话写入检查点文件
+int checkpoint_sessions(const char* path) {
+    if (!path) return -1;
+    static std::mutex write_mutex; // 同时只有一个检查点在写同一个临时文件
+    std::lock_guard<std::mutex> write_lock(write_mutex);
+
+    SessionRegistry& registry = SessionRegistry::instance();
+    // 先按当前会话数预留空间（再留一些余量给编码期间新建的会话），编码时持有分片锁期间尽量不重新分配
+    size_t reserve = static_cast<size_t>(registry.size());
+    reserve += reserve / 8 + 64;
+    std::vector<uint8_t> image;
+    image.reserve(sizeof(CheckpointHeader) + reserve * sizeof(CheckpointEntry));
+    image.resize(sizeof(CheckpointHeader));
+
+    uint32_t count = 0;
+    registry.for_each([&](SessionId id, const TetrisGame& game) {
+        size_t offset = image.size();
+        image.resize(offset + sizeof(CheckpointEntry));
+        CheckpointEntry* entry = reinterpret_cast<CheckpointEntry*>(&image[offset]);
+        entry->session_id = id;
+        encode_save_record(game.get_state(), &entry->record);
+        count++;
+    });
+
+    CheckpointHeader header;
+    header.magic = CHECKPOINT_MAGIC;
+    header.version = static_cast<uint16_t>(CHECKPOINT_FORMAT_VERSION);
+    header.entry_size = static_cast<uint16_t>(sizeof(CheckpointEntry));
+    header.count = count;
+    header.reserved = 0;
+    memcpy(&image[0], &header, sizeof(header));
+
+    if (!write_file_atomic(path, image)) return -1;
+    return static_cast<int>(count);
+}
+
+// 从映射到内存的检查点映像恢复会话：记录就地解码，不需要额外的解析或复制
+static int restore_from_image(const uint8_t* data, size_t size, bool register_gravity) {
+    if (size < sizeof(CheckpointHeader)) return -1;
+    CheckpointHeader header;
+    memcpy(&header, data, sizeof(header));
+    if (header.magic != CHECKPOINT_MAGIC || header.version != CHECKPOINT_FORMAT_VERSION) return -1;
+    if (header.entry_size != sizeof(CheckpointEntry)) return -1;
+    if (size != sizeof(CheckpointHeader) + static_cast<size_t>(header.count) * sizeof(CheckpointEntry)) return -1; // 文件被截断
+
+    // 映射的起始地址按页对齐，文件头16字节，之后每条记录都按8字节对齐，可以直接当作数组访问
+    const CheckpointEntry* entries = reinterpret_cast<const CheckpointEntry*>(data + sizeof(CheckpointHeader));
+    SessionRegistry& registry = SessionRegistry::instance();
+    int restored = 0;
+    for (uint32_t i = 0; i < header.count; ++i) {
+        GameState state;
+        if (!decode_save_record(entries[i].record, &state)) continue; // 损坏的记录只丢掉这一局
+        if (!registry.insert(entries[i].session_id, state)) continue;
+        restored++;
+        // insert返回时已经释放分片锁，登记时调度器会重新锁定会话
+        if (register_gravity && !state.game_over) {
+            GravityScheduler::instance().add(entries[i].session_id);
+        }
+    }
+    return restored;
+}
+
+// 从检查点文件恢复会话
+int restore_sessions(const char* path, bool register_gravity) {
+    if (!path) return -1;
+#ifdef _WIN32
+    FILE* file = fopen(path, "rb");
+    if (!file) return -1;
+    std::vector<uint8_t> data;
+    uint8_t buffer[65536];
+    size_t n;
+    while ((n = fread(buffer, 1, sizeof(buffer), file)) > 0) {
+        data.insert(data.end(), buffer, buffer + n);
+    }
+    fclose(file);
+    return data.empty() ? -1 : restore_from_image(data.data(), data.size(), register_gravity);
+#else
+    int fd = open(path, O_RDONLY);
+    if (fd < 0) return -1;
+    struct stat info;
+    if (fstat(fd, &info) != 0 || info.st_size <= 0) {
+        close(fd);
+        return -1;
+    }
+    size_t size = static_cast<size_t>(info.st_size);
+    void* mapped = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+    close(fd); // 映射建立后文件描述符就不再需要了
+    if (mapped == MAP_FAILED) return -1;
+    madvise(mapped, size, MADV_SEQUENTIAL); // 按顺序读一遍，提示内核预读
+    int restored = restore_from_image(static_cast<const uint8_t*>(mapped), size, register_gravity);
+    munmap(mapped, size);
+    return restored;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// C语言风格的存档API函数实现
+//------------------------------------------------------------------------------
+
+// 存档记录的字节数
+API_EXPORT size_t get_save_record_size_api() {
+    return sizeof(SaveRecord);
+}
+
+// 把游戏存档写入out
+API_EXPORT size_t serialize_game_api(TetrisGame* game, uint8_t* out, size_t size) {
+    if (!game || !out || size < sizeof(SaveRecord)) return 0;
+    SaveRecord record;
+    encode_save_record(game->get_state(), &record);
+    memcpy(out, &record, sizeof(record)); // 调用方的缓冲区不一定对齐
+    return sizeof(record);
+}
+
+// 用存档覆盖游戏状态
+API_EXPORT bool deserialize_game_api(TetrisGame* game, const uint8_t* data, size_t size) {
+    if (!game || !data || size < sizeof(SaveRecord)) return false;
+    SaveRecord record;
+    memcpy(&record, data, sizeof(record));
+    GameState state;
+    if (!decode_save_record(record, &state)) return false;
+    game->restore_state(state);
+    return true;
+}
+
+// 把所有会话写入检查点文件
+API_EXPORT int checkpoint_sessions_api(const char* path) {
+    return checkpoint_sessions(path);
+}
+
+// 从检查点文件恢复会话
+API_EXPORT int restore_sessions_api(const char* path, bool register_gravity) {
+    return restore_sessions(path, register_gravity);
+}
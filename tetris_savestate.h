@@ -0,0 +1,118 @@
+// tetris_savestate.h
+// 紧凑的二进制存档格式和会话检查点
+// GameState为了运行速度，每个格子用一个int，直接保存它有八百多字节，并且布局随编译器变化。
+// 存档记录（SaveRecord）是固定大小、带版本号的二进制格式：棋盘按颜色拆成3个位平面，
+// 每个平面每行一个16位掩码，整条记录只有212字节，保存和恢复都只是几次按位运算。
+//
+// 检查点把注册表中的所有会话写进同一个文件：文件头之后是定长的(会话ID, 存档记录)数组。
+// 启动时把文件映射进内存，逐条校验后直接恢复，不需要任何文本解析；
+// 写入时逐个分片加锁编码，每把锁只持有编码该分片所需的时间，游戏不会因为检查点而停顿。
+//
+// 存档格式（小端序，所有字段自然对齐）：
+//   字节0-3     魔数 "TTSV"
+//   字节4-5     格式版本（SAVE_FORMAT_VERSION）
+//   字节6-7     记录字节数（sizeof(SaveRecord)）
+//   字节8-11    校验和：字节12到记录末尾的FNV-1a（按32位字）
+//   字节12-55   分数、行数、消行掩码、帧序号、下落计数、随机数状态、当前方块、结束标志和随机方式
+//   字节56-91   随机方式的历史和预览队列（从队首开始依次存放）
+//   字节92-211  棋盘位平面planes[3][BOARD_HEIGHT]：格子颜色的第k位在planes[k]中
+//
+// 检查点文件格式（小端序）：
+//   字节0-15    文件头：魔数 "TTCK"、版本、每条记录的字节数、记录条数
+//   之后        count条CheckpointEntry，每条8字节会话ID + 一条SaveRecord
+#ifndef TETRIS_SAVESTATE_H // 防止头文件被重复包含的保护宏
+#define TETRIS_SAVESTATE_H
+
+#include "tetris_game.h"
+#include <cstddef>  // size_t
+#include <cstdint>  // 固定宽度整数类型
+
+// 存档记录直接以内存布局写入文件，只支持小端序的平台（x86、ARM）
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ != __ORDER_LITTLE_ENDIAN__
+#error "存档格式要求小端序平台"
+#endif
+
+const int SAVE_FORMAT_VERSION = 3;      // 当前存档格式版本（2：SRS方块形状；3：预览队列和随机方式）
+const int CHECKPOINT_FORMAT_VERSION = 1; // 当前检查点文件格式版本
+const int SAVE_COLOR_PLANES = 3;        // 颜色值0-7需要3个位平面
+
+// 一局游戏的存档记录（固定大小，可以直接按字节写入文件或映射回内存）
+// 只保存决定游戏后续走向的状态；回放日志不在其中
+struct SaveRecord {
+    uint32_t magic;            // 魔数 "TTSV"
+    uint16_t version;          // 格式版本
+    uint16_t size;             // 记录字节数
+    uint32_t checksum;         // 校验和（覆盖checksum之后的全部字节）
+    int32_t score;             // 分数
+    int32_t lines;             // 累计消除的行数
+    uint32_t cleared_rows;     // 最近一次消除的行
+    uint32_t frame_seq;        // 帧序号
+    int32_t tick_speed_control; // 下落速度计数器
+    uint32_t rng[4];           // 随机数生成器的状态
+    uint8_t piece_type;        // 当前方块类型（0-6）
+    uint8_t rotation;          // 当前旋转状态（0-3）
+    int8_t piece_x;            // 当前方块的锚点列
+    int8_t piece_y;            // 当前方块的锚点行
+    uint8_t game_over;         // 游戏是否结束（0或1）
+    uint8_t randomizer;        // 随机方式（RandomizerKind）
+    uint8_t queue_count;       // 预览队列中的项数
+    uint8_t bag;               // 7袋中还没有抽出的类型
+    uint8_t history[PieceQueue::HISTORY_SIZE];    // 历史随机方式记住的方块类型
+    uint16_t next_pieces[PieceQueue::CAPACITY];   // 预览队列，next_pieces[0]是下一个方块，queue_count之后写0
+    uint16_t planes[SAVE_COLOR_PLANES][BOARD_HEIGHT]; // 棋盘位平面（第x位对应第x列）
+};
+static_assert(sizeof(SaveRecord) == 56 + PieceQueue::HISTORY_SIZE + PieceQueue::CAPACITY * 2 + SAVE_COLOR_PLANES * BOARD_HEIGHT * 2,
+              "SaveRecord不能有填充字节");
+
+// 检查点文件中的一条记录
+struct CheckpointEntry {
+    uint64_t session_id; // 会话ID
+    SaveRecord record;   // 会话对应游戏的存档
+};
+
+// 检查点文件头
+struct CheckpointHeader {
+    uint32_t magic;      // 魔数 "TTCK"
+    uint16_t version;    // 文件格式版本
+    uint16_t entry_size; // 每条记录的字节数（sizeof(CheckpointEntry)）
+    uint32_t count;      // 记录条数
+    uint32_t reserved;   // 保留，写0
+};
+static_assert(sizeof(CheckpointHeader) == 16, "CheckpointHeader不能有填充字节");
+static_assert(sizeof(CheckpointEntry) % 8 == 0, "映射后的记录需要按8字节对齐");
+
+// 把游戏状态编码成存档记录
+void encode_save_record(const GameState& state, SaveRecord* out);
+
+// 把存档记录解码成游戏状态（解码后整个棋盘标记为脏行，客户端会收到关键帧）
+// 魔数、版本、长度、校验和不对，或者字段超出范围、当前方块与棋盘不一致时返回false
+bool decode_save_record(const SaveRecord& record, GameState* out);
+
+// 把注册表中的所有会话写入检查点文件，返回写入的会话数，出错时返回-1
+// 先写到path.tmp再改名，任何时刻path要么是旧的完整检查点，要么是新的完整检查点
+int checkpoint_sessions(const char* path);
+
+// 从检查点文件恢复会话（保留原来的会话ID，已存在的ID会被跳过），返回恢复的会话数
+// 文件不存在或文件头无效时返回-1；单条记录损坏时跳过该条
+// register_gravity为true时，未结束的游戏同时登记到重力调度器
+int restore_sessions(const char* path, bool register_gravity);
+
+// 定义C风格的存档API接口
+extern "C" {
+    // 存档记录的字节数
+    API_EXPORT size_t get_save_record_size_api();
+
+    // 把游戏存档写入out（至少get_save_record_size_api()字节），返回写入的字节数，失败时返回0
+    API_EXPORT size_t serialize_game_api(TetrisGame* game, uint8_t* out, size_t size);
+
+    // 用存档覆盖游戏状态，记录无效时返回false且游戏不变
+    API_EXPORT bool deserialize_game_api(TetrisGame* game, const uint8_t* data, size_t size);
+
+    // 把所有会话写入检查点文件，返回写入的会话数，出错时返回-1
+    API_EXPORT int checkpoint_sessions_api(const char* path);
+
+    // 从检查点文件恢复会话，返回恢复的会话数，文件不存在或无效时返回-1
+    API_EXPORT int restore_sessions_api(const char* path, bool register_gravity);
+}
+
+#endif // TETRIS_SAVESTATE_H
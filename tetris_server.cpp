@@ -0,0 +1,795 @@
+// tetris_server.cpp
+// 原生WebSocket游戏服务器（tetris_server可执行文件，仅Linux）
+// 经Flask转发时，每次按键都要经过HTTP、JSON解析、Python GIL和CFFI才能到达TetrisGame，
+// 负载较高时延迟主要花在这层包装上。这个服务器直接链接核心库：
+// 基于epoll的事件循环，每个WebSocket连接对应一局游戏，按键以二进制帧送达，
+// 棋盘和分数的变化以紧凑的二进制帧推回；方块的自动下落由事件循环内的分层时间轮驱动。
+// 同时提供templates/index.html和static/下的文件，前端只需要切换传输方式。
+//
+// 用法：tetris_server [--host=地址] [--port=端口] [--root=目录] [--threads=N] [--tick-ms=毫秒]
+//   --host=地址     监听地址（默认0.0.0.0）
+//   --port=端口     监听端口（默认5000；Flask使用5001，两者可以同时运行）
+//   --root=目录     项目根目录，从中读取templates/和static/（默认当前目录）
+//   --threads=N     事件循环线程数，每个线程独立accept（SO_REUSEPORT），默认等于CPU核数
+//   --tick-ms=毫秒  重力时间轮的节拍长度（默认10）
+//
+// 二进制协议（路径/ws，所有整数为小端序）：
+//   客户端 -> 服务器：每个字节是一条指令，一条消息可以包含多条指令，按顺序执行
+//     1-5   游戏动作（TetrisAction：左移、右移、旋转、硬降、下落一格）
+//     0x80  开始新游戏（没有游戏时创建）
+//     0x81  请求完整棋盘（客户端发现帧序号不连续时重新同步）
+//   服务器 -> 客户端：棋盘帧
+//     [0]     消息类型，1表示棋盘帧
+//     [1]     标志：第0位为完整棋盘（关键帧），第1位为游戏结束
+//     [2..5]  帧序号（uint32）
+//     [6..9]  分数（int32）
+//     [10]    等级
+//     [11]    行数n
+//     之后n组：行号（1字节）+ BOARD_WIDTH个格子的颜色值（每格1字节）
+#include "tetris_game.h"
+#include "tetris_timing_wheel.h"
+#include "tetris_websocket.h"
+#include <algorithm>   // std::min, std::max
+#include <cerrno>      // errno, EAGAIN, EINTR
+#include <chrono>      // 时间轮的节拍计时
+#include <csignal>     // SIGINT/SIGTERM时退出，忽略SIGPIPE
+#include <cstdio>      // 日志输出
+#include <cstdlib>     // atoi
+#include <cstring>     // memcpy, memset, strlen
+#include <fstream>     // 读取页面和静态文件
+#include <memory>      // std::unique_ptr
+#include <sstream>     // 读取整个文件
+#include <string>
+#include <thread>      // 多个事件循环线程
+#include <vector>
+#include <arpa/inet.h>    // inet_pton
+#include <netinet/in.h>   // sockaddr_in
+#include <netinet/tcp.h>  // TCP_NODELAY
+#include <sys/epoll.h>    // epoll事件循环
+#include <sys/resource.h> // 提高文件描述符上限
+#include <sys/socket.h>   // socket, accept4, send, recv
+#include <unistd.h>       // close
+
+// 客户端指令
+static const uint8_t CMD_START = 0x80; // 开始新游戏
+static const uint8_t CMD_SYNC = 0x81;  // 请求完整棋盘
+
+// 服务器消息类型
+static const uint8_t MSG_FRAME = 1;       // 棋盘帧
+static const uint8_t FRAME_FULL = 0x01;   // 标志：完整棋盘
+static const uint8_t FRAME_GAME_OVER = 0x02; // 标志：游戏结束
+static const size_t FRAME_HEADER_BYTES = 12;
+static const size_t MAX_FRAME_BYTES = FRAME_HEADER_BYTES + BOARD_HEIGHT * (BOARD_WIDTH + 1);
+
+static const size_t MAX_REQUEST_BYTES = 8192;   // HTTP请求头的上限
+static const size_t MAX_MESSAGE_BYTES = 1024;   // WebSocket消息的上限（按键消息只有几个字节）
+static const size_t MAX_OUTPUT_BYTES = 1 << 20; // 每个连接未发出数据的上限，超过时认为客户端读得太慢，断开连接
+static const size_t READ_CHUNK_BYTES = 16384;   // 每次recv的缓冲区大小
+static const int MAX_EVENTS = 1024;             // 每次epoll_wait最多取回的事件数
+static const int IDLE_WAIT_MS = 500;            // 没有定时器时epoll_wait的最长等待时间（用于发现退出信号）
+
+// 收到SIGINT/SIGTERM后置位，各事件循环在下一次醒来时退出
+static volatile sig_atomic_t g_stop = 0;
+
+static void handle_stop_signal(int) {
+    g_stop = 1;
+}
+
+// 服务器配置
+struct ServerConfig {
+    std::string host;
+    int port;
+    std::string root;
+    int threads;
+    int tick_ms;
+
+    ServerConfig() : host("0.0.0.0"), port(5000), root("."), threads(0), tick_ms(10) {}
+};
+
+//------------------------------------------------------------------------------
+// 页面和静态文件
+//------------------------------------------------------------------------------
+
+// 读取整个文件，失败时返回false
+static bool read_file(const std::string& path, std::string& out) {
+    std::ifstream in(path.c_str(), std::ios::in | std::ios::binary);
+    if (!in) return false;
+    std::ostringstream content;
+    content << in.rdbuf();
+    out = content.str();
+    return true;
+}
+
+// 渲染游戏页面：模板只用到了Flask的url_for('static', filename='...')，这里直接替换成/static/路径，
+// 并把data-transport标记改成websocket，前端据此改用WebSocket传输
+static std::string render_index(const std::string& tmpl) {
+    std::string out;
+    size_t pos = 0;
+    while (true) {
+        size_t open = tmpl.find("{{", pos);
+        if (open == std::string::npos) break;
+        size_t close = tmpl.find("}}", open);
+        if (close == std::string::npos) break;
+        out.append(tmpl, pos, open - pos);
+        std::string expr = tmpl.substr(open, close + 2 - open);
+        size_t name_begin = expr.find("filename='");
+        size_t name_end = name_begin == std::string::npos ? name_begin : expr.find('\'', name_begin + 10);
+        if (expr.find("url_for('static'") != std::string::npos && name_end != std::string::npos) {
+            out += "/static/" + expr.substr(name_begin + 10, name_end - name_begin - 10);
+        } else {
+            out += expr; // 不认识的表达式原样保留
+        }
+        pos = close + 2;
+    }
+    out.append(tmpl, pos, std::string::npos);
+
+    const std::string http_marker = "data-transport=\"http\"";
+    size_t marker = out.find(http_marker);
+    if (marker != std::string::npos) {
+        out.replace(marker, http_marker.size(), "data-transport=\"websocket\"");
+    }
+    return out;
+}
+
+// 根据扩展名确定Content-Type
+static const char* content_type_for(const std::string& name) {
+    struct MimeType { const char* ext; const char* type; };
+    static const MimeType TYPES[] = {
+        {".html", "text/html; charset=utf-8"},
+        {".js", "application/javascript; charset=utf-8"},
+        {".css", "text/css; charset=utf-8"},
+        {".json", "application/json"},
+        {".png", "image/png"},
+        {".svg", "image/svg+xml"},
+        {".ico", "image/x-icon"},
+    };
+    for (size_t i = 0; i < sizeof(TYPES) / sizeof(TYPES[0]); ++i) {
+        size_t len = strlen(TYPES[i].ext);
+        if (name.size() >= len && name.compare(name.size() - len, len, TYPES[i].ext) == 0) {
+            return TYPES[i].type;
+        }
+    }
+    return "application/octet-stream";
+}
+
+// 静态文件名是否安全：只允许static/目录下的相对路径，拒绝..、反斜杠和转义字符
+static bool is_safe_static_name(const std::string& name) {
+    if (name.empty() || name[0] == '/') return false;
+    if (name.find("..") != std::string::npos) return false;
+    return name.find_first_of("\\%\0", 0, 3) == std::string::npos;
+}
+
+// 所有事件循环共享的只读资源
+struct ServerAssets {
+    std::string root;       // 项目根目录
+    std::string index_html; // 渲染好的游戏页面
+};
+
+//------------------------------------------------------------------------------
+// 连接
+//------------------------------------------------------------------------------
+
+struct Connection {
+    int fd;
+    bool websocket;          // 是否已完成WebSocket握手
+    bool close_after_write;  // 发完缓冲区中的数据后关闭
+    bool closed;             // 已关闭，等待本轮事件处理完后释放
+    bool want_write;         // 是否已在epoll中登记EPOLLOUT
+
+    std::vector<uint8_t> in;  // 已收到、还未处理的数据
+    std::vector<uint8_t> out; // 还未发出的数据
+    size_t out_pos;           // out中已发出的字节数
+
+    std::vector<uint8_t> message; // 分片消息的已收到部分
+    int message_opcode;           // 分片消息的类型
+
+    std::unique_ptr<TetrisGame> game; // 本连接的游戏（收到第一条开始指令时创建）
+    uint32_t gravity_generation;      // 时间轮中有效定时器的版本号，0表示没有登记
+    int last_score;                   // 上一次推送的分数
+    bool last_game_over;              // 上一次推送的结束状态
+
+    explicit Connection(int socket_fd)
+        : fd(socket_fd), websocket(false), close_after_write(false), closed(false), want_write(false),
+          out_pos(0), message_opcode(0), gravity_generation(0), last_score(-1), last_game_over(false) {}
+};
+
+//------------------------------------------------------------------------------
+// 事件循环：每个线程一个，拥有自己的监听套接字、epoll实例、连接表和时间轮，线程之间不共享任何可变状态
+//------------------------------------------------------------------------------
+
+class ServerLoop {
+public:
+    ServerLoop(const ServerConfig& config, const ServerAssets& assets)
+        : config_(config), assets_(assets), listen_fd_(-1), epoll_fd_(-1), next_generation_(0) {}
+
+    ~ServerLoop() {
+        for (size_t fd = 0; fd < connections_.size(); ++fd) {
+            if (connections_[fd]) close(static_cast<int>(fd));
+        }
+        if (listen_fd_ >= 0) close(listen_fd_);
+        if (epoll_fd_ >= 0) close(epoll_fd_);
+    }
+
+    // 创建监听套接字和epoll实例
+    bool open();
+
+    // 运行事件循环直到收到退出信号
+    void run();
+
+private:
+    const ServerConfig& config_;
+    const ServerAssets& assets_;
+    int listen_fd_;
+    int epoll_fd_;
+    std::vector<std::unique_ptr<Connection> > connections_; // 按文件描述符索引
+    std::vector<int> pending_close_;                        // 本轮已关闭、等待释放的连接
+    TimingWheel wheel_;                                     // 所有游戏的下一次自动下落
+    uint32_t next_generation_;
+
+    void accept_connections();
+    void handle_event(Connection& conn, uint32_t events);
+    void read_input(Connection& conn);
+    void flush(Connection& conn);
+    void close_connection(Connection& conn);
+    void release_closed();
+
+    // HTTP
+    void handle_http(Connection& conn);
+    void send_http(Connection& conn, const char* status, const char* type, const std::string& body,
+                   bool head_only, bool keep_alive);
+
+    // WebSocket
+    void handle_websocket(Connection& conn);
+    void handle_message(Connection& conn, const uint8_t* data, size_t size);
+    void send_close(Connection& conn, uint16_t code);
+    void push_frame(Connection& conn, bool full);
+
+    // 自动下落
+    void schedule_gravity(Connection& conn);
+    void advance_gravity(uint64_t target);
+};
+
+// 创建监听套接字（SO_REUSEPORT：每个事件循环各自绑定同一端口，由内核分配新连接）
+bool ServerLoop::open() {
+    listen_fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (listen_fd_ < 0) {
+        perror("socket");
+        return false;
+    }
+    int one = 1;
+    setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEADDR, &one, sizeof(one));
+    if (setsockopt(listen_fd_, SOL_SOCKET, SO_REUSEPORT, &one, sizeof(one)) < 0) {
+        perror("SO_REUSEPORT");
+        return false;
+    }
+
+    sockaddr_in addr;
+    memset(&addr, 0, sizeof(addr));
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(static_cast<uint16_t>(config_.port));
+    if (inet_pton(AF_INET, config_.host.c_str(), &addr.sin_addr) != 1) {
+        fprintf(stderr, "无效的监听地址: %s\n", config_.host.c_str());
+        return false;
+    }
+    if (bind(listen_fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listen_fd_, SOMAXCONN) < 0) {
+        perror("bind/listen");
+        return false;
+    }
+
+    epoll_fd_ = epoll_create1(EPOLL_CLOEXEC);
+    if (epoll_fd_ < 0) {
+        perror("epoll_create1");
+        return false;
+    }
+    epoll_event ev;
+    ev.events = EPOLLIN;
+    ev.data.fd = listen_fd_;
+    return epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, listen_fd_, &ev) == 0;
+}
+
+// 事件循环主体：等待网络事件，直到下一个节拍；醒来后处理事件，再把时间轮追赶到当前时间
+void ServerLoop::run() {
+    typedef std::chrono::steady_clock Clock;
+    const Clock::time_point start = Clock::now();
+    const int tick_ms = config_.tick_ms;
+    uint64_t ticks_done = 0;
+    epoll_event events[MAX_EVENTS];
+
+    while (!g_stop) {
+        int timeout = IDLE_WAIT_MS;
+        if (wheel_.size() > 0) {
+            int64_t elapsed = std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count();
+            int64_t next_tick = static_cast<int64_t>(ticks_done + 1) * tick_ms;
+            timeout = static_cast<int>(std::max<int64_t>(0, std::min<int64_t>(next_tick - elapsed, IDLE_WAIT_MS)));
+        }
+        int count = epoll_wait(epoll_fd_, events, MAX_EVENTS, timeout);
+        if (count < 0 && errno != EINTR) {
+            perror("epoll_wait");
+            break;
+        }
+        for (int i = 0; i < count; ++i) {
+            int fd = events[i].data.fd;
+            if (fd == listen_fd_) {
+                accept_connections();
+                continue;
+            }
+            Connection* conn = static_cast<size_t>(fd) < connections_.size() ? connections_[fd].get() : nullptr;
+            if (conn && !conn->closed) handle_event(*conn, events[i].events);
+        }
+
+        uint64_t target = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - start).count() / tick_ms);
+        if (target > ticks_done) {
+            advance_gravity(target);
+            ticks_done = target;
+        }
+        release_closed();
+    }
+}
+
+// 接受所有等待中的连接
+void ServerLoop::accept_connections() {
+    while (true) {
+        int fd = accept4(listen_fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            if (errno != EAGAIN && errno != EWOULDBLOCK) perror("accept4"); // 例如文件描述符耗尽，下一轮再试
+            return;
+        }
+        int one = 1;
+        setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &one, sizeof(one)); // 小帧立即发出，不等待合并
+
+        epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP;
+        ev.data.fd = fd;
+        if (epoll_ctl(epoll_fd_, EPOLL_CTL_ADD, fd, &ev) < 0) {
+            close(fd);
+            continue;
+        }
+        if (static_cast<size_t>(fd) >= connections_.size()) {
+            connections_.resize(static_cast<size_t>(fd) + 1);
+        }
+        connections_[fd].reset(new Connection(fd));
+    }
+}
+
+// 处理一个连接上的事件
+void ServerLoop::handle_event(Connection& conn, uint32_t events) {
+    if (events & (EPOLLERR | EPOLLHUP)) {
+        close_connection(conn);
+        return;
+    }
+    if (events & EPOLLOUT) {
+        flush(conn);
+        if (conn.closed) return;
+    }
+    if (events & (EPOLLIN | EPOLLRDHUP)) {
+        read_input(conn);
+    }
+}
+
+// 读取所有可读数据并处理
+void ServerLoop::read_input(Connection& conn) {
+    uint8_t chunk[READ_CHUNK_BYTES];
+    bool peer_closed = false;
+    while (true) {
+        ssize_t n = recv(conn.fd, chunk, sizeof(chunk), 0);
+        if (n > 0) {
+            conn.in.insert(conn.in.end(), chunk, chunk + n);
+            if (static_cast<size_t>(n) < sizeof(chunk)) break; // 已读完内核缓冲区
+            continue;
+        }
+        if (n == 0) {
+            peer_closed = true;
+            break;
+        }
+        if (errno == EINTR) continue;
+        if (errno != EAGAIN && errno != EWOULDBLOCK) peer_closed = true;
+        break;
+    }
+
+    if (!conn.websocket) handle_http(conn); // 握手成功后同一缓冲区中剩下的数据按WebSocket帧处理
+    if (conn.websocket && !conn.closed) handle_websocket(conn);
+    if (peer_closed && !conn.closed) close_connection(conn);
+}
+
+// 尽量发出缓冲区中的数据；发不完时登记EPOLLOUT，等可写时继续
+void ServerLoop::flush(Connection& conn) {
+    if (conn.closed) return;
+    while (conn.out_pos < conn.out.size()) {
+        ssize_t n = send(conn.fd, conn.out.data() + conn.out_pos, conn.out.size() - conn.out_pos, MSG_NOSIGNAL);
+        if (n > 0) {
+            conn.out_pos += static_cast<size_t>(n);
+            continue;
+        }
+        if (n < 0 && errno == EINTR) continue;
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) break;
+        close_connection(conn);
+        return;
+    }
+
+    bool pending = conn.out_pos < conn.out.size();
+    if (!pending) {
+        conn.out.clear();
+        conn.out_pos = 0;
+        if (conn.close_after_write) {
+            close_connection(conn);
+            return;
+        }
+    } else if (conn.out.size() - conn.out_pos > MAX_OUTPUT_BYTES) {
+        close_connection(conn); // 客户端长时间不读取，丢弃连接而不是无限缓存
+        return;
+    }
+    if (pending != conn.want_write) {
+        epoll_event ev;
+        ev.events = EPOLLIN | EPOLLRDHUP | (pending ? static_cast<uint32_t>(EPOLLOUT) : 0u);
+        ev.data.fd = conn.fd;
+        epoll_ctl(epoll_fd_, EPOLL_CTL_MOD, conn.fd, &ev);
+        conn.want_write = pending;
+    }
+}
+
+// 关闭连接：先从epoll中注销，文件描述符在本轮事件处理完后才真正关闭，
+// 避免同一批事件中后面的事件作用到复用了这个描述符的新连接上
+void ServerLoop::close_connection(Connection& conn) {
+    if (conn.closed) return;
+    conn.closed = true;
+    conn.gravity_generation = 0; // 时间轮中的定时器到期时因版本号不匹配而被忽略
+    epoll_ctl(epoll_fd_, EPOLL_CTL_DEL, conn.fd, nullptr);
+    pending_close_.push_back(conn.fd);
+}
+
+// 释放本轮关闭的连接
+void ServerLoop::release_closed() {
+    for (size_t i = 0; i < pending_close_.size(); ++i) {
+        int fd = pending_close_[i];
+        connections_[fd].reset();
+        close(fd);
+    }
+    pending_close_.clear();
+}
+
+//------------------------------------------------------------------------------
+// HTTP：游戏页面、静态文件和WebSocket握手
+//------------------------------------------------------------------------------
+
+// 转成小写（HTTP头名称和部分取值不区分大小写）
+static std::string to_lower(std::string text) {
+    for (size_t i = 0; i < text.size(); ++i) {
+        if (text[i] >= 'A' && text[i] <= 'Z') text[i] = static_cast<char>(text[i] - 'A' + 'a');
+    }
+    return text;
+}
+
+// 去掉首尾空白
+static std::string trim(const std::string& text) {
+    size_t begin = text.find_first_not_of(" \t");
+    if (begin == std::string::npos) return std::string();
+    size_t end = text.find_last_not_of(" \t");
+    return text.substr(begin, end - begin + 1);
+}
+
+// 处理缓冲区中所有完整的HTTP请求（支持keep-alive和流水线请求）
+void ServerLoop::handle_http(Connection& conn) {
+    while (!conn.closed && !conn.websocket && !conn.close_after_write) {
+        std::string buffer(conn.in.begin(), conn.in.end());
+        size_t header_end = buffer.find("\r\n\r\n");
+        if (header_end == std::string::npos) {
+            if (conn.in.size() > MAX_REQUEST_BYTES) {
+                conn.in.clear();
+                send_http(conn, "431 Request Header Fields Too Large", "text/plain", "请求头过大\n", false, false);
+            }
+            return;
+        }
+        conn.in.erase(conn.in.begin(), conn.in.begin() + header_end + 4);
+
+        // 请求行：方法 路径 版本
+        size_t line_end = buffer.find("\r\n");
+        std::istringstream request_line(buffer.substr(0, line_end));
+        std::string method, target, version;
+        request_line >> method >> target >> version;
+
+        // 请求头
+        std::string connection_header, upgrade, ws_key, ws_version;
+        bool has_body = false;
+        size_t pos = line_end + 2;
+        while (pos < header_end) {
+            size_t next = buffer.find("\r\n", pos);
+            std::string line = buffer.substr(pos, next - pos);
+            pos = next + 2;
+            size_t colon = line.find(':');
+            if (colon == std::string::npos) continue;
+            std::string name = to_lower(trim(line.substr(0, colon)));
+            std::string value = trim(line.substr(colon + 1));
+            if (name == "connection") connection_header = to_lower(value);
+            else if (name == "upgrade") upgrade = to_lower(value);
+            else if (name == "sec-websocket-key") ws_key = value;
+            else if (name == "sec-websocket-version") ws_version = value;
+            else if ((name == "content-length" && atoi(value.c_str()) != 0) || name == "transfer-encoding") has_body = true;
+        }
+
+        bool keep_alive = version == "HTTP/1.1" ? connection_header.find("close") == std::string::npos
+                                                : connection_header.find("keep-alive") != std::string::npos;
+        bool head_only = method == "HEAD";
+        std::string path = target.substr(0, target.find('?'));
+
+        if (method.empty() || target.empty() || version.compare(0, 5, "HTTP/") != 0 || has_body) {
+            send_http(conn, "400 Bad Request", "text/plain", "无效的请求\n", false, false);
+        } else if (method != "GET" && !head_only) {
+            send_http(conn, "405 Method Not Allowed", "text/plain", "只支持GET\n", false, keep_alive);
+        } else if (path == "/ws") {
+            if (upgrade != "websocket" || connection_header.find("upgrade") == std::string::npos ||
+                ws_key.empty() || ws_version != "13") {
+                send_http(conn, "400 Bad Request", "text/plain", "需要WebSocket握手\n", false, false);
+                return;
+            }
+            std::string response =
+                "HTTP/1.1 101 Switching Protocols\r\n"
+                "Upgrade: websocket\r\n"
+                "Connection: Upgrade\r\n"
+                "Sec-WebSocket-Accept: " + ws_accept_key(ws_key) + "\r\n\r\n";
+            conn.out.insert(conn.out.end(), response.begin(), response.end());
+            conn.websocket = true;
+            flush(conn);
+        } else if (path == "/" || path == "/index.html") {
+            send_http(conn, "200 OK", "text/html; charset=utf-8", assets_.index_html, head_only, keep_alive);
+        } else if (path.compare(0, 8, "/static/") == 0 && is_safe_static_name(path.substr(8))) {
+            std::string body;
+            if (read_file(assets_.root + "/static/" + path.substr(8), body)) {
+                send_http(conn, "200 OK", content_type_for(path), body, head_only, keep_alive);
+            } else {
+                send_http(conn, "404 Not Found", "text/plain", "文件不存在\n", head_only, keep_alive);
+            }
+        } else {
+            send_http(conn, "404 Not Found", "text/plain", "页面不存在\n", head_only, keep_alive);
+        }
+    }
+}
+
+// 发送一个HTTP响应
+void ServerLoop::send_http(Connection& conn, const char* status, const char* type, const std::string& body,
+                           bool head_only, bool keep_alive) {
+    char header[512];
+    int len = snprintf(header, sizeof(header),
+                       "HTTP/1.1 %s\r\n"
+                       "Content-Type: %s\r\n"
+                       "Content-Length: %zu\r\n"
+                       "Cache-Control: no-cache\r\n"
+                       "Connection: %s\r\n\r\n",
+                       status, type, body.size(), keep_alive ? "keep-alive" : "close");
+    conn.out.insert(conn.out.end(), header, header + len);
+    if (!head_only) conn.out.insert(conn.out.end(), body.begin(), body.end());
+    if (!keep_alive) conn.close_after_write = true;
+    flush(conn);
+}
+
+//------------------------------------------------------------------------------
+// WebSocket：按键指令和棋盘帧
+//------------------------------------------------------------------------------
+
+// 处理缓冲区中所有完整的WebSocket帧
+void ServerLoop::handle_websocket(Connection& conn) {
+    size_t consumed = 0;
+    while (!conn.closed && !conn.close_after_write) {
+        WsFrame frame;
+        WsParseResult result = ws_parse_frame(conn.in.data() + consumed, conn.in.size() - consumed,
+                                              MAX_MESSAGE_BYTES, &frame);
+        if (result == WS_NEED_MORE) break;
+        if (result != WS_FRAME_OK) {
+            send_close(conn, result == WS_FRAME_TOO_LARGE ? 1009 : 1002); // 1009：消息过大；1002：协议错误
+            break;
+        }
+        const uint8_t* payload = conn.in.data() + consumed + frame.header_size;
+        consumed += frame.header_size + frame.payload_size;
+
+        switch (frame.opcode) {
+            case WS_PING: // 心跳：原样回复
+                ws_append_frame(conn.out, WS_PONG, payload, frame.payload_size);
+                flush(conn);
+                break;
+            case WS_PONG:
+                break;
+            case WS_CLOSE: // 对方关闭：回复关闭帧后断开
+                send_close(conn, 1000);
+                break;
+            case WS_TEXT:
+            case WS_BINARY:
+                if (!conn.message.empty() || conn.message_opcode != 0) {
+                    send_close(conn, 1002); // 上一条分片消息还没结束
+                    break;
+                }
+                if (frame.fin) {
+                    if (frame.opcode == WS_BINARY) handle_message(conn, payload, frame.payload_size);
+                } else {
+                    conn.message_opcode = frame.opcode;
+                    conn.message.assign(payload, payload + frame.payload_size);
+                }
+                break;
+            case WS_CONTINUATION:
+                if (conn.message_opcode == 0 || conn.message.size() + frame.payload_size > MAX_MESSAGE_BYTES) {
+                    send_close(conn, conn.message_opcode == 0 ? 1002 : 1009);
+                    break;
+                }
+                conn.message.insert(conn.message.end(), payload, payload + frame.payload_size);
+                if (frame.fin) {
+                    if (conn.message_opcode == WS_BINARY) handle_message(conn, conn.message.data(), conn.message.size());
+                    conn.message.clear();
+                    conn.message_opcode = 0;
+                }
+                break;
+            default:
+                send_close(conn, 1002);
+                break;
+        }
+    }
+    if (!conn.closed) conn.in.erase(conn.in.begin(), conn.in.begin() + std::min(consumed, conn.in.size()));
+}
+
+// 执行一条二进制消息中的所有指令，然后推送一次棋盘帧
+void ServerLoop::handle_message(Connection& conn, const uint8_t* data, size_t size) {
+    bool full = false;
+    for (size_t i = 0; i < size; ++i) {
+        uint8_t command = data[i];
+        if (command == CMD_START) {
+            if (!conn.game) conn.game.reset(new TetrisGame());
+            conn.game->start_new_game();
+            schedule_gravity(conn);
+            full = true;
+        } else if (command == CMD_SYNC) {
+            full = true;
+        } else if (conn.game && command > ACTION_NONE && command < ACTION_COUNT) {
+            conn.game->apply_action(command);
+        }
+        // 开局前的动作和未知指令直接忽略
+    }
+    if (conn.game) push_frame(conn, full);
+}
+
+// 发送关闭帧（状态码为大端序），发完后断开连接
+void ServerLoop::send_close(Connection& conn, uint16_t code) {
+    uint8_t payload[2] = {static_cast<uint8_t>(code >> 8), static_cast<uint8_t>(code)};
+    ws_append_frame(conn.out, WS_CLOSE, payload, sizeof(payload));
+    conn.close_after_write = true;
+    flush(conn);
+}
+
+// 推送一个棋盘帧：增量帧只包含改动过的行；棋盘、分数和结束状态都没有变化时不发送
+void ServerLoop::push_frame(Connection& conn, bool full) {
+    TetrisGame& game = *conn.game;
+    uint8_t rows[BOARD_HEIGHT * BOARD_WIDTH];
+    uint32_t seq;
+    uint32_t mask;
+    if (full) {
+        seq = game.take_board_packed(rows);
+        mask = (1u << BOARD_HEIGHT) - 1;
+    } else {
+        mask = game.take_board_delta(rows, &seq);
+    }
+    int score = game.get_score();
+    bool game_over = game.is_game_over();
+    if (!full && mask == 0 && score == conn.last_score && game_over == conn.last_game_over) return;
+    conn.last_score = score;
+    conn.last_game_over = game_over;
+
+    uint8_t frame[MAX_FRAME_BYTES];
+    frame[0] = MSG_FRAME;
+    frame[1] = static_cast<uint8_t>((full ? FRAME_FULL : 0) | (game_over ? FRAME_GAME_OVER : 0));
+    for (int i = 0; i < 4; ++i) {
+        frame[2 + i] = static_cast<uint8_t>(seq >> (i * 8));
+        frame[6 + i] = static_cast<uint8_t>(static_cast<uint32_t>(score) >> (i * 8));
+    }
+    frame[10] = static_cast<uint8_t>(std::min(game.get_level(), 255));
+    size_t len = FRAME_HEADER_BYTES;
+    int row_count = 0;
+    for (int row = 0; row < BOARD_HEIGHT; ++row) {
+        if (!(mask & (1u << row))) continue;
+        frame[len++] = static_cast<uint8_t>(row);
+        memcpy(frame + len, rows + row_count * BOARD_WIDTH, BOARD_WIDTH); // 脏行按行号顺序紧密排列
+        len += BOARD_WIDTH;
+        row_count++;
+    }
+    frame[11] = static_cast<uint8_t>(row_count);
+
+    ws_append_frame(conn.out, WS_BINARY, frame, len);
+    flush(conn);
+}
+
+//------------------------------------------------------------------------------
+// 自动下落：与GravityScheduler相同的时间轮，但由事件循环线程自己推进，游戏只属于本线程，不需要加锁
+//------------------------------------------------------------------------------
+
+// 按当前等级登记下一次下落（重新登记会让旧的定时器作废）
+void ServerLoop::schedule_gravity(Connection& conn) {
+    if (++next_generation_ == 0) next_generation_ = 1; // 0表示没有登记
+    conn.gravity_generation = next_generation_;
+    uint64_t interval = TetrisGame::gravity_interval_ms(conn.game->get_level());
+    wheel_.schedule(static_cast<uint64_t>(conn.fd), conn.gravity_generation,
+                    (interval + config_.tick_ms - 1) / config_.tick_ms);
+}
+
+// 把时间轮推进到target节拍，对到期的游戏执行下落并推送棋盘
+void ServerLoop::advance_gravity(uint64_t target) {
+    std::vector<TimerEntry> due;
+    wheel_.advance_to(target, due);
+    for (size_t i = 0; i < due.size(); ++i) {
+        size_t fd = static_cast<size_t>(due[i].key);
+        Connection* conn = fd < connections_.size() ? connections_[fd].get() : nullptr;
+        if (!conn || conn->closed || conn->gravity_generation != due[i].generation) continue; // 已取消
+        if (conn->game->game_tick()) {
+            schedule_gravity(*conn);
+        } else {
+            conn->gravity_generation = 0; // 游戏结束，等下一次开局重新登记
+        }
+        push_frame(*conn, false);
+    }
+}
+
+//------------------------------------------------------------------------------
+// 入口
+//------------------------------------------------------------------------------
+
+// 把文件描述符上限提高到系统允许的最大值（每个连接占用一个描述符）
+static void raise_fd_limit() {
+    rlimit limit;
+    if (getrlimit(RLIMIT_NOFILE, &limit) == 0 && limit.rlim_cur < limit.rlim_max) {
+        limit.rlim_cur = limit.rlim_max;
+        setrlimit(RLIMIT_NOFILE, &limit);
+    }
+}
+
+int main(int argc, char** argv) {
+    ServerConfig config;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 7, "--host=") == 0) {
+            config.host = arg.substr(7);
+        } else if (arg.compare(0, 7, "--port=") == 0) {
+            config.port = atoi(arg.c_str() + 7);
+        } else if (arg.compare(0, 7, "--root=") == 0) {
+            config.root = arg.substr(7);
+        } else if (arg.compare(0, 10, "--threads=") == 0) {
+            config.threads = atoi(arg.c_str() + 10);
+        } else if (arg.compare(0, 10, "--tick-ms=") == 0) {
+            config.tick_ms = atoi(arg.c_str() + 10);
+        } else {
+            fprintf(stderr, "用法: %s [--host=地址] [--port=端口] [--root=目录] [--threads=N] [--tick-ms=毫秒]\n", argv[0]);
+            return 2;
+        }
+    }
+    if (config.threads <= 0) config.threads = std::max(1u, std::thread::hardware_concurrency());
+    if (config.tick_ms <= 0) config.tick_ms = 10;
+
+    ServerAssets assets;
+    assets.root = config.root;
+    std::string tmpl;
+    if (!read_file(config.root + "/templates/index.html", tmpl)) {
+        fprintf(stderr, "无法读取 %s/templates/index.html（请用--root指定项目目录）\n", config.root.c_str());
+        return 1;
+    }
+    assets.index_html = render_index(tmpl);
+
+    signal(SIGPIPE, SIG_IGN); // 对方已断开时send返回错误而不是终止进程
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = handle_stop_signal; // 不设置SA_RESTART，让epoll_wait被信号打断
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+    raise_fd_limit();
+
+    std::vector<std::unique_ptr<ServerLoop> > loops;
+    for (int i = 0; i < config.threads; ++i) {
+        loops.push_back(std::unique_ptr<ServerLoop>(new ServerLoop(config, assets)));
+        if (!loops.back()->open()) return 1;
+    }
+    fprintf(stderr, "tetris_server 监听 %s:%d（%d个事件循环线程）\n", config.host.c_str(), config.port, config.threads);
+
+    std::vector<std::thread> threads;
+    for (int i = 1; i < config.threads; ++i) {
+        threads.push_back(std::thread(&ServerLoop::run, loops[i].get()));
+    }
+    loops[0]->run(); // 主线程运行第一个事件循环
+    for (size_t i = 0; i < threads.size(); ++i) {
+        threads[i].join();
+    }
+    return 0;
+}
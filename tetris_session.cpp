@@ -0,0 +1,361 @@
+// tetris_session.cpp
+// 多会话游戏注册表的实现
+#include "tetris_session.h"
+#include "tetris_stats.h"  // 插桩计数器（未开启时为空）
+#include "tetris_core.h"   // 游戏实例板块
+#include "tetris_input_queue.h" // 会话游戏的输入队列
+#include <chrono>  // 单调时钟，用于记录会话最近访问时间
+#include <random>  // 操作系统的密码学安全随机源（random_device），生成不可预测的会话ID
+
+// 获取单调时钟的当前时间（毫秒）
+static int64_t now_ms() {
+    return std::chrono::duration_cast<std::chrono::milliseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// 生成新的随机会话ID（永远不为0）
+// 会话ID就是cookie中的凭据，不能用mt19937这类可以从输出反推内部状态的生成器：
+// 每个ID的64位都直接取自操作系统的随机源（Linux上是getrandom、/dev/urandom或RDRAND）
+// 每个线程一个random_device，不需要任何锁；创建会话不在热路径上，多一次系统调用可以接受
+static SessionId generate_session_id() {
+    static thread_local std::random_device source;
+    SessionId id;
+    do {
+        id = (static_cast<uint64_t>(source()) << 32) | static_cast<uint64_t>(source());
+    } while (id == 0);
+    return id;
+}
+
+// 会话ID在分片内的哈希值
+// 低位已经用来选择分片，这里再做一次混合，避免同一分片内的ID聚集
+static size_t slot_hash(SessionId id) {
+    uint64_t h = id >> 6;
+    h ^= h >> 33;
+    h *= 0xff51afd7ed558ccdULL;
+    h ^= h >> 33;
+    return static_cast<size_t>(h);
+}
+
+// 获取进程内唯一的注册表实例（C++11保证局部静态变量的初始化是线程安全的）
+SessionRegistry& SessionRegistry::instance() {
+    static SessionRegistry registry;
+    return registry;
+}
+
+SessionRegistry::SessionRegistry() {
+}
+
+// 根据会话ID的低位选择分片
+SessionRegistry::Shard& SessionRegistry::shard_for(SessionId id) {
+    return shards_[id & (SHARD_COUNT - 1)];
+}
+
+// 线性探测查找会话ID所在的槽位
+int SessionRegistry::find_slot(const Shard& shard, SessionId id) {
+    size_t mask = shard.slots.size() - 1;
+    for (size_t i = slot_hash(id) & mask; ; i = (i + 1) & mask) {
+        if (shard.slots[i].id == id) return static_cast<int>(i);
+        if (shard.slots[i].id == 0) return -1; // 遇到空槽说明不存在
+    }
+}
+
+// 插入槽位；装载率超过1/2时容量翻倍并重新散列
+void SessionRegistry::insert_slot(Shard& shard, const Slot& slot) {
+    if ((shard.count + 1) * 2 > static_cast<int>(shard.slots.size())) {
+        std::vector<Slot> old_slots(shard.slots.size() * 2);
+        old_slots.swap(shard.slots);
+        shard.count = 0;
+        for (size_t i = 0; i < old_slots.size(); ++i) {
+            if (old_slots[i].id != 0) insert_slot(shard, old_slots[i]);
+        }
+    }
+    size_t mask = shard.slots.size() - 1;
+    size_t i = slot_hash(slot.id) & mask;
+    while (shard.slots[i].id != 0) {
+        i = (i + 1) & mask;
+    }
+    shard.slots[i] = slot;
+    shard.count++;
+}
+
+// 删除槽位：把后续同一探测链上的槽位往回移，保证查找不会提前遇到空槽
+// （回移删除法，不需要墓碑标记）
+void SessionRegistry::erase_slot(Shard& shard, int index) {
+    size_t mask = shard.slots.size() - 1;
+    size_t hole = static_cast<size_t>(index);
+    size_t next = hole;
+    for (;;) {
+        next = (next + 1) & mask;
+        if (shard.slots[next].id == 0) break;
+        size_t home = slot_hash(shard.slots[next].id) & mask;
+        // 只有当next的理想位置不在(hole, next]循环区间内时，才能移到hole
+        bool home_in_range = (hole <= next) ? (home > hole && home <= next)
+                                            : (home > hole || home <= next);
+        if (!home_in_range) {
+            shard.slots[hole] = shard.slots[next];
+            hole = next;
+        }
+    }
+    shard.slots[hole].id = 0;
+    shard.slots[hole].game = nullptr;
+    shard.slots[hole].changed.reset();
+    shard.count--;
+}
+
+// 优先复用空闲池中的实例，池为空时从共享上下文的板块中新建
+// 只有会话中的游戏需要输入队列：新建的实例在这里分配（此时还在分片锁内，其他线程看不到它），复用的实例已经有了
+TetrisGame* SessionRegistry::take_game(Shard& shard) {
+    if (shard.free_games.empty()) {
+        TetrisGame* fresh = TetrisCore::instance().create_game();
+        fresh->enable_input_queue();
+        return fresh;
+    }
+    TetrisGame* game = shard.free_games.back();
+    shard.free_games.pop_back();
+    game->discard_inputs(); // 上一个会话没来得及执行的输入不能带到新会话里
+    return game;
+}
+
+// 游戏实例回到空闲池；池满时还回板块
+void SessionRegistry::release_game(Shard& shard, TetrisGame* game) {
+    if (static_cast<int>(shard.free_games.size()) < MAX_FREE_PER_SHARD) {
+        shard.free_games.push_back(game);
+    } else {
+        TetrisCore::instance().destroy_game(game);
+    }
+}
+
+// 递增变化序号；只有推送流等待过的会话才有条件变量，其他会话只是一次加法
+void SessionRegistry::notify_slot(Slot& slot) {
+    slot.version++;
+    if (slot.changed) slot.changed->notify_all();
+}
+
+// 创建新会话
+SessionId SessionRegistry::create() {
+    for (;;) {
+        SessionId id = generate_session_id();
+        Shard& shard = shard_for(id);
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        if (find_slot(shard, id) >= 0) continue; // 极小概率的ID冲突：重新生成
+
+        TetrisGame* game = take_game(shard);
+        game->start_new_game(); // 复用的实例也要完全重置
+
+        Slot slot;
+        slot.id = id;
+        slot.game = game;
+        slot.last_access_ms = now_ms();
+        slot.version = 1;
+        insert_slot(shard, slot);
+        return id;
+    }
+}
+
+// 查找会话
+TetrisGame* SessionRegistry::lookup(SessionId id) {
+    if (id == 0) return nullptr;
+    Shard& shard = shard_for(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    int index = find_slot(shard, id);
+    if (index < 0) return nullptr;
+    shard.slots[index].last_access_ms = now_ms(); // 刷新最近访问时间
+    return shard.slots[index].game;
+}
+
+// 查找并锁定会话
+TetrisGame* SessionRegistry::acquire(SessionId id, bool touch) {
+    if (id == 0) return nullptr;
+    Shard& shard = shard_for(id);
+    shard.mutex.lock();
+    int index = find_slot(shard, id);
+    if (index < 0) {
+        shard.mutex.unlock();
+        return nullptr;
+    }
+    if (touch) shard.slots[index].last_access_ms = now_ms();
+    return shard.slots[index].game; // 返回时仍持有分片锁
+}
+
+// 释放acquire持有的锁
+void SessionRegistry::release(SessionId id) {
+    shard_for(id).mutex.unlock();
+}
+
+// 释放锁并通知等待的推送流
+void SessionRegistry::release_changed(SessionId id) {
+    Shard& shard = shard_for(id);
+    int index = find_slot(shard, id);
+    if (index >= 0) notify_slot(shard.slots[index]);
+    shard.mutex.unlock();
+}
+
+// 等待会话变化并锁定会话
+TetrisGame* SessionRegistry::wait_changed(SessionId id, uint64_t* version, int timeout_ms) {
+    if (id == 0 || !version) return nullptr;
+    Shard& shard = shard_for(id);
+    std::unique_lock<std::mutex> lock(shard.mutex);
+    int index = find_slot(shard, id);
+    if (index >= 0 && shard.slots[index].version == *version) {
+        Slot& slot = shard.slots[index];
+        if (!slot.changed) slot.changed = std::make_shared<std::condition_variable>();
+        std::shared_ptr<std::condition_variable> changed = slot.changed; // 槽位在等待期间可能移动或被删除
+        changed->wait_for(lock, std::chrono::milliseconds(timeout_ms), [&shard, &index, id, version]() {
+            index = find_slot(shard, id);
+            return index < 0 || shard.slots[index].version != *version;
+        });
+    }
+    if (index < 0) return nullptr; // 会话不存在或已过期
+    Slot& slot = shard.slots[index];
+    slot.last_access_ms = now_ms(); // 打开着的推送流让会话保持活跃
+    *version = slot.version;
+    lock.release(); // 返回时仍持有分片锁，由release解锁
+    return slot.game;
+}
+
+// 把动作放进会话的输入队列
+bool SessionRegistry::enqueue(SessionId id, int action, uint64_t timestamp_us) {
+    if (id == 0) return false;
+    Shard& shard = shard_for(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    int index = find_slot(shard, id);
+    if (index < 0) return false;
+    Slot& slot = shard.slots[index];
+    slot.last_access_ms = now_ms(); // 按键也算一次访问
+    if (!slot.game->enqueue_input(action, timestamp_us)) return false;
+    notify_slot(slot); // 推送流立即醒来执行这个按键
+    return true;
+}
+
+// 使会话过期
+bool SessionRegistry::expire(SessionId id) {
+    if (id == 0) return false;
+    Shard& shard = shard_for(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    int index = find_slot(shard, id);
+    if (index < 0) return false;
+    notify_slot(shard.slots[index]); // 推送流醒来后发现会话已不存在
+    release_game(shard, shard.slots[index].game);
+    erase_slot(shard, index);
+    return true;
+}
+
+// 使所有空闲超时的会话过期：逐个分片加锁扫描，不会同时持有多把锁
+int SessionRegistry::expire_idle(int64_t max_idle_ms) {
+    int64_t deadline = now_ms() - max_idle_ms;
+    int expired = 0;
+    for (int s = 0; s < SHARD_COUNT; ++s) {
+        Shard& shard = shards_[s];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (size_t i = 0; i < shard.slots.size(); ) {
+            Slot& slot = shard.slots[i];
+            if (slot.id != 0 && slot.last_access_ms < deadline) {
+                notify_slot(slot);
+                release_game(shard, slot.game);
+                erase_slot(shard, static_cast<int>(i));
+                expired++;
+                // 回移删除可能把后面的槽位移到i，所以i不前进，重新检查
+            } else {
+                ++i;
+            }
+        }
+    }
+    return expired;
+}
+
+// 当前活跃会话数量
+int SessionRegistry::size() {
+    int total = 0;
+    for (int s = 0; s < SHARD_COUNT; ++s) {
+        std::lock_guard<std::mutex> lock(shards_[s].mutex);
+        total += shards_[s].count;
+    }
+    return total;
+}
+
+// 依次访问所有会话
+void SessionRegistry::for_each(const std::function<void(SessionId, const TetrisGame&)>& visit) {
+    for (int s = 0; s < SHARD_COUNT; ++s) {
+        Shard& shard = shards_[s];
+        std::lock_guard<std::mutex> lock(shard.mutex);
+        for (size_t i = 0; i < shard.slots.size(); ++i) {
+            if (shard.slots[i].id != 0) visit(shard.slots[i].id, *shard.slots[i].game);
+        }
+    }
+}
+
+// 用指定的会话ID创建会话并恢复状态
+bool SessionRegistry::insert(SessionId id, const GameState& state) {
+    if (id == 0) return false;
+    Shard& shard = shard_for(id);
+    std::lock_guard<std::mutex> lock(shard.mutex);
+    if (find_slot(shard, id) >= 0) return false;
+
+    TetrisGame* game = take_game(shard);
+    game->restore_state(state); // 一次memcpy覆盖实例上的全部状态
+
+    Slot slot;
+    slot.id = id;
+    slot.game = game;
+    slot.last_access_ms = now_ms(); // 恢复的会话从现在起重新计算空闲时间
+    slot.version = 1;
+    insert_slot(shard, slot);
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// C语言风格的会话API函数实现
+//------------------------------------------------------------------------------
+
+// 创建新会话
+API_EXPORT uint64_t create_session_api() {
+    TETRIS_STAT_SCOPE(STAT_API_CREATE_SESSION);
+    return SessionRegistry::instance().create();
+}
+
+// 查找会话对应的游戏
+API_EXPORT TetrisGame* lookup_session_api(uint64_t session_id) {
+    TETRIS_STAT_SCOPE(STAT_API_LOOKUP_SESSION);
+    return SessionRegistry::instance().lookup(session_id);
+}
+
+// 查找并锁定会话
+API_EXPORT TetrisGame* acquire_session_api(uint64_t session_id) {
+    TETRIS_STAT_SCOPE(STAT_API_LOOKUP_SESSION);
+    return SessionRegistry::instance().acquire(session_id, true);
+}
+
+// 释放会话锁
+API_EXPORT void release_session_api(uint64_t session_id) {
+    SessionRegistry::instance().release(session_id);
+}
+
+// 释放会话锁并通知推送流
+API_EXPORT void release_session_changed_api(uint64_t session_id) {
+    SessionRegistry::instance().release_changed(session_id);
+}
+
+// 等待会话变化并锁定会话
+API_EXPORT TetrisGame* wait_session_change_api(uint64_t session_id, uint64_t* inout_version, int timeout_ms) {
+    return SessionRegistry::instance().wait_changed(session_id, inout_version, timeout_ms);
+}
+
+// 把动作放进会话的输入队列
+API_EXPORT bool enqueue_session_input_api(uint64_t session_id, int action, uint64_t timestamp_us) {
+    return SessionRegistry::instance().enqueue(session_id, action, timestamp_us ? timestamp_us : InputQueue::now_us());
+}
+
+// 使会话过期
+API_EXPORT bool expire_session_api(uint64_t session_id) {
+    return SessionRegistry::instance().expire(session_id);
+}
+
+// 使空闲超时的会话过期
+API_EXPORT int expire_idle_sessions_api(int max_idle_seconds) {
+    return SessionRegistry::instance().expire_idle(static_cast<int64_t>(max_idle_seconds) * 1000);
+}
+
+// 获取当前活跃会话数量
+API_EXPORT int get_session_count_api() {
+    return SessionRegistry::instance().size();
+}
@@ -0,0 +1,159 @@
+// tetris_session.h
+// 多会话游戏注册表：会话ID -> 游戏实例
+// 网页服务需要同时为成千上万个玩家各自维护一局游戏，这里提供：
+// 1. 按会话ID分片的哈希表，每个分片一把锁（锁分段），不存在全局锁
+// 2. 每个分片一个空闲游戏实例池，会话过期后实例被回收复用，避免反复new/delete
+#ifndef TETRIS_SESSION_H // 防止头文件被重复包含的保护宏
+#define TETRIS_SESSION_H
+
+#include "tetris_game.h"
+#include <functional> // 遍历会话的回调
+#include <vector>   // 哈希表槽位和空闲实例池
+#include <memory>   // 推送流等待用的条件变量（shared_ptr）
+#include <mutex>    // 分片锁
+#include <condition_variable> // 会话变化的通知
+#include <cstdint>  // 会话ID类型
+
+// 会话ID：取自操作系统随机源的64位随机数（cookie中的凭据，不可预测），0表示无效ID
+typedef uint64_t SessionId;
+
+// 多会话游戏注册表（进程内单例）
+class SessionRegistry {
+public:
+    // 获取进程内唯一的注册表实例
+    static SessionRegistry& instance();
+
+    // 创建新会话：从空闲池取出（或新建）一局游戏并开始，返回新的会话ID
+    SessionId create();
+
+    // 查找会话对应的游戏，同时刷新会话的最近访问时间
+    // 返回nullptr表示会话不存在（从未创建或已过期）
+    // 返回的指针在会话过期之前一直有效
+    TetrisGame* lookup(SessionId id);
+
+    // 查找并锁定会话：找到时返回游戏，并且返回时仍持有该会话所在分片的锁，
+    // 调用方操作完游戏后必须调用release(id)；找不到时返回nullptr，不持有锁
+    // 多个线程（网页请求、重力调度器）操作同一局游戏时用它互斥
+    // touch为true时刷新最近访问时间（重力调度器不刷新，否则会话永远不会因空闲而过期）
+    TetrisGame* acquire(SessionId id, bool touch);
+
+    // 释放acquire持有的锁
+    void release(SessionId id);
+
+    // 释放acquire持有的锁，并通知等待这个会话变化的线程（调用方可能修改了游戏时使用）
+    void release_changed(SessionId id);
+
+    // 等待会话变化并锁定会话（推送流使用，代替定时轮询）
+    // 每个会话有一个变化序号，入队按键、release_changed和会话过期时递增；
+    // *version与当前序号相同时阻塞，直到序号变化或者等满timeout_ms毫秒，返回时*version更新为当前序号
+    // 返回值和加锁的约定与acquire(id, true)相同；会话不存在或在等待期间过期时返回nullptr
+    // 序号从1开始，*version为0时不等待
+    TetrisGame* wait_changed(SessionId id, uint64_t* version, int timeout_ms);
+
+    // 把动作放进会话的输入队列，同时刷新最近访问时间
+    // 查找和入队都在分片锁内完成（入队只是一次CAS，锁只持有很短的时间），会话不会在两者之间过期、
+    // 游戏实例也不会被回收给别的会话；会话不存在、队列已满或动作无效时返回false
+    // 代价：按键要拿分片锁，同一分片里正在执行输入或下落的会话（重力调度器、推送流、加锁的请求）会让它等上一次操作的时间；
+    // 哈希表的查找本身需要锁，不加锁的入队只适用于调用方能保证游戏有效的enqueue_input_api
+    bool enqueue(SessionId id, int action, uint64_t timestamp_us);
+
+    // 使会话过期：游戏实例回到空闲池。返回false表示会话不存在
+    bool expire(SessionId id);
+
+    // 使所有超过max_idle_ms毫秒未访问的会话过期，返回过期的会话数量
+    int expire_idle(int64_t max_idle_ms);
+
+    // 当前活跃会话数量
+    int size();
+
+    // 依次访问所有会话（保存检查点时使用）
+    // 逐个分片加锁：访问一个分片的会话期间持有该分片的锁，不会同时持有两把锁；
+    // visit中不能再调用注册表的函数（锁不可重入）
+    void for_each(const std::function<void(SessionId, const TetrisGame&)>& visit);
+
+    // 用指定的会话ID创建会话，并把游戏恢复到state（从检查点恢复时使用）
+    // 返回false表示ID为0或已经存在
+    bool insert(SessionId id, const GameState& state);
+
+    // 分片数量（必须是2的幂，会话ID的低位决定分片）
+    static const int SHARD_COUNT = 64;
+
+private:
+    SessionRegistry();
+    SessionRegistry(const SessionRegistry&);            // 禁止复制
+    SessionRegistry& operator=(const SessionRegistry&); // 禁止赋值
+
+    // 哈希表槽位：id为0表示空槽
+    struct Slot {
+        SessionId id;          // 会话ID
+        TetrisGame* game;      // 会话对应的游戏
+        int64_t last_access_ms; // 最近访问时间（单调时钟，毫秒）
+        uint64_t version;      // 变化序号（见wait_changed）
+        // 有推送流等待时才分配的条件变量，配合分片锁使用；会话过期时等待方持有的引用使它保持有效
+        std::shared_ptr<std::condition_variable> changed;
+    };
+
+    // 一个分片：开放寻址哈希表 + 空闲游戏实例池，由同一把锁保护
+    // 开放寻址（线性探测）在插入时不分配节点，只有扩容时才分配内存
+    struct Shard {
+        std::mutex mutex;
+        std::vector<Slot> slots;             // 槽位数组，容量是2的幂
+        int count;                           // 已占用的槽位数
+        std::vector<TetrisGame*> free_games; // 回收的游戏实例
+
+        Shard() : slots(INITIAL_SLOTS), count(0) {}
+    };
+
+    static const int INITIAL_SLOTS = 64;     // 每个分片的初始槽位数
+    static const int MAX_FREE_PER_SHARD = 256; // 每个分片最多缓存的空闲实例数
+
+    Shard shards_[SHARD_COUNT];
+
+    // 根据会话ID选择分片
+    Shard& shard_for(SessionId id);
+
+    // 以下函数都要求调用方已持有分片锁
+    static int find_slot(const Shard& shard, SessionId id);   // 返回槽位下标，找不到返回-1
+    static void insert_slot(Shard& shard, const Slot& slot);  // 插入（必要时扩容）
+    static void erase_slot(Shard& shard, int index);          // 删除并回移后续槽位
+    static TetrisGame* take_game(Shard& shard);                // 从空闲池取出（或新建）游戏实例
+    static void release_game(Shard& shard, TetrisGame* game); // 游戏实例回到空闲池
+    static void notify_slot(Slot& slot);                      // 递增变化序号并唤醒等待的推送流
+};
+
+// 定义C风格的会话API接口
+extern "C" {
+    // 创建新会话并开始游戏，返回会话ID
+    API_EXPORT uint64_t create_session_api();
+
+    // 查找会话对应的游戏，不存在时返回NULL
+    API_EXPORT TetrisGame* lookup_session_api(uint64_t session_id);
+
+    // 查找并锁定会话（见SessionRegistry::acquire），成功时必须调用release_session_api
+    API_EXPORT TetrisGame* acquire_session_api(uint64_t session_id);
+
+    // 释放acquire_session_api持有的锁
+    API_EXPORT void release_session_api(uint64_t session_id);
+
+    // 释放锁并通知推送流会话可能有变化（见SessionRegistry::release_changed）
+    API_EXPORT void release_session_changed_api(uint64_t session_id);
+
+    // 等待会话变化并锁定会话（见SessionRegistry::wait_changed），返回非NULL时必须调用release_session_api
+    // 阻塞期间不持有任何锁；*inout_version传入上次得到的序号（第一次传0）
+    API_EXPORT TetrisGame* wait_session_change_api(uint64_t session_id, uint64_t* inout_version, int timeout_ms);
+
+    // 把动作（TetrisAction）放进会话的输入队列（见SessionRegistry::enqueue），timestamp_us为0时使用当前时间
+    // 返回false时调用方可以改为锁定会话后直接操作游戏
+    API_EXPORT bool enqueue_session_input_api(uint64_t session_id, int action, uint64_t timestamp_us);
+
+    // 使会话过期，返回会话是否存在
+    API_EXPORT bool expire_session_api(uint64_t session_id);
+
+    // 使所有超过max_idle_seconds秒未访问的会话过期，返回过期的会话数量
+    API_EXPORT int expire_idle_sessions_api(int max_idle_seconds);
+
+    // 获取当前活跃会话数量
+    API_EXPORT int get_session_count_api();
+}
+
+#endif // TETRIS_SESSION_H
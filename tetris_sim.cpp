@@ -0,0 +1,606 @@
+// tetris_sim.cpp
+// 无界面自我对弈模拟器（tetris_sim可执行文件）
+// 用选定的策略在多个线程上连续玩N局游戏，作为核心库上线前的标准压测和正确性检查工具：
+// 报告每秒局数、每秒步数、分数分布和单步延迟的p50/p99，并在每一步之后检查棋盘不变式。
+//
+// 用法：tetris_sim [--games=N] [--policy=random|greedy|replay] [--replay=文件] [--threads=N]
+//                  [--randomizer=uniform|bag7|history] [--seed=种子] [--max-moves=N] [--no-check] [--json]
+//   --games=N       对局数（默认10000）
+//   --policy=策略   random：每步随机选一个动作（默认）
+//                   greedy：用求解器（向后看1个方块）找最佳落点，再逐个按键执行
+//                   replay：每局都重新执行--replay给出的回放日志，最终分数必须与回放引擎的结果一致
+//   --replay=文件   回放日志（格式见tetris_replay.h，可由set_replay_recording_api录制）
+//   --threads=N     工作线程数（默认等于CPU核数）；每个线程只有一个游戏实例，逐局复用
+//   --randomizer=方式 方块类型的随机方式（默认bag7，见tetris_randomizer.h）；replay策略使用日志中记录的方式
+//   --seed=种子     第i局的种子是seed + i，同样的参数总能复现同样的对局（默认1）
+//   --max-moves=N   每局最多执行的步数，防止贪心策略一直玩下去（默认100000）
+//   --no-check      不检查不变式（只测吞吐量）
+//   --json          以JSON格式输出结果
+//
+// 检查的不变式（发现违反时打印种子、步数和棋盘，退出码为1）：
+//   1. 格子颜色在0-7之间，占用层与颜色平面一致，棋盘外的列没有方块
+//   2. 游戏进行中时，当前方块的每个组成块都在棋盘内，且格子颜色与方块类型一致
+//   3. 格子数守恒：已固定的格子数每步只能增加一个方块（4格），或者减少消除的整行（每行BOARD_WIDTH格）；
+//      当前方块与已有方块重叠时格子数会变少，这条不变式可以发现
+//   4. 每列的表面高度等于该列最高的已固定方块（不包括当前方块）的高度
+//   5. 分数和消除行数不减少，游戏结束后不会恢复
+#include "tetris_game.h"
+#include "tetris_replay.h"
+#include "tetris_solver.h"
+#include <algorithm> // std::sort, std::min
+#include <atomic>    // 分发对局编号、出错时通知所有线程停止
+#include <chrono>    // 计时
+#include <cmath>     // std::sqrt
+#include <cstdio>    // 输出
+#include <cstdlib>   // atoi, strtoull
+#include <cstring>   // memcpy
+#include <fstream>   // 读取回放日志
+#include <iterator>  // std::istreambuf_iterator
+#include <mutex>     // 串行化错误报告
+#include <string>
+#include <thread>    // 工作线程
+#include <vector>
+
+typedef std::chrono::steady_clock SimClock;
+
+// 模拟策略
+enum SimPolicy {
+    POLICY_RANDOM,
+    POLICY_GREEDY,
+    POLICY_REPLAY
+};
+
+static const char* const POLICY_NAMES[] = {"random", "greedy", "replay"};
+
+// 随机方式的名称，下标是RandomizerKind
+static const char* const RANDOMIZER_NAMES[RANDOMIZER_COUNT] = {"uniform", "bag7", "history"};
+
+// 命令行参数
+struct SimOptions {
+    int games = 10000;
+    SimPolicy policy = POLICY_RANDOM;
+    std::string replay_path;
+    int threads = 0;
+    int randomizer = RANDOMIZER_BAG7;
+    uint64_t seed = 1;
+    uint64_t max_moves = 100000;
+    bool check = true;
+    bool json = false;
+};
+
+// 解码后的回放日志：所有线程共享，只读
+struct ReplayScript {
+    uint64_t seed = 0;
+    int randomizer = RANDOMIZER_BAG7;
+    std::vector<uint8_t> actions; // 展开游程编码后的动作序列
+    int expected_score = 0;       // 回放引擎给出的最终分数
+};
+
+static inline int count_bits(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(mask);
+#else
+    int count = 0;
+    for (; mask; mask &= mask - 1) ++count;
+    return count;
+#endif
+}
+
+static inline int highest_bit(uint64_t value) {
+#if defined(__GNUC__) || defined(__clang__)
+    return 63 - __builtin_clzll(value);
+#else
+    int bit = 0;
+    while (value >>= 1) ++bit;
+    return bit;
+#endif
+}
+
+//------------------------------------------------------------------------------
+// 延迟直方图
+//------------------------------------------------------------------------------
+
+// 对数分桶的直方图：每个2的幂区间再分成16个子桶，相对误差不超过1/16
+// 每个线程一个，结束后合并；记录一个样本只是一次数组自增，不需要保存全部样本
+class LatencyHistogram {
+public:
+    LatencyHistogram() : counts_(BUCKETS, 0), total_(0), max_(0) {}
+
+    void add(uint64_t value) {
+        counts_[bucket_of(value)]++;
+        total_++;
+        if (value > max_) max_ = value;
+    }
+
+    void merge(const LatencyHistogram& other) {
+        for (int i = 0; i < BUCKETS; ++i) {
+            counts_[i] += other.counts_[i];
+        }
+        total_ += other.total_;
+        max_ = std::max(max_, other.max_);
+    }
+
+    // 第p百分位（0-100），返回所在子桶的中点
+    uint64_t percentile(double p) const {
+        if (total_ == 0) return 0;
+        uint64_t rank = static_cast<uint64_t>(p / 100.0 * (total_ - 1)) + 1;
+        uint64_t seen = 0;
+        for (int i = 0; i < BUCKETS; ++i) {
+            seen += counts_[i];
+            if (seen >= rank) return std::min(bucket_mid(i), max_);
+        }
+        return max_;
+    }
+
+    uint64_t max() const { return max_; }
+
+private:
+    static const int SUB_BITS = 4;                   // 每个2的幂区间的子桶数 = 2^SUB_BITS
+    static const int BUCKETS = (64 - SUB_BITS + 1) << SUB_BITS;
+
+    std::vector<uint64_t> counts_;
+    uint64_t total_;
+    uint64_t max_;
+
+    // 小于16的值每个值一个桶；更大的值按最高位所在的区间和其后4位分桶
+    static int bucket_of(uint64_t value) {
+        if (value < (1u << SUB_BITS)) return static_cast<int>(value);
+        int exponent = highest_bit(value);
+        int mantissa = static_cast<int>((value >> (exponent - SUB_BITS)) & ((1u << SUB_BITS) - 1));
+        return ((exponent - SUB_BITS + 1) << SUB_BITS) | mantissa;
+    }
+
+    static uint64_t bucket_mid(int index) {
+        if (index < (1 << SUB_BITS)) return static_cast<uint64_t>(index);
+        int exponent = (index >> SUB_BITS) + SUB_BITS - 1;
+        uint64_t mantissa = static_cast<uint64_t>(index & ((1 << SUB_BITS) - 1));
+        uint64_t low = ((1ull << SUB_BITS) | mantissa) << (exponent - SUB_BITS);
+        uint64_t width = 1ull << (exponent - SUB_BITS);
+        return low + width / 2;
+    }
+};
+
+//------------------------------------------------------------------------------
+// 不变式检查
+//------------------------------------------------------------------------------
+
+// 上一步之后的状态中检查所需的部分
+struct InvariantTracker {
+    int locked_cells; // 已固定的格子数
+    int score;
+    int lines;
+    bool game_over;
+};
+
+// 开局时的检查基准
+static InvariantTracker tracker_for(const GameState& state) {
+    int cells = 0;
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        cells += count_bits(state.rows[y]);
+    }
+    InvariantTracker tracker;
+    tracker.locked_cells = cells;
+    tracker.score = state.score;
+    tracker.lines = state.lines;
+    tracker.game_over = state.game_over;
+    return tracker;
+}
+
+// 检查一步之后的游戏，返回nullptr表示通过，否则返回违反的不变式；通过时更新tracker
+static const char* check_invariants(const TetrisGame& game, InvariantTracker& tracker) {
+    const GameState& state = game.get_state();
+
+    // 1. 颜色平面与占用层一致
+    int cells = 0;
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        if (state.rows[y] & ~FULL_ROW_MASK) return "棋盘外的列有方块";
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            int color = state.board[y][x];
+            if (color < 0 || color > 7) return "格子颜色超出0-7";
+            if ((color != 0) != (((state.rows[y] >> x) & 1) != 0)) return "占用层与颜色平面不一致";
+        }
+        cells += count_bits(state.rows[y]);
+    }
+
+    // 2. 当前方块在棋盘内且不与已固定的方块重叠
+    if (!state.game_over) {
+        if (state.piece_type < 0 || state.piece_type >= 7 || state.rotation < 0 || state.rotation >= 4) {
+            return "方块类型或旋转状态无效";
+        }
+        const TetrominoShape& shape = PieceTable::shape(state.piece_type, state.rotation);
+        for (int i = 0; i < 4; ++i) {
+            int x = state.piece_pos.x + shape.blocks[i].x;
+            int y = state.piece_pos.y + shape.blocks[i].y;
+            if (x < 0 || x >= BOARD_WIDTH || y < 0 || y >= BOARD_HEIGHT) return "当前方块超出棋盘";
+            if ((state.rows[y] >> x) & 1) return "当前方块与已固定的方块重叠";
+        }
+    }
+
+    // 3. 格子数守恒：固定一个方块增加4格，每消除一行减少BOARD_WIDTH格
+    int change = cells - tracker.locked_cells + (state.lines - tracker.lines) * BOARD_WIDTH;
+    if (change != 0 && change != 4) return "格子数不守恒（方块重叠或丢失）";
+
+    // 4. 表面高度与已固定的方块一致
+    for (int x = 0; x < BOARD_WIDTH; ++x) {
+        int height = 0;
+        for (int y = 0; y < BOARD_HEIGHT; ++y) {
+            if ((state.rows[y] >> x) & 1) {
+                height = BOARD_HEIGHT - y;
+                break;
+            }
+        }
+        if (state.column_heights[x] != height) return "表面高度与已固定的方块不一致";
+    }
+
+    // 5. 合成的棋盘等于已固定的方块加上当前方块（缓存的合成结果没有过期的行）
+    int expected[BOARD_HEIGHT][BOARD_WIDTH];
+    memcpy(expected, state.board, sizeof(expected));
+    if (!state.game_over) {
+        const TetrominoShape& shape = PieceTable::shape(state.piece_type, state.rotation);
+        for (int i = 0; i < 4; ++i) {
+            expected[state.piece_pos.y + shape.blocks[i].y][state.piece_pos.x + shape.blocks[i].x] = state.piece_type + 1;
+        }
+    }
+    if (memcmp(expected, game.get_board(), sizeof(expected)) != 0) return "合成的棋盘与游戏状态不一致";
+
+    // 6. 分数、行数单调，结束状态不可恢复
+    if (state.score < tracker.score || state.lines < tracker.lines) return "分数或行数减少";
+    if (tracker.game_over && !state.game_over) return "游戏结束后又恢复";
+
+    tracker.locked_cells = cells;
+    tracker.score = state.score;
+    tracker.lines = state.lines;
+    tracker.game_over = state.game_over;
+    return nullptr;
+}
+
+//------------------------------------------------------------------------------
+// 模拟
+//------------------------------------------------------------------------------
+
+// 一个工作线程的统计
+struct WorkerResult {
+    LatencyHistogram latency; // 单步延迟（纳秒）
+    uint64_t moves = 0;       // 执行的总步数
+};
+
+// 所有线程共享的运行状态
+struct SimContext {
+    const SimOptions* options;
+    const ReplayScript* script;
+    uint64_t clock_overhead_ns;    // 两次读取时钟本身的耗时，从每个延迟样本中扣除
+    std::atomic<int> next_game;    // 下一局的编号
+    std::atomic<bool> failed;      // 发现了不变式违反或回放结果不一致
+    std::vector<int> scores;       // 每局的最终分数（按对局编号存放，各线程写不同的元素）
+    std::mutex report_mutex;       // 串行化错误报告
+};
+
+// 打印出错时的棋盘（只有已固定的方块，当前方块的位置在最后一行）
+static void print_board(const GameState& state) {
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        fputs("  |", stderr);
+        for (int x = 0; x < BOARD_WIDTH; ++x) {
+            int color = state.board[y][x];
+            fputc(color ? '0' + color : '.', stderr);
+        }
+        fputs("|\n", stderr);
+    }
+    fprintf(stderr, "  piece=%d rotation=%d pos=(%d,%d) score=%d lines=%d game_over=%d\n",
+            state.piece_type, state.rotation, state.piece_pos.x, state.piece_pos.y,
+            state.score, state.lines, state.game_over ? 1 : 0);
+}
+
+// 贪心策略当前方块的执行计划：与TetrisSolver::apply的按键顺序相同，先旋转，再左右移动到目标x，最后硬降
+// 每次只取一个按键，让每一步都经过不变式检查
+struct GreedyPlan {
+    bool active;   // 是否已经为当前方块求解
+    int rotations; // 还需要旋转的次数
+    int x;         // 目标锚点x
+    bool blocked;  // 左右移动被挡住，直接硬降
+};
+
+// 取贪心策略的下一个按键；找不到可行落点时返回ACTION_NONE
+static int next_greedy_action(const TetrisSolver& solver, const TetrisGame& game, GreedyPlan& plan) {
+    if (!plan.active) {
+        SolverMove move = solver.suggest(game, 1);
+        if (!move.valid) return ACTION_NONE;
+        plan.active = true;
+        plan.rotations = move.rotations;
+        plan.x = move.x;
+        plan.blocked = false;
+    }
+    if (plan.rotations > 0) {
+        plan.rotations--;
+        return ACTION_ROTATE;
+    }
+    int x = game.get_state().piece_pos.x;
+    if (!plan.blocked && x < plan.x) return ACTION_RIGHT;
+    if (!plan.blocked && x > plan.x) return ACTION_LEFT;
+    plan.active = false; // 硬降后为下一个方块重新求解
+    return ACTION_DROP;
+}
+
+// 玩一局游戏，返回false表示发现了错误
+static bool play_game(SimContext& context, TetrisGame& game, const TetrisSolver& solver,
+                      int index, WorkerResult& result) {
+    const SimOptions& options = *context.options;
+    uint64_t seed = options.seed + static_cast<uint64_t>(index);
+    TetrisRng rng;
+    rng.seed(seed ^ 0x5851f42d4c957f2dULL); // 动作序列和方块序列使用不同的随机流
+
+    if (options.policy == POLICY_REPLAY) {
+        game.set_randomizer(context.script->randomizer);
+        game.start_new_game_seeded(context.script->seed);
+    } else {
+        game.set_randomizer(options.randomizer);
+        game.start_new_game_seeded(seed);
+    }
+    InvariantTracker tracker = tracker_for(game.get_state());
+    GreedyPlan plan = GreedyPlan();
+
+    for (uint64_t move = 0; move < options.max_moves && !game.is_game_over(); ++move) {
+        int action;
+        if (options.policy == POLICY_RANDOM) {
+            action = ACTION_LEFT + static_cast<int>(rng.next_below(ACTION_COUNT - ACTION_LEFT));
+        } else if (options.policy == POLICY_GREEDY) {
+            action = next_greedy_action(solver, game, plan);
+            if (action == ACTION_NONE) break;
+        } else {
+            if (move >= context.script->actions.size()) break;
+            action = context.script->actions[move];
+        }
+
+        SimClock::time_point start = SimClock::now();
+        bool moved = game.apply_action(action);
+        uint64_t elapsed = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(SimClock::now() - start).count());
+        result.latency.add(elapsed > context.clock_overhead_ns ? elapsed - context.clock_overhead_ns : 0);
+        result.moves++;
+        if (!moved && (action == ACTION_LEFT || action == ACTION_RIGHT)) {
+            plan.blocked = true; // 贪心策略的移动被挡住时停在原地硬降（与TetrisSolver::apply一致）
+        }
+
+        if (options.check) {
+            const char* violation = check_invariants(game, tracker);
+            if (violation) {
+                std::lock_guard<std::mutex> lock(context.report_mutex);
+                fprintf(stderr, "不变式被破坏: %s\n  game=%d seed=%llu move=%llu action=%d\n", violation, index,
+                        static_cast<unsigned long long>(options.policy == POLICY_REPLAY ? context.script->seed : seed),
+                        static_cast<unsigned long long>(move), action);
+                print_board(game.get_state());
+                return false;
+            }
+        }
+    }
+
+    context.scores[index] = game.get_score();
+    if (options.policy == POLICY_REPLAY && game.get_score() != context.script->expected_score) {
+        std::lock_guard<std::mutex> lock(context.report_mutex);
+        fprintf(stderr, "回放结果不一致: game=%d 分数%d，回放引擎的结果是%d\n",
+                index, game.get_score(), context.script->expected_score);
+        return false;
+    }
+    return true;
+}
+
+// 工作线程：不断领取下一局的编号，在线程自己的游戏实例上玩完
+static void worker(SimContext& context, WorkerResult& result) {
+    TetrisGame game(0); // 每个线程只有一个游戏实例，逐局复用
+    TetrisSolver solver;
+    const int games = context.options->games;
+    for (;;) {
+        if (context.failed.load(std::memory_order_relaxed)) return;
+        int index = context.next_game.fetch_add(1, std::memory_order_relaxed);
+        if (index >= games) return;
+        if (!play_game(context, game, solver, index, result)) {
+            context.failed.store(true);
+            return;
+        }
+    }
+}
+
+// 测量两次连续读取时钟的耗时（取多次测量的最小值）
+static uint64_t measure_clock_overhead() {
+    uint64_t best = ~0ull;
+    for (int i = 0; i < 1000; ++i) {
+        SimClock::time_point start = SimClock::now();
+        uint64_t elapsed = static_cast<uint64_t>(
+            std::chrono::duration_cast<std::chrono::nanoseconds>(SimClock::now() - start).count());
+        best = std::min(best, elapsed);
+    }
+    return best;
+}
+
+// 读取并解码回放日志（格式见tetris_replay.h），同时用回放引擎得到期望的最终分数
+static bool load_replay(const std::string& path, ReplayScript* script) {
+    std::ifstream file(path.c_str(), std::ios::binary);
+    if (!file) return false;
+    std::vector<uint8_t> data((std::istreambuf_iterator<char>(file)), std::istreambuf_iterator<char>());
+    ReplayResult result;
+    if (!replay_game(data.data(), data.size(), &result)) return false; // 同时校验了魔数、版本和动作编码
+
+    script->seed = 0;
+    for (int i = 0; i < 8; ++i) {
+        script->seed |= static_cast<uint64_t>(data[8 + i]) << (8 * i);
+    }
+    script->randomizer = data[5];
+    script->actions.clear();
+    for (size_t i = REPLAY_HEADER_SIZE; i < data.size(); ++i) {
+        int run = (data[i] >> 3) + 1;
+        script->actions.insert(script->actions.end(), run, static_cast<uint8_t>(data[i] & 7));
+    }
+    script->expected_score = result.score;
+    return true;
+}
+
+//------------------------------------------------------------------------------
+// 输出
+//------------------------------------------------------------------------------
+
+// 汇总结果
+struct SimSummary {
+    int games;
+    uint64_t moves;
+    double seconds;
+    LatencyHistogram latency;
+    std::vector<int> sorted_scores;
+    double mean_score;
+    double score_stddev; // 分数的标准差：随机方式越公平，同样的置信度需要的局数越少
+
+    int score_percentile(double p) const {
+        if (sorted_scores.empty()) return 0;
+        size_t index = static_cast<size_t>(p / 100.0 * (sorted_scores.size() - 1) + 0.5);
+        return sorted_scores[index];
+    }
+};
+
+static void write_text(const SimOptions& options, int threads, const SimSummary& s) {
+    printf("策略 %s，随机方式 %s，%d个线程，%d局，共%llu步，用时%.3f秒\n", POLICY_NAMES[options.policy],
+           RANDOMIZER_NAMES[options.randomizer], threads, s.games, static_cast<unsigned long long>(s.moves), s.seconds);
+    printf("吞吐量:   %.4g 局/秒，%.4g 步/秒\n", s.games / s.seconds, s.moves / s.seconds);
+    printf("单步延迟: p50 %llu ns，p99 %llu ns，最大 %llu ns\n",
+           static_cast<unsigned long long>(s.latency.percentile(50)),
+           static_cast<unsigned long long>(s.latency.percentile(99)),
+           static_cast<unsigned long long>(s.latency.max()));
+    printf("分数:     最小 %d，平均 %.2f，标准差 %.2f，p50 %d，p90 %d，p99 %d，最大 %d\n", s.score_percentile(0),
+           s.mean_score, s.score_stddev, s.score_percentile(50), s.score_percentile(90), s.score_percentile(99),
+           s.score_percentile(100));
+    printf("不变式:   %s\n", options.check ? "每一步都已检查，全部通过" : "未检查（--no-check）");
+}
+
+static void write_json(const SimOptions& options, int threads, const SimSummary& s) {
+    printf("{\n");
+    printf("  \"policy\": \"%s\",\n", POLICY_NAMES[options.policy]);
+    printf("  \"randomizer\": \"%s\",\n", RANDOMIZER_NAMES[options.randomizer]);
+    printf("  \"threads\": %d,\n", threads);
+    printf("  \"games\": %d,\n", s.games);
+    printf("  \"moves\": %llu,\n", static_cast<unsigned long long>(s.moves));
+    printf("  \"seconds\": %.6f,\n", s.seconds);
+    printf("  \"games_per_second\": %.2f,\n", s.games / s.seconds);
+    printf("  \"moves_per_second\": %.2f,\n", s.moves / s.seconds);
+    printf("  \"move_latency_ns\": {\"p50\": %llu, \"p99\": %llu, \"max\": %llu},\n",
+           static_cast<unsigned long long>(s.latency.percentile(50)),
+           static_cast<unsigned long long>(s.latency.percentile(99)),
+           static_cast<unsigned long long>(s.latency.max()));
+    printf("  \"score\": {\"min\": %d, \"mean\": %.3f, \"stddev\": %.3f, \"p50\": %d, \"p90\": %d, \"p99\": %d, "
+           "\"max\": %d},\n",
+           s.score_percentile(0), s.mean_score, s.score_stddev, s.score_percentile(50), s.score_percentile(90),
+           s.score_percentile(99), s.score_percentile(100));
+    printf("  \"invariants_checked\": %s\n", options.check ? "true" : "false");
+    printf("}\n");
+}
+
+static void print_usage(const char* program) {
+    fprintf(stderr, "用法: %s [--games=N] [--policy=random|greedy|replay] [--replay=文件] [--threads=N]\n"
+                    "       [--randomizer=uniform|bag7|history] [--seed=种子] [--max-moves=N] [--no-check] [--json]\n",
+            program);
+}
+
+int main(int argc, char** argv) {
+    SimOptions options;
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg.compare(0, 8, "--games=") == 0) {
+            options.games = atoi(arg.c_str() + 8);
+        } else if (arg == "--policy=random") {
+            options.policy = POLICY_RANDOM;
+        } else if (arg == "--policy=greedy") {
+            options.policy = POLICY_GREEDY;
+        } else if (arg == "--policy=replay") {
+            options.policy = POLICY_REPLAY;
+        } else if (arg.compare(0, 9, "--replay=") == 0) {
+            options.replay_path = arg.substr(9);
+        } else if (arg.compare(0, 10, "--threads=") == 0) {
+            options.threads = atoi(arg.c_str() + 10);
+        } else if (arg.compare(0, 13, "--randomizer=") == 0) {
+            options.randomizer = -1;
+            for (int k = 0; k < RANDOMIZER_COUNT; ++k) {
+                if (arg.compare(13, std::string::npos, RANDOMIZER_NAMES[k]) == 0) options.randomizer = k;
+            }
+            if (options.randomizer < 0) {
+                print_usage(argv[0]);
+                return 2;
+            }
+        } else if (arg.compare(0, 7, "--seed=") == 0) {
+            options.seed = strtoull(arg.c_str() + 7, nullptr, 10);
+        } else if (arg.compare(0, 12, "--max-moves=") == 0) {
+            options.max_moves = strtoull(arg.c_str() + 12, nullptr, 10);
+        } else if (arg == "--no-check") {
+            options.check = false;
+        } else if (arg == "--json") {
+            options.json = true;
+        } else {
+            print_usage(argv[0]);
+            return 2;
+        }
+    }
+    if (options.games <= 0) {
+        print_usage(argv[0]);
+        return 2;
+    }
+
+    ReplayScript script;
+    if (options.policy == POLICY_REPLAY) {
+        if (options.replay_path.empty() || !load_replay(options.replay_path, &script)) {
+            fprintf(stderr, "无法读取回放日志: %s\n", options.replay_path.c_str());
+            return 2;
+        }
+        options.randomizer = script.randomizer; // 输出中报告日志实际使用的随机方式
+    }
+
+#ifndef __OPTIMIZE__
+    fprintf(stderr, "警告: 未开启编译优化，吞吐量和延迟没有参考价值（请使用 -DCMAKE_BUILD_TYPE=Release 构建）\n");
+#endif
+
+    int threads = options.threads > 0 ? options.threads : static_cast<int>(std::thread::hardware_concurrency());
+    threads = std::max(1, std::min(threads, options.games));
+
+    SimContext context;
+    context.options = &options;
+    context.script = &script;
+    context.clock_overhead_ns = measure_clock_overhead();
+    context.next_game.store(0);
+    context.failed.store(false);
+    context.scores.assign(options.games, 0);
+
+    std::vector<WorkerResult> results(threads);
+    SimClock::time_point start = SimClock::now();
+    std::vector<std::thread> workers;
+    for (int t = 0; t < threads; ++t) {
+        workers.push_back(std::thread(worker, std::ref(context), std::ref(results[t])));
+    }
+    for (size_t t = 0; t < workers.size(); ++t) {
+        workers[t].join();
+    }
+    double seconds = std::chrono::duration<double>(SimClock::now() - start).count();
+    if (context.failed.load()) return 1;
+
+    SimSummary summary;
+    summary.games = options.games;
+    summary.moves = 0;
+    summary.seconds = seconds > 0 ? seconds : 1e-9;
+    for (int t = 0; t < threads; ++t) {
+        summary.latency.merge(results[t].latency);
+        summary.moves += results[t].moves;
+    }
+    summary.sorted_scores = context.scores;
+    std::sort(summary.sorted_scores.begin(), summary.sorted_scores.end());
+    double total = 0;
+    for (size_t i = 0; i < summary.sorted_scores.size(); ++i) {
+        total += summary.sorted_scores[i];
+    }
+    summary.mean_score = total / summary.sorted_scores.size();
+    double squares = 0;
+    for (size_t i = 0; i < summary.sorted_scores.size(); ++i) {
+        double diff = summary.sorted_scores[i] - summary.mean_score;
+        squares += diff * diff;
+    }
+    summary.score_stddev = std::sqrt(squares / summary.sorted_scores.size());
+
+    if (options.json) {
+        write_json(options, threads, summary);
+    } else {
+        write_text(options, threads, summary);
+    }
+    return 0;
+}
@@ -0,0 +1,167 @@
+// tetris_sized_game.cpp
+// 非标准尺寸棋盘的运行时接口：每个预先实例化的尺寸一个包装类，工厂按尺寸分派
+#include "tetris_sized_game.h"
+#include "tetris_core.h" // 默认种子序列
+
+// 某个尺寸的游戏：所有操作直接转给该尺寸的BasicTetrisGame
+// 成员函数的定义在tetris_game.cpp中，那里已经为这些尺寸显式实例化
+template <int Width, int Height>
+class SizedGameImpl : public SizedGame {
+public:
+    explicit SizedGameImpl(uint64_t seed) : game_(seed) {}
+
+    int width() const override { return Width; }
+    int height() const override { return Height; }
+
+    void start_new_game() override { game_.start_new_game(); }
+    void start_new_game_seeded(uint64_t seed) override { game_.start_new_game_seeded(seed); }
+    bool set_randomizer(int randomizer) override { return game_.set_randomizer(randomizer); }
+    bool apply_action(int action) override { return game_.apply_action(action); }
+
+    int apply_actions(const uint8_t* actions, int count) override {
+        int applied = 0;
+        while (applied < count && !game_.is_game_over()) {
+            game_.apply_action(actions[applied]);
+            applied++;
+        }
+        return applied;
+    }
+
+    void write_board(uint8_t* out_board) const override { game_.write_board(out_board); }
+
+    int get_score() const override { return game_.get_score(); }
+    int get_lines_cleared() const override { return game_.get_lines_cleared(); }
+    int get_level() const override { return game_.get_level(); }
+    bool is_game_over() const override { return game_.is_game_over(); }
+    int get_next_pieces(int* out_types, int n) const override { return game_.get_next_pieces(out_types, n); }
+    bool get_ghost_position(Point* out_pos) const override { return game_.get_ghost_position(out_pos); }
+
+private:
+    BasicTetrisGame<Width, Height> game_;
+};
+
+// 所有预先实例化的尺寸，按TETRIS_BOARD_SIZES的顺序
+static const int BOARD_SIZES[][2] = {
+#define TETRIS_BOARD_SIZE_ENTRY(W, H) {W, H},
+    TETRIS_BOARD_SIZES(TETRIS_BOARD_SIZE_ENTRY)
+#undef TETRIS_BOARD_SIZE_ENTRY
+};
+static const int BOARD_SIZE_COUNT = static_cast<int>(sizeof(BOARD_SIZES) / sizeof(BOARD_SIZES[0]));
+
+SizedGame* SizedGame::create(int width, int height, uint64_t seed) {
+#define TETRIS_CREATE_SIZED(W, H) \
+    if (width == W && height == H) return new SizedGameImpl<W, H>(seed);
+    TETRIS_BOARD_SIZES(TETRIS_CREATE_SIZED)
+#undef TETRIS_CREATE_SIZED
+    return nullptr; // 没有预先实例化的尺寸
+}
+
+bool SizedGame::is_supported(int width, int height) {
+    for (int i = 0; i < BOARD_SIZE_COUNT; ++i) {
+        if (BOARD_SIZES[i][0] == width && BOARD_SIZES[i][1] == height) return true;
+    }
+    return false;
+}
+
+//------------------------------------------------------------------------------
+// C语言风格的API函数实现
+//------------------------------------------------------------------------------
+
+// 创建指定尺寸的游戏实例
+API_EXPORT SizedGame* create_game_sized(int width, int height) {
+    if (!SizedGame::is_supported(width, height)) return nullptr; // 不支持的尺寸不消耗默认种子
+    return SizedGame::create(width, height, TetrisCore::instance().next_seed());
+}
+
+// 用指定种子创建指定尺寸的游戏实例
+API_EXPORT SizedGame* create_game_sized_seeded(int width, int height, uint64_t seed) {
+    return SizedGame::create(width, height, seed);
+}
+
+// 销毁游戏实例
+API_EXPORT void destroy_game_sized(SizedGame* game) {
+    delete game;
+}
+
+// 指定尺寸是否可用
+API_EXPORT bool is_board_size_supported_api(int width, int height) {
+    return SizedGame::is_supported(width, height);
+}
+
+// 列出所有可用的尺寸
+API_EXPORT int get_board_sizes_api(int* out_sizes, int max_sizes) {
+    for (int i = 0; out_sizes && i < max_sizes && i < BOARD_SIZE_COUNT; ++i) {
+        out_sizes[i * 2] = BOARD_SIZES[i][0];
+        out_sizes[i * 2 + 1] = BOARD_SIZES[i][1];
+    }
+    return BOARD_SIZE_COUNT;
+}
+
+// 棋盘宽度
+API_EXPORT int sized_get_width_api(SizedGame* game) {
+    return game ? game->width() : 0;
+}
+
+// 棋盘高度
+API_EXPORT int sized_get_height_api(SizedGame* game) {
+    return game ? game->height() : 0;
+}
+
+// 开始新游戏
+API_EXPORT void sized_start_new_game_api(SizedGame* game) {
+    if (game) game->start_new_game();
+}
+
+// 用指定种子开始新游戏
+API_EXPORT void sized_start_new_game_seeded_api(SizedGame* game, uint64_t seed) {
+    if (game) game->start_new_game_seeded(seed);
+}
+
+// 设置随机方式
+API_EXPORT bool sized_set_randomizer_api(SizedGame* game, int randomizer) {
+    return game ? game->set_randomizer(randomizer) : false;
+}
+
+// 执行一次操作
+API_EXPORT bool sized_apply_action_api(SizedGame* game, int action) {
+    return game ? game->apply_action(action) : false;
+}
+
+// 依次执行多个操作
+API_EXPORT int sized_apply_actions_api(SizedGame* game, const uint8_t* actions, int count) {
+    return (game && actions) ? game->apply_actions(actions, count) : 0;
+}
+
+// 获取棋盘
+API_EXPORT void sized_get_board_api(SizedGame* game, uint8_t* out_board) {
+    if (game && out_board) game->write_board(out_board);
+}
+
+// 获取得分
+API_EXPORT int sized_get_score_api(SizedGame* game) {
+    return game ? game->get_score() : 0;
+}
+
+// 获取累计消除的行数
+API_EXPORT int sized_get_lines_api(SizedGame* game) {
+    return game ? game->get_lines_cleared() : 0;
+}
+
+// 检查游戏是否结束
+API_EXPORT bool sized_is_game_over_api(SizedGame* game) {
+    return game ? game->is_game_over() : true;
+}
+
+// 获取后续方块预览
+API_EXPORT int sized_get_next_pieces_api(SizedGame* game, int n, int* out_types) {
+    return game && out_types ? game->get_next_pieces(out_types, n) : 0;
+}
+
+// 获取落点预览
+API_EXPORT bool sized_get_ghost_position_api(SizedGame* game, int* out_x, int* out_y) {
+    Point pos;
+    if (!game || !game->get_ghost_position(&pos)) return false;
+    if (out_x) *out_x = pos.x;
+    if (out_y) *out_y = pos.y;
+    return true;
+}
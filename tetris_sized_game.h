@@ -0,0 +1,91 @@
+// tetris_sized_game.h
+// 非标准尺寸棋盘的运行时接口
+// 棋盘引擎BasicTetrisGame<Width, Height>的尺寸是编译期常量，每个尺寸是一份独立的代码：
+// 行掩码的类型、棋盘数组的大小和所有按行/按列的循环边界都在编译时确定。
+// 运行时才知道尺寸的调用方（例如Python训练不同尺寸的小棋盘）通过这里的SizedGame使用它们：
+// create_game_sized(w, h)在TETRIS_BOARD_SIZES列出的尺寸中选择对应的实例，不支持的尺寸返回NULL。
+//
+// 每个操作只在接口上付出一次虚调用，游戏逻辑本身仍然是对应尺寸的专用代码；
+// 批量执行动作（apply_actions）只有一次虚调用，循环在具体尺寸的实例内部。
+// 标准的10x20棋盘仍然使用TetrisGame和tetris_game.h中的C API（板块分配、回放、存档、会话等都只支持标准尺寸）。
+#ifndef TETRIS_SIZED_GAME_H // 防止头文件被重复包含的保护宏
+#define TETRIS_SIZED_GAME_H
+
+#include <cstdint>       // 固定宽度整数类型
+#include "tetris_game.h" // BasicTetrisGame、TETRIS_BOARD_SIZES、API_EXPORT
+
+// 任意预先实例化尺寸的一局游戏
+class SizedGame {
+public:
+    virtual ~SizedGame() {}
+
+    // 棋盘尺寸
+    virtual int width() const = 0;
+    virtual int height() const = 0;
+
+    // 开局、随机方式和操作，含义与TetrisGame的同名函数相同
+    virtual void start_new_game() = 0;
+    virtual void start_new_game_seeded(uint64_t seed) = 0;
+    virtual bool set_randomizer(int randomizer) = 0;
+    virtual bool apply_action(int action) = 0;
+
+    // 依次执行count个动作（TetrisAction），游戏结束后不再执行；返回执行的动作数
+    virtual int apply_actions(const uint8_t* actions, int count) = 0;
+
+    // 把当前棋盘（已固定的方块加上当前方块）按行优先写入height() * width()字节
+    virtual void write_board(uint8_t* out_board) const = 0;
+
+    // 游戏状态
+    virtual int get_score() const = 0;
+    virtual int get_lines_cleared() const = 0;
+    virtual int get_level() const = 0;
+    virtual bool is_game_over() const = 0;
+    virtual int get_next_pieces(int* out_types, int n) const = 0;
+    virtual bool get_ghost_position(Point* out_pos) const = 0;
+
+    // 创建指定尺寸的游戏，尺寸不在TETRIS_BOARD_SIZES中时返回nullptr
+    static SizedGame* create(int width, int height, uint64_t seed);
+
+    // 指定尺寸是否预先实例化过
+    static bool is_supported(int width, int height);
+};
+
+// 定义C风格的API接口
+extern "C" {
+    // 创建指定尺寸的游戏实例（种子由默认种子序列生成/使用指定的种子），尺寸不支持时返回NULL
+    // 与create_game不同，这里的实例是堆分配的
+    API_EXPORT SizedGame* create_game_sized(int width, int height);
+    API_EXPORT SizedGame* create_game_sized_seeded(int width, int height, uint64_t seed);
+
+    // 销毁create_game_sized/create_game_sized_seeded返回的实例
+    API_EXPORT void destroy_game_sized(SizedGame* game);
+
+    // 指定尺寸是否可用
+    API_EXPORT bool is_board_size_supported_api(int width, int height);
+
+    // 列出所有可用的尺寸：依次写入(宽, 高)对，最多max_sizes对；返回可用尺寸的总数
+    API_EXPORT int get_board_sizes_api(int* out_sizes, int max_sizes);
+
+    // 棋盘尺寸
+    API_EXPORT int sized_get_width_api(SizedGame* game);
+    API_EXPORT int sized_get_height_api(SizedGame* game);
+
+    // 开局和随机方式
+    API_EXPORT void sized_start_new_game_api(SizedGame* game);
+    API_EXPORT void sized_start_new_game_seeded_api(SizedGame* game, uint64_t seed);
+    API_EXPORT bool sized_set_randomizer_api(SizedGame* game, int randomizer);
+
+    // 按动作编码执行一次/多次操作（多次时返回执行的动作数）
+    API_EXPORT bool sized_apply_action_api(SizedGame* game, int action);
+    API_EXPORT int sized_apply_actions_api(SizedGame* game, const uint8_t* actions, int count);
+
+    // 获取游戏状态
+    API_EXPORT void sized_get_board_api(SizedGame* game, uint8_t* out_board); // 写入width * height字节
+    API_EXPORT int sized_get_score_api(SizedGame* game);
+    API_EXPORT int sized_get_lines_api(SizedGame* game);
+    API_EXPORT bool sized_is_game_over_api(SizedGame* game);
+    API_EXPORT int sized_get_next_pieces_api(SizedGame* game, int n, int* out_types);
+    API_EXPORT bool sized_get_ghost_position_api(SizedGame* game, int* out_x, int* out_y);
+}
+
+#endif // TETRIS_SIZED_GAME_H
@@ -0,0 +1,285 @@
+// tetris_solver.cpp
+// 最佳落点求解器的实现
+#include "tetris_solver.h"
+#include "tetris_thread_pool.h"
+#include "tetris_stats.h"  // 插桩计数器（未开启时为空）
+#include <mutex> // 保护进程内默认权重
+
+// 无法继续游戏的局面的评分（比任何正常局面都低）
+static const double GAME_OVER_SCORE = -1e9;
+
+// 统计掩码中1的个数
+static inline int count_bits(uint32_t mask) {
+#if defined(__GNUC__) || defined(__clang__)
+    return __builtin_popcount(mask);
+#else
+    int count = 0;
+    for (; mask; mask &= mask - 1) ++count;
+    return count;
+#endif
+}
+
+// 把形状的4行掩码对齐到左上角后打包成一个整数，用于判断两个旋转状态的形状是否相同
+// SRS中S、Z、I的两对旋转状态形状相同、只是在边界框中错开一格，对齐后它们的落点集合也相同
+static inline uint64_t shape_key(const TetrominoShape& shape) {
+    uint64_t key = 0;
+    for (int row = shape.min_y; row <= shape.max_y; ++row) {
+        key |= static_cast<uint64_t>(shape.row_masks[row] >> shape.min_x) << ((row - shape.min_y) * 16);
+    }
+    return key;
+}
+
+TetrisSolver::TetrisSolver() : weights_(default_weights()) {
+}
+
+TetrisSolver::TetrisSolver(const SolverWeights& weights) : weights_(weights) {
+}
+
+// 默认权重
+SolverWeights TetrisSolver::default_weights() {
+    SolverWeights weights;
+    weights.aggregate_height = -0.510066;
+    weights.complete_lines = 0.760666;
+    weights.holes = -0.35663;
+    weights.bumpiness = -0.184483;
+    return weights;
+}
+
+// 枚举所有可到达的落点
+// 到达方式：先连续旋转0-3次（某次旋转失败则更多次的旋转也无法到达），
+// 再一直向左或一直向右移动，途经的每个位置都是一个落点
+void TetrisSolver::enumerate(const GameState& base, TetrisGame& scratch, std::vector<Candidate>& out) {
+    out.clear();
+    if (base.game_over) return;
+
+    std::vector<uint64_t> seen_shapes;  // 已枚举过的形状（有些方块的多个旋转状态形状相同）
+    for (int rotations = 0; rotations < PieceTable::ROTATIONS; ++rotations) {
+        scratch.restore_state(base);
+        bool reachable = true;
+        for (int k = 0; k < rotations && reachable; ++k) {
+            reachable = scratch.rotate_piece();
+        }
+        if (!reachable) break;
+
+        const GameState rotated = scratch.get_state();
+        uint64_t key = shape_key(PieceTable::shape(rotated.piece_type, rotated.rotation));
+        bool duplicate = false;
+        for (size_t i = 0; i < seen_shapes.size(); ++i) {
+            duplicate = duplicate || seen_shapes[i] == key;
+        }
+        if (duplicate) continue; // 同样的形状在更少的旋转次数下已经枚举过
+        seen_shapes.push_back(key);
+
+        Candidate candidate;
+        candidate.rotations = rotations;
+        candidate.rotation = rotated.rotation;
+
+        // 原位置
+        candidate.x = rotated.piece_pos.x;
+        candidate.state = rotated;
+        out.push_back(candidate);
+
+        // 向左移动到头
+        while (scratch.move_left()) {
+            candidate.state = scratch.get_state();
+            candidate.x = candidate.state.piece_pos.x;
+            out.push_back(candidate);
+        }
+
+        // 向右移动到头
+        scratch.restore_state(rotated);
+        while (scratch.move_right()) {
+            candidate.state = scratch.get_state();
+            candidate.x = candidate.state.piece_pos.x;
+            out.push_back(candidate);
+        }
+    }
+}
+
+// 对落下后的局面打分
+double TetrisSolver::evaluate_board(const GameState& state, int lines) const {
+    if (state.game_over) return GAME_OVER_SCORE + lines; // 新方块已经放不下了
+
+    // 表面高度只统计已经固定的方块（不包括新生成的方块），直接取自游戏状态
+    // 空洞是各列表面之下的空格：总数等于各列高度之和减去已固定的格子数（占用层中只有已固定的方块）
+    int aggregate_height = 0;
+    int bumpiness = 0;
+    for (int x = 0; x < BOARD_WIDTH; ++x) {
+        int height = state.column_heights[x];
+        aggregate_height += height;
+        if (x > 0) {
+            int previous = state.column_heights[x - 1];
+            bumpiness += height > previous ? height - previous : previous - height;
+        }
+    }
+    int locked_cells = 0;
+    for (int y = 0; y < BOARD_HEIGHT; ++y) {
+        locked_cells += count_bits(state.rows[y]);
+    }
+    int holes = aggregate_height - locked_cells;
+
+    return weights_.aggregate_height * aggregate_height +
+           weights_.complete_lines * lines +
+           weights_.holes * holes +
+           weights_.bumpiness * bumpiness;
+}
+
+// 对一个候选落点求值
+double TetrisSolver::evaluate_candidate(const Candidate& candidate, int depth, int root_lines,
+                                        TetrisGame& scratch) const {
+    scratch.restore_state(candidate.state);
+    scratch.drop_piece(); // 与真实游戏完全相同的落地、消行和生成下一个方块的逻辑
+    const GameState& after = scratch.get_state();
+    if (depth <= 1 || after.game_over) {
+        return evaluate_board(after, after.lines - root_lines);
+    }
+    GameState next = after; // scratch会在递归中被复用，先复制一份
+    return search(next, depth - 1, root_lines);
+}
+
+// 在base状态下搜索最佳落点的评分
+double TetrisSolver::search(const GameState& base, int depth, int root_lines) const {
+    TetrisGame scratch(0); // 种子无关紧要：状态会被restore_state完全覆盖
+    std::vector<Candidate> candidates;
+    enumerate(base, scratch, candidates);
+    double best = GAME_OVER_SCORE * 2;
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        double value = evaluate_candidate(candidates[i], depth, root_lines, scratch);
+        if (value > best) best = value;
+    }
+    return best;
+}
+
+// 为当前方块求最佳落点
+SolverMove TetrisSolver::suggest(const TetrisGame& game, int depth) const {
+    SolverMove best;
+    best.valid = false;
+    best.rotations = 0;
+    best.x = 0;
+    best.rotation = 0;
+    best.score = GAME_OVER_SCORE * 2;
+
+    if (depth < 1) depth = 1;
+    if (depth > MAX_DEPTH) depth = MAX_DEPTH;
+
+    const GameState& base = game.get_state();
+    TetrisGame scratch(0);
+    std::vector<Candidate> candidates;
+    enumerate(base, scratch, candidates);
+    if (candidates.empty()) return best;
+
+    // 第一层候选落点的评分
+    std::vector<double> values(candidates.size());
+    if (depth == 1) {
+        // 只看当前方块时每个候选只需要几百纳秒，分发到线程的开销反而更大
+        for (size_t i = 0; i < candidates.size(); ++i) {
+            values[i] = evaluate_candidate(candidates[i], depth, base.lines, scratch);
+        }
+    } else {
+        ThreadPool::shared().parallel_for(static_cast<int>(candidates.size()), [&](int i) {
+            TetrisGame local_scratch(0); // 每个任务使用自己的临时游戏实例
+            values[i] = evaluate_candidate(candidates[i], depth, base.lines, local_scratch);
+        });
+    }
+
+    // 选出评分最高的落点（评分相同时保留先枚举到的，即旋转和移动更少的）
+    for (size_t i = 0; i < candidates.size(); ++i) {
+        if (!best.valid || values[i] > best.score) {
+            best.valid = true;
+            best.rotations = candidates[i].rotations;
+            best.x = candidates[i].x;
+            best.rotation = candidates[i].rotation;
+            best.score = values[i];
+        }
+    }
+    return best;
+}
+
+// 按求解结果执行按键
+void TetrisSolver::apply(TetrisGame& game, const SolverMove& move) {
+    for (int k = 0; k < move.rotations; ++k) {
+        game.rotate_piece();
+    }
+    while (game.get_state().piece_pos.x < move.x && game.move_right()) {
+    }
+    while (game.get_state().piece_pos.x > move.x && game.move_left()) {
+    }
+    game.drop_piece();
+}
+
+// 无界面自动游戏
+int TetrisSolver::play(TetrisGame& game, int depth, int max_pieces) const {
+    int placed = 0;
+    while (!game.is_game_over() && (max_pieces <= 0 || placed < max_pieces)) {
+        SolverMove move = suggest(game, depth);
+        if (!move.valid) break;
+        apply(game, move);
+        placed++;
+    }
+    return placed;
+}
+
+//------------------------------------------------------------------------------
+// C语言风格的求解器API函数实现
+//------------------------------------------------------------------------------
+
+// 进程内默认权重；修改很少发生，读取时复制一份
+static std::mutex g_weights_mutex;
+static SolverWeights g_weights = TetrisSolver::default_weights();
+
+// 用当前默认权重创建求解器
+static TetrisSolver make_default_solver() {
+    std::lock_guard<std::mutex> lock(g_weights_mutex);
+    return TetrisSolver(g_weights);
+}
+
+// 求最佳落点
+API_EXPORT bool suggest_move_api(TetrisGame* game, int depth, int* out_rotations, int* out_x) {
+    TETRIS_STAT_SCOPE(STAT_API_SUGGEST_MOVE);
+    if (!game) return false;
+    SolverMove move = make_default_solver().suggest(*game, depth);
+    if (!move.valid) return false;
+    if (out_rotations) *out_rotations = move.rotations;
+    if (out_x) *out_x = move.x;
+    return true;
+}
+
+// 在状态快照上求最佳落点
+API_EXPORT bool suggest_move_from_state_api(const GameState* state, int depth, int* out_rotations, int* out_x) {
+    TETRIS_STAT_SCOPE(STAT_API_SUGGEST_MOVE);
+    if (!state) return false;
+    TetrisGame game(0); // 临时实例，只用来承载快照
+    game.restore_state(*state);
+    SolverMove move = make_default_solver().suggest(game, depth);
+    if (!move.valid) return false;
+    if (out_rotations) *out_rotations = move.rotations;
+    if (out_x) *out_x = move.x;
+    return true;
+}
+
+// 求解并立即执行
+API_EXPORT bool apply_suggested_move_api(TetrisGame* game, int depth) {
+    if (!game) return false;
+    SolverMove move = make_default_solver().suggest(*game, depth);
+    if (!move.valid) return false;
+    TetrisSolver::apply(*game, move);
+    return true;
+}
+
+// 设置默认权重
+API_EXPORT void set_solver_weights_api(double aggregate_height, double complete_lines,
+                                       double holes, double bumpiness) {
+    std::lock_guard<std::mutex> lock(g_weights_mutex);
+    g_weights.aggregate_height = aggregate_height;
+    g_weights.complete_lines = complete_lines;
+    g_weights.holes = holes;
+    g_weights.bumpiness = bumpiness;
+}
+
+// 无界面模式：自动玩完一局
+API_EXPORT int play_headless_api(uint64_t seed, int depth, int max_pieces) {
+    TetrisGame game(seed);
+    game.start_new_game();
+    make_default_solver().play(game, depth, max_pieces);
+    return game.get_score();
+}
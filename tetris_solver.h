@@ -0,0 +1,102 @@
+// tetris_solver.h
+// 最佳落点求解器：自动游戏和提示功能的核心
+// 对当前方块枚举所有可到达的（旋转, x）落点：完全按照游戏本身的规则执行旋转（含墙踢）、
+// 左右移动和硬降，因此给出的每个落点都可以用真实的按键序列复现。
+// 每个落点用可配置的启发式函数打分（总高度、消除行数、空洞数、表面起伏度），
+// 可以向后多看一到两个方块（游戏是确定性的，后续方块就是这局游戏真正会出现的方块），
+// 向后看时把第一层的候选落点分发到工作窃取线程池并行计算。
+#ifndef TETRIS_SOLVER_H // 防止头文件被重复包含的保护宏
+#define TETRIS_SOLVER_H
+
+#include "tetris_game.h"
+#include <vector> // 候选落点列表
+
+// 启发式评分的权重：评分 = 各项特征 * 对应权重 之和，分数越高越好
+struct SolverWeights {
+    double aggregate_height; // 所有列高度之和（通常为负权重）
+    double complete_lines;   // 消除的行数（通常为正权重）
+    double holes;            // 空洞数：某列最高方块下方的空格数（通常为负权重）
+    double bumpiness;        // 表面起伏度：相邻列高度差的绝对值之和（通常为负权重）
+};
+
+// 求解结果：描述如何从当前状态把方块放到最佳位置
+struct SolverMove {
+    bool valid;     // 是否找到了可行的落点（游戏已结束时为false）
+    int rotations;  // 需要顺时针旋转的次数（0-3）
+    int x;          // 旋转完成后需要移动到的锚点x坐标
+    int rotation;   // 最终的旋转状态
+    double score;   // 该落点的评分
+};
+
+class TetrisSolver {
+public:
+    // 使用默认权重
+    TetrisSolver();
+
+    // 使用指定的权重
+    explicit TetrisSolver(const SolverWeights& weights);
+
+    // 默认权重（来自常见的四特征启发式调参结果）
+    static SolverWeights default_weights();
+
+    // 为当前方块求最佳落点
+    // depth: 向后看的方块数，1表示只考虑当前方块，2/3表示额外考虑后续一/两个方块
+    SolverMove suggest(const TetrisGame& game, int depth) const;
+
+    // 按求解结果执行按键：先旋转，再左右移动到目标x，最后硬降
+    static void apply(TetrisGame& game, const SolverMove& move);
+
+    // 无界面自动游戏：反复求解并执行，直到游戏结束或放置了max_pieces个方块
+    // max_pieces <= 0 表示不限制；返回放置的方块数
+    int play(TetrisGame& game, int depth, int max_pieces) const;
+
+    // 允许的最大向后看深度
+    static const int MAX_DEPTH = 3;
+
+private:
+    // 一个候选落点：到达方式和方块移动到位（还未硬降）时的状态
+    struct Candidate {
+        int rotations;
+        int rotation;
+        int x;
+        GameState state;
+    };
+
+    SolverWeights weights_;
+
+    // 从base状态出发枚举当前方块所有可到达的落点（去掉形状和位置完全相同的重复落点）
+    // scratch是用于模拟按键的临时游戏实例
+    static void enumerate(const GameState& base, TetrisGame& scratch, std::vector<Candidate>& out);
+
+    // 对一个候选落点求值：硬降后评分，depth > 1时继续搜索后续方块
+    double evaluate_candidate(const Candidate& candidate, int depth, int root_lines, TetrisGame& scratch) const;
+
+    // 在base状态下搜索最佳落点的评分
+    double search(const GameState& base, int depth, int root_lines) const;
+
+    // 对方块落下后的局面打分（只看已固定的方块，不包括新生成的方块）
+    double evaluate_board(const GameState& state, int lines) const;
+};
+
+// 定义C风格的求解器API接口
+extern "C" {
+    // 为当前方块求最佳落点：out_rotations接收需要旋转的次数，out_x接收旋转后的目标x
+    // 返回false表示没有可行落点（游戏已结束）
+    API_EXPORT bool suggest_move_api(TetrisGame* game, int depth, int* out_rotations, int* out_x);
+
+    // 同上，但在状态快照（clone_state_api的结果）上求解，不访问任何游戏实例
+    // 调用方可以在持有会话锁时复制状态、释放锁之后再求解，耗时的搜索不阻塞同一分片的其他会话
+    API_EXPORT bool suggest_move_from_state_api(const GameState* state, int depth, int* out_rotations, int* out_x);
+
+    // 求解并立即执行（自动游戏一步），返回是否执行了落子
+    API_EXPORT bool apply_suggested_move_api(TetrisGame* game, int depth);
+
+    // 设置进程内默认的启发式权重（之后的所有求解都使用新权重）
+    API_EXPORT void set_solver_weights_api(double aggregate_height, double complete_lines,
+                                           double holes, double bumpiness);
+
+    // 无界面模式：用指定种子开一局游戏，自动玩到结束（或放置max_pieces个方块），返回最终分数
+    API_EXPORT int play_headless_api(uint64_t seed, int depth, int max_pieces);
+}
+
+#endif // TETRIS_SOLVER_H
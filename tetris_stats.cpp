@@ -0,0 +1,213 @@
+// tetris_stats.cpp
+// 插桩计数器的登记、合并和C API实现
+#include "tetris_stats.h"
+
+// 被统计的函数名称，顺序与TetrisStatId一致
+static const char* const STAT_NAMES[STAT_COUNT] = {
+    "check_collision",
+    "place_or_remove_piece",
+    "clear_full_lines",
+    "spawn_new_piece",
+    "create_game",
+    "destroy_game",
+    "start_new_game_api",
+    "move_left_api",
+    "move_right_api",
+    "rotate_piece_api",
+    "drop_piece_api",
+    "game_tick_api",
+    "get_board_api",
+    "get_board_delta_api",
+    "get_board_packed_api",
+    "batch_step_api",
+    "create_session_api",
+    "lookup_session_api",
+    "suggest_move_api",
+};
+
+#ifdef TETRIS_ENABLE_STATS
+
+#include <mutex>  // 保护线程登记表
+#include <vector> // 存活线程的计数器列表
+
+// 一个线程的全部计数器
+struct ThreadStats {
+    StatCounter counters[STAT_COUNT];
+
+    ThreadStats() {
+        for (int i = 0; i < STAT_COUNT; ++i) {
+            counters[i].calls.store(0);
+            counters[i].timed_calls.store(0);
+            counters[i].cycles.store(0);
+        }
+    }
+};
+
+// 合并后的计数
+struct StatTotals {
+    uint64_t calls[STAT_COUNT];
+    uint64_t timed_calls[STAT_COUNT];
+    uint64_t cycles[STAT_COUNT];
+
+    StatTotals() {
+        clear();
+    }
+
+    void clear() {
+        for (int i = 0; i < STAT_COUNT; ++i) {
+            calls[i] = timed_calls[i] = cycles[i] = 0;
+        }
+    }
+
+    void add(const StatCounter* counters) {
+        for (int i = 0; i < STAT_COUNT; ++i) {
+            calls[i] += counters[i].calls.load(std::memory_order_relaxed);
+            timed_calls[i] += counters[i].timed_calls.load(std::memory_order_relaxed);
+            cycles[i] += counters[i].cycles.load(std::memory_order_relaxed);
+        }
+    }
+};
+
+// 全局登记表：存活线程的计数器、已退出线程合并下来的计数，以及reset时记下的基线
+struct StatRegistry {
+    std::mutex mutex;
+    std::vector<ThreadStats*> live;
+    StatTotals retired;
+    StatTotals base;
+    uint64_t timer_overhead; // 连续两次读周期计数器本身的耗时，读取时从每次采样中扣除
+
+    StatRegistry() {
+        // 取多次测量的最小值作为读计数器的固定开销
+        timer_overhead = ~0ull;
+        for (int i = 0; i < 1000; ++i) {
+            uint64_t start = stat_read_cycles();
+            uint64_t elapsed = stat_read_cycles() - start;
+            if (elapsed < timer_overhead) timer_overhead = elapsed;
+        }
+    }
+
+    // 合并所有线程的计数（调用方持有mutex）
+    void totals(StatTotals& out) const {
+        out = retired;
+        for (size_t t = 0; t < live.size(); ++t) {
+            out.add(live[t]->counters);
+        }
+    }
+};
+
+// 登记表故意不析构：其他线程可能在静态对象析构之后才退出
+static StatRegistry& stat_registry() {
+    static StatRegistry* registry = new StatRegistry();
+    return *registry;
+}
+
+thread_local StatCounter* tls_stat_counters = nullptr;
+
+// 线程退出时把本线程的计数合并到retired中并注销
+struct ThreadStatsOwner {
+    ThreadStats* stats;
+
+    ThreadStatsOwner() : stats(nullptr) {}
+
+    ~ThreadStatsOwner() {
+        if (!stats) return;
+        StatRegistry& registry = stat_registry();
+        {
+            std::lock_guard<std::mutex> lock(registry.mutex);
+            registry.retired.add(stats->counters);
+            for (size_t t = 0; t < registry.live.size(); ++t) {
+                if (registry.live[t] == stats) {
+                    registry.live[t] = registry.live.back();
+                    registry.live.pop_back();
+                    break;
+                }
+            }
+        }
+        tls_stat_counters = nullptr;
+        delete stats;
+    }
+};
+
+static thread_local ThreadStatsOwner tls_stats_owner;
+
+// 创建并登记当前线程的计数器数组
+StatCounter* stat_register_thread() {
+    ThreadStats* stats = new ThreadStats();
+    StatRegistry& registry = stat_registry();
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.live.push_back(stats);
+    }
+    tls_stats_owner.stats = stats;
+    tls_stat_counters = stats->counters;
+    return stats->counters;
+}
+
+#endif // TETRIS_ENABLE_STATS
+
+//------------------------------------------------------------------------------
+// C语言风格的统计API函数实现
+//------------------------------------------------------------------------------
+
+// 编译时是否开启了统计
+API_EXPORT bool stats_enabled_api() {
+#ifdef TETRIS_ENABLE_STATS
+    return true;
+#else
+    return false;
+#endif
+}
+
+// 被统计的函数数量
+API_EXPORT int get_stat_count_api() {
+    return STAT_COUNT;
+}
+
+// 被统计的函数名称
+API_EXPORT const char* get_stat_name_api(int id) {
+    return id >= 0 && id < STAT_COUNT ? STAT_NAMES[id] : nullptr;
+}
+
+// 读取统计数据
+API_EXPORT int get_stats_api(uint64_t* out_calls, uint64_t* out_cycles, int max_count) {
+#ifdef TETRIS_ENABLE_STATS
+    if (max_count <= 0) return 0;
+    int count = max_count < STAT_COUNT ? max_count : STAT_COUNT;
+    StatTotals totals;
+    StatTotals base;
+    StatRegistry& registry = stat_registry();
+    {
+        std::lock_guard<std::mutex> lock(registry.mutex);
+        registry.totals(totals);
+        base = registry.base;
+    }
+    const uint64_t overhead = registry.timer_overhead; // 构造后不再改变
+    for (int i = 0; i < count; ++i) {
+        uint64_t calls = totals.calls[i] - base.calls[i];
+        uint64_t timed_calls = totals.timed_calls[i] - base.timed_calls[i];
+        uint64_t cycles = totals.cycles[i] - base.cycles[i];
+        cycles = cycles > overhead * timed_calls ? cycles - overhead * timed_calls : 0;
+        if (out_calls) out_calls[i] = calls;
+        if (out_cycles) {
+            // 按采样调用的平均周期数外推到全部调用
+            out_cycles[i] = timed_calls ? static_cast<uint64_t>(static_cast<double>(cycles) / timed_calls * calls) : 0;
+        }
+    }
+    return count;
+#else
+    (void)out_calls;
+    (void)out_cycles;
+    (void)max_count;
+    return 0;
+#endif
+}
+
+// 清零统计数据
+// 其他线程的计数器只能由它们自己写，因此这里不直接清零，而是记下当前的合计作为基线
+API_EXPORT void reset_stats_api() {
+#ifdef TETRIS_ENABLE_STATS
+    StatRegistry& registry = stat_registry();
+    std::lock_guard<std::mutex> lock(registry.mutex);
+    registry.totals(registry.base);
+#endif
+}
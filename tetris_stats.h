@@ -0,0 +1,147 @@
+// tetris_stats.h
+// 热路径插桩计数器（编译期开关）
+// 用CMake选项TETRIS_ENABLE_STATS（定义同名宏）开启后，被插桩的函数会统计调用次数和累计CPU周期数；
+// 不开启时插桩宏展开为空语句，没有任何开销。
+// 每个线程写自己的计数器（不需要原子的读-改-写指令，也没有缓存行争用），
+// 读取时再把所有线程的计数器合并起来。
+// 调用次数是精确的；读周期计数器本身就比碰撞检测这样的函数还贵（虚拟机上尤其明显），
+// 因此每个线程只对每STAT_SAMPLE_PERIOD次调用中的一次计时，读取时按调用次数外推出总周期数。
+#ifndef TETRIS_STATS_H // 防止头文件被重复包含的保护宏
+#define TETRIS_STATS_H
+
+#include "tetris_game.h" // API_EXPORT
+#include <atomic>        // 计数器（每个线程只有自己写，用于让读取方安全地读到完整的值）
+#include <cstdint>
+
+// 被统计的函数编号
+// 新增编号时需要同时在tetris_stats.cpp的名称表中加上对应的名称
+enum TetrisStatId {
+    // 核心内部函数
+    STAT_CHECK_COLLISION = 0,
+    STAT_PLACE_OR_REMOVE_PIECE,
+    STAT_CLEAR_FULL_LINES,
+    STAT_SPAWN_NEW_PIECE,
+
+    // 公开的API入口
+    STAT_API_CREATE_GAME,
+    STAT_API_DESTROY_GAME,
+    STAT_API_START_NEW_GAME,
+    STAT_API_MOVE_LEFT,
+    STAT_API_MOVE_RIGHT,
+    STAT_API_ROTATE_PIECE,
+    STAT_API_DROP_PIECE,
+    STAT_API_GAME_TICK,
+    STAT_API_GET_BOARD,
+    STAT_API_GET_BOARD_DELTA,
+    STAT_API_GET_BOARD_PACKED,
+    STAT_API_BATCH_STEP,
+    STAT_API_CREATE_SESSION,
+    STAT_API_LOOKUP_SESSION,
+    STAT_API_SUGGEST_MOVE,
+
+    STAT_COUNT // 编号总数
+};
+
+#ifdef TETRIS_ENABLE_STATS
+
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))
+#include <intrin.h>     // __rdtsc
+#elif defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>  // __rdtsc
+#else
+#include <chrono>       // 没有周期计数器时使用纳秒级时钟
+#endif
+
+// 计时的采样周期（2的幂）
+const uint64_t STAT_SAMPLE_PERIOD = 64;
+
+// 一个函数的计数器
+struct StatCounter {
+    std::atomic<uint64_t> calls;       // 调用次数
+    std::atomic<uint64_t> timed_calls; // 其中计了时的调用次数
+    std::atomic<uint64_t> cycles;      // 计了时的调用累计的周期数
+};
+
+// 只有所属线程会写计数器，因此用relaxed的读+写代替fetch_add（不需要带lock前缀的指令）
+inline void stat_add(std::atomic<uint64_t>& value, uint64_t delta) {
+    value.store(value.load(std::memory_order_relaxed) + delta, std::memory_order_relaxed);
+}
+
+// 读取CPU周期计数器（x86上是rdtsc，其他平台退化为纳秒级时钟）
+inline uint64_t stat_read_cycles() {
+#if (defined(_MSC_VER) && (defined(_M_X64) || defined(_M_IX86))) || defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return static_cast<uint64_t>(std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count());
+#endif
+}
+
+// 当前线程的计数器数组，线程第一次使用前为nullptr
+extern thread_local StatCounter* tls_stat_counters;
+
+// 创建并登记当前线程的计数器数组（线程退出时合并到全局计数中）
+StatCounter* stat_register_thread();
+
+// 当前线程的计数器数组
+inline StatCounter* stat_thread_counters() {
+    StatCounter* counters = tls_stat_counters;
+    return counters ? counters : stat_register_thread();
+}
+
+// 作用域计时器：构造时增加调用次数，被采样的调用在析构时把经过的周期数加到当前线程的计数器上
+class StatScope {
+public:
+    explicit StatScope(int id) : counter_(&stat_thread_counters()[id]), start_(0) {
+        uint64_t calls = counter_->calls.load(std::memory_order_relaxed) + 1;
+        counter_->calls.store(calls, std::memory_order_relaxed);
+        if ((calls & (STAT_SAMPLE_PERIOD - 1)) == 1) start_ = stat_read_cycles();
+    }
+
+    ~StatScope() {
+        if (start_ == 0) return; // 本次调用没有被采样
+        stat_add(counter_->cycles, stat_read_cycles() - start_);
+        stat_add(counter_->timed_calls, 1);
+    }
+
+private:
+    StatScope(const StatScope&);            // 禁止复制
+    StatScope& operator=(const StatScope&); // 禁止赋值
+
+    StatCounter* counter_;
+    uint64_t start_;
+};
+
+#define TETRIS_STAT_CONCAT_INNER(a, b) a##b
+#define TETRIS_STAT_CONCAT(a, b) TETRIS_STAT_CONCAT_INNER(a, b)
+
+// 统计当前作用域（通常是整个函数体）的调用次数和耗时
+#define TETRIS_STAT_SCOPE(id) StatScope TETRIS_STAT_CONCAT(tetris_stat_scope_, __LINE__)(id)
+
+#else
+
+// 未开启统计：插桩宏不产生任何代码
+#define TETRIS_STAT_SCOPE(id) ((void)0)
+
+#endif // TETRIS_ENABLE_STATS
+
+// 定义C风格的统计API接口
+extern "C" {
+    // 编译时是否开启了统计
+    API_EXPORT bool stats_enabled_api();
+
+    // 被统计的函数数量（即STAT_COUNT）
+    API_EXPORT int get_stat_count_api();
+
+    // 第id个被统计的函数的名称（id越界时返回NULL）
+    API_EXPORT const char* get_stat_name_api(int id);
+
+    // 读取统计数据：合并所有线程的计数器，写入最多max_count个函数的调用次数和累计周期数（由采样外推）
+    // out_calls/out_cycles可以为NULL；返回写入的数量（未开启统计时返回0）
+    API_EXPORT int get_stats_api(uint64_t* out_calls, uint64_t* out_cycles, int max_count);
+
+    // 清零统计数据（之后读到的是从现在开始的增量）
+    API_EXPORT void reset_stats_api();
+}
+
+#endif // TETRIS_STATS_H
@@ -0,0 +1,152 @@
+// tetris_thread_pool.cpp
+// 工作窃取线程池的实现
+#include "tetris_thread_pool.h"
+#include <algorithm> // std::min
+
+// 当前线程所属的线程池和工作线程编号（不是工作线程时为nullptr/-1）
+static thread_local const ThreadPool* tls_pool = nullptr;
+static thread_local int tls_worker_index = -1;
+
+// 创建线程池并启动工作线程
+ThreadPool::ThreadPool(int thread_count) : pending_(0), stopping_(false), next_queue_(0) {
+    if (thread_count < 1) thread_count = 1;
+    for (int i = 0; i < thread_count; ++i) {
+        queues_.push_back(std::unique_ptr<WorkerQueue>(new WorkerQueue()));
+    }
+    for (int i = 0; i < thread_count; ++i) {
+        threads_.push_back(std::thread(&ThreadPool::worker_loop, this, i));
+    }
+}
+
+// 停止线程池：工作线程会先把队列里的任务执行完再退出
+ThreadPool::~ThreadPool() {
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        stopping_.store(true);
+    }
+    wake_.notify_all();
+    for (size_t i = 0; i < threads_.size(); ++i) {
+        threads_[i].join();
+    }
+}
+
+// 进程内共享的线程池
+ThreadPool& ThreadPool::shared() {
+    static ThreadPool pool(static_cast<int>(std::thread::hardware_concurrency()));
+    return pool;
+}
+
+// 工作线程数量
+int ThreadPool::thread_count() const {
+    return static_cast<int>(threads_.size());
+}
+
+// 当前线程在本线程池中的编号
+int ThreadPool::current_worker() const {
+    return tls_pool == this ? tls_worker_index : -1;
+}
+
+// 提交一个任务
+void ThreadPool::submit(const std::function<void()>& task) {
+    int index = current_worker();
+    if (index < 0) {
+        index = static_cast<int>(next_queue_.fetch_add(1, std::memory_order_relaxed) % queues_.size());
+    }
+    WorkerQueue& queue = *queues_[index];
+    {
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        queue.tasks.push_front(task);
+    }
+    {
+        // 在sleep_mutex_下增加计数，保证正在准备休眠的线程不会错过这次唤醒
+        std::lock_guard<std::mutex> lock(sleep_mutex_);
+        pending_.fetch_add(1);
+    }
+    wake_.notify_one();
+}
+
+// 从自己队列的头部取任务（后进先出）
+bool ThreadPool::pop_local(int index, std::function<void()>& task) {
+    WorkerQueue& queue = *queues_[index];
+    std::lock_guard<std::mutex> lock(queue.mutex);
+    if (queue.tasks.empty()) return false;
+    task.swap(queue.tasks.front());
+    queue.tasks.pop_front();
+    return true;
+}
+
+// 从其他线程队列的尾部窃取任务（先进先出，通常是较大的任务）
+bool ThreadPool::steal(int thief, std::function<void()>& task) {
+    int count = static_cast<int>(queues_.size());
+    for (int offset = 1; offset < count; ++offset) {
+        WorkerQueue& queue = *queues_[(thief + offset) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) continue;
+        task.swap(queue.tasks.back());
+        queue.tasks.pop_back();
+        return true;
+    }
+    return false;
+}
+
+// 工作线程主循环
+void ThreadPool::worker_loop(int index) {
+    tls_pool = this;
+    tls_worker_index = index;
+    std::function<void()> task;
+    for (;;) {
+        if (pop_local(index, task) || steal(index, task)) {
+            pending_.fetch_sub(1);
+            task();
+            task = nullptr; // 尽早释放任务捕获的资源
+            continue;
+        }
+        // 没有可执行的任务：休眠直到有新任务或线程池停止
+        std::unique_lock<std::mutex> lock(sleep_mutex_);
+        wake_.wait(lock, [this] { return pending_.load() > 0 || stopping_.load(); });
+        if (pending_.load() == 0 && stopping_.load()) return;
+    }
+}
+
+// 并行执行fn(0..count-1)
+void ThreadPool::parallel_for(int count, const std::function<void(int)>& fn) {
+    if (count <= 0) return;
+    if (count == 1) {
+        fn(0);
+        return;
+    }
+
+    // 共享的任务进度：帮手任务可能在parallel_for返回之后才开始运行，
+    // 因此进度放在shared_ptr中；帮手只有在领到有效下标时才会调用fn，
+    // 而所有下标完成之前parallel_for不会返回，所以fn的引用在使用期间一直有效
+    struct Progress {
+        std::atomic<int> next;     // 下一个待领取的下标
+        std::atomic<int> done;     // 已完成的下标数量
+        std::mutex mutex;
+        std::condition_variable finished;
+        Progress() : next(0), done(0) {}
+    };
+    std::shared_ptr<Progress> progress(new Progress());
+    const std::function<void(int)>* body = &fn;
+    auto run = [progress, body, count]() {
+        for (;;) {
+            int i = progress->next.fetch_add(1);
+            if (i >= count) return;
+            (*body)(i);
+            if (progress->done.fetch_add(1) + 1 == count) {
+                std::lock_guard<std::mutex> lock(progress->mutex);
+                progress->finished.notify_all();
+            }
+        }
+    };
+
+    int helpers = std::min(count - 1, thread_count());
+    for (int h = 0; h < helpers; ++h) {
+        submit(run);
+    }
+    run(); // 调用线程也参与执行
+
+    // 等待其他线程手里正在执行的下标完成
+    std::unique_lock<std::mutex> lock(progress->mutex);
+    progress->finished.wait(lock, [&progress, count] { return progress->done.load() >= count; });
+}
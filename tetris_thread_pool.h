@@ -0,0 +1,71 @@
+// tetris_thread_pool.h
+// 工作窃取（work-stealing）线程池
+// 每个工作线程有自己的任务队列：从自己队列的头部取任务（后进先出，缓存友好），
+// 自己的队列空了就从其他线程队列的尾部“窃取”任务，负载不均时也能让所有线程保持忙碌
+#ifndef TETRIS_THREAD_POOL_H // 防止头文件被重复包含的保护宏
+#define TETRIS_THREAD_POOL_H
+
+#include <atomic>              // 任务计数和停止标志
+#include <condition_variable>  // 空闲线程的休眠与唤醒
+#include <deque>               // 每个工作线程的双端任务队列
+#include <functional>          // 任务类型
+#include <memory>              // 工作线程队列的所有权
+#include <mutex>               // 保护任务队列
+#include <thread>              // 工作线程
+#include <vector>              // 工作线程列表
+
+class ThreadPool {
+public:
+    // 创建包含thread_count个工作线程的线程池（至少1个）
+    explicit ThreadPool(int thread_count);
+
+    // 析构函数：等待已提交的任务执行完毕后停止所有工作线程
+    ~ThreadPool();
+
+    // 进程内共享的线程池：第一次使用时创建，线程数等于CPU核心数
+    static ThreadPool& shared();
+
+    // 工作线程数量
+    int thread_count() const;
+
+    // 提交一个任务
+    // 在工作线程内提交时放入该线程自己的队列头部，否则轮流放入各个队列
+    void submit(const std::function<void()>& task);
+
+    // 并行执行fn(0), fn(1), ..., fn(count - 1)，全部完成后返回
+    // 调用线程自己也参与执行，因此在工作线程内嵌套调用也不会死锁
+    void parallel_for(int count, const std::function<void(int)>& fn);
+
+private:
+    ThreadPool(const ThreadPool&);            // 禁止复制
+    ThreadPool& operator=(const ThreadPool&); // 禁止赋值
+
+    // 一个工作线程的任务队列
+    struct WorkerQueue {
+        std::mutex mutex;
+        std::deque<std::function<void()> > tasks;
+    };
+
+    std::vector<std::unique_ptr<WorkerQueue> > queues_; // 每个工作线程一个队列
+    std::vector<std::thread> threads_;                  // 工作线程
+
+    std::mutex sleep_mutex_;          // 配合wake_使用
+    std::condition_variable wake_;    // 有新任务或需要停止时唤醒空闲线程
+    std::atomic<int> pending_;        // 已提交但还没有被取走的任务数
+    std::atomic<bool> stopping_;      // 线程池是否正在停止
+    std::atomic<unsigned> next_queue_; // 外部线程提交任务时轮流选择的队列
+
+    // 工作线程主循环
+    void worker_loop(int index);
+
+    // 从自己队列的头部取任务
+    bool pop_local(int index, std::function<void()>& task);
+
+    // 从其他线程队列的尾部窃取任务
+    bool steal(int thief, std::function<void()>& task);
+
+    // 当前线程在本线程池中的工作线程编号，不是本线程池的线程时返回-1
+    int current_worker() const;
+};
+
+#endif // TETRIS_THREAD_POOL_H
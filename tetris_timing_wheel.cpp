@@ -0,0 +1,69 @@
+// tetris_timing_wheel.cpp
+// 分层时间轮的实现
+#include "tetris_timing_wheel.h"
+
+TimingWheel::TimingWheel() : now_(0), size_(0) {
+}
+
+// 登记定时器
+void TimingWheel::schedule(uint64_t key, uint32_t generation, uint64_t delay) {
+    if (delay == 0) delay = 1;
+    if (delay > MAX_DELAY) delay = MAX_DELAY;
+    TimerEntry entry;
+    entry.key = key;
+    entry.generation = generation;
+    entry.expires = now_ + delay;
+    insert(entry);
+    size_++;
+}
+
+// 按剩余节拍数选择层：剩余不到64个节拍放第0层，不到64^2个放第1层，依此类推
+// 每一层的槽号取到期节拍对应的那几位
+void TimingWheel::insert(const TimerEntry& entry) {
+    uint64_t delta = entry.expires - now_;
+    int level = 0;
+    while (level < LEVELS - 1 && delta >= (1ull << (SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    int slot = static_cast<int>((entry.expires >> (SLOT_BITS * level)) & (SLOTS - 1));
+    slots_[level][slot].push_back(entry);
+}
+
+// 把高层当前槽中的定时器下沉到低层
+void TimingWheel::cascade(int level) {
+    int slot = static_cast<int>((now_ >> (SLOT_BITS * level)) & (SLOTS - 1));
+    std::vector<TimerEntry>& bucket = slots_[level][slot];
+    // 先换出来再逐个插入：重新插入的定时器不会回到同一个槽
+    std::vector<TimerEntry> moving;
+    moving.swap(bucket);
+    for (size_t i = 0; i < moving.size(); ++i) {
+        insert(moving[i]);
+    }
+    moving.clear();
+    bucket.swap(moving); // 把容量还给原来的槽，避免下次重新分配
+}
+
+// 前进一个节拍
+void TimingWheel::advance(std::vector<TimerEntry>& expired) {
+    now_++;
+    // 第0层转完一圈时，从第1层下沉一个槽；第1层也转完一圈时还要从第2层下沉，依此类推
+    // 从高层往低层下沉：高层下沉到第1层当前槽的定时器还要在同一个节拍继续下沉到第0层
+    int top = 0;
+    while (top + 1 < LEVELS && (now_ & ((1ull << (SLOT_BITS * (top + 1))) - 1)) == 0) {
+        top++;
+    }
+    for (int level = top; level >= 1; --level) {
+        cascade(level);
+    }
+    std::vector<TimerEntry>& bucket = slots_[0][now_ & (SLOTS - 1)];
+    expired.insert(expired.end(), bucket.begin(), bucket.end());
+    size_ -= bucket.size();
+    bucket.clear();
+}
+
+// 前进到target节拍
+void TimingWheel::advance_to(uint64_t target, std::vector<TimerEntry>& expired) {
+    while (now_ < target) {
+        advance(expired);
+    }
+}
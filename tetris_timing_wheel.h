@@ -0,0 +1,57 @@
+// tetris_timing_wheel.h
+// 分层时间轮（hierarchical timing wheel）
+// 管理大量定时器时，插入和到期都是O(1)：第0层有64个槽，每槽对应一个节拍；
+// 第k层的每个槽对应64^k个节拍。到期时间较远的定时器先放在高层，
+// 随着时间推进逐层“下沉”（cascade）到低层，最终在第0层的槽中到期。
+// 时间轮本身不是线程安全的，由使用者加锁。
+#ifndef TETRIS_TIMING_WHEEL_H // 防止头文件被重复包含的保护宏
+#define TETRIS_TIMING_WHEEL_H
+
+#include <cstddef> // size_t
+#include <cstdint> // 节拍计数和定时器键
+#include <vector>  // 槽内的定时器列表（复用容量，稳定运行后不再分配内存）
+
+// 一个定时器
+struct TimerEntry {
+    uint64_t key;        // 使用者定义的键（例如会话ID）
+    uint32_t generation; // 使用者定义的版本号，用于惰性取消：到期时版本号不匹配的定时器直接忽略
+    uint64_t expires;    // 到期的节拍
+};
+
+class TimingWheel {
+public:
+    static const int LEVELS = 4;                  // 层数
+    static const int SLOT_BITS = 6;               // 每层槽数的位数
+    static const int SLOTS = 1 << SLOT_BITS;      // 每层64个槽
+    static const uint64_t MAX_DELAY = (1ull << (SLOT_BITS * LEVELS)) - 1; // 最长延迟（约1677万个节拍）
+
+    TimingWheel();
+
+    // 当前节拍
+    uint64_t now() const { return now_; }
+
+    // 已登记的定时器数量（包括已被使用者惰性取消、但还没到期的定时器）
+    size_t size() const { return size_; }
+
+    // 登记一个在delay个节拍后到期的定时器（delay为0时在下一个节拍到期，超过MAX_DELAY时按MAX_DELAY处理）
+    void schedule(uint64_t key, uint32_t generation, uint64_t delay);
+
+    // 前进一个节拍，把到期的定时器追加到expired中
+    void advance(std::vector<TimerEntry>& expired);
+
+    // 前进到target节拍（可能一次跨过多个节拍），把所有到期的定时器追加到expired中
+    void advance_to(uint64_t target, std::vector<TimerEntry>& expired);
+
+private:
+    std::vector<TimerEntry> slots_[LEVELS][SLOTS];
+    uint64_t now_;
+    size_t size_;
+
+    // 按到期时间把定时器放进对应层的槽
+    void insert(const TimerEntry& entry);
+
+    // 把第level层当前槽里的定时器重新插入（它们会落到更低的层）
+    void cascade(int level);
+};
+
+#endif // TETRIS_TIMING_WHEEL_H
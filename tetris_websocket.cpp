@@ -0,0 +1,163 @@
+// tetris_websocket.cpp
+// WebSocket握手和帧编解码的实现
+#include "tetris_websocket.h"
+
+// 握手时拼接在客户端密钥后面的固定GUID（RFC 6455 第1.3节）
+static const char WS_GUID[] = "258EAFA5-E914-47DA-95CA-C5AB0DC85B11";
+
+//------------------------------------------------------------------------------
+// SHA-1：只用于计算握手应答，不涉及安全性
+//------------------------------------------------------------------------------
+
+static uint32_t rotl32(uint32_t value, int bits) {
+    return (value << bits) | (value >> (32 - bits));
+}
+
+// 处理一个64字节的块
+static void sha1_block(uint32_t state[5], const uint8_t block[64]) {
+    uint32_t w[80];
+    for (int i = 0; i < 16; ++i) {
+        w[i] = (static_cast<uint32_t>(block[i * 4]) << 24) | (static_cast<uint32_t>(block[i * 4 + 1]) << 16) |
+               (static_cast<uint32_t>(block[i * 4 + 2]) << 8) | static_cast<uint32_t>(block[i * 4 + 3]);
+    }
+    for (int i = 16; i < 80; ++i) {
+        w[i] = rotl32(w[i - 3] ^ w[i - 8] ^ w[i - 14] ^ w[i - 16], 1);
+    }
+    uint32_t a = state[0], b = state[1], c = state[2], d = state[3], e = state[4];
+    for (int i = 0; i < 80; ++i) {
+        uint32_t f, k;
+        if (i < 20) {
+            f = (b & c) | (~b & d);
+            k = 0x5A827999;
+        } else if (i < 40) {
+            f = b ^ c ^ d;
+            k = 0x6ED9EBA1;
+        } else if (i < 60) {
+            f = (b & c) | (b & d) | (c & d);
+            k = 0x8F1BBCDC;
+        } else {
+            f = b ^ c ^ d;
+            k = 0xCA62C1D6;
+        }
+        uint32_t temp = rotl32(a, 5) + f + e + k + w[i];
+        e = d;
+        d = c;
+        c = rotl32(b, 30);
+        b = a;
+        a = temp;
+    }
+    state[0] += a;
+    state[1] += b;
+    state[2] += c;
+    state[3] += d;
+    state[4] += e;
+}
+
+// 计算SHA-1摘要（20字节）
+static void sha1(const std::string& message, uint8_t digest[20]) {
+    uint32_t state[5] = {0x67452301, 0xEFCDAB89, 0x98BADCFE, 0x10325476, 0xC3D2E1F0};
+    // 补位：追加0x80，再补0直到长度模64余56，最后8字节是消息的位数（大端）
+    std::string padded = message;
+    padded.push_back(static_cast<char>(0x80));
+    while (padded.size() % 64 != 56) padded.push_back('\0');
+    uint64_t bits = static_cast<uint64_t>(message.size()) * 8;
+    for (int i = 7; i >= 0; --i) {
+        padded.push_back(static_cast<char>((bits >> (i * 8)) & 0xFF));
+    }
+    for (size_t offset = 0; offset < padded.size(); offset += 64) {
+        sha1_block(state, reinterpret_cast<const uint8_t*>(padded.data() + offset));
+    }
+    for (int i = 0; i < 5; ++i) {
+        digest[i * 4] = static_cast<uint8_t>(state[i] >> 24);
+        digest[i * 4 + 1] = static_cast<uint8_t>(state[i] >> 16);
+        digest[i * 4 + 2] = static_cast<uint8_t>(state[i] >> 8);
+        digest[i * 4 + 3] = static_cast<uint8_t>(state[i]);
+    }
+}
+
+// base64编码
+static std::string base64_encode(const uint8_t* data, size_t size) {
+    static const char TABLE[] = "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    std::string out;
+    out.reserve((size + 2) / 3 * 4);
+    for (size_t i = 0; i < size; i += 3) {
+        uint32_t chunk = static_cast<uint32_t>(data[i]) << 16;
+        if (i + 1 < size) chunk |= static_cast<uint32_t>(data[i + 1]) << 8;
+        if (i + 2 < size) chunk |= data[i + 2];
+        out.push_back(TABLE[(chunk >> 18) & 63]);
+        out.push_back(TABLE[(chunk >> 12) & 63]);
+        out.push_back(i + 1 < size ? TABLE[(chunk >> 6) & 63] : '=');
+        out.push_back(i + 2 < size ? TABLE[chunk & 63] : '=');
+    }
+    return out;
+}
+
+// 计算握手应答密钥
+std::string ws_accept_key(const std::string& client_key) {
+    uint8_t digest[20];
+    sha1(client_key + WS_GUID, digest);
+    return base64_encode(digest, sizeof(digest));
+}
+
+//------------------------------------------------------------------------------
+// 帧编解码
+//------------------------------------------------------------------------------
+
+// 解析一个客户端帧
+// 帧格式：FIN/操作码(1字节) | MASK/长度(1字节) | 扩展长度(0/2/8字节) | 掩码(4字节) | 负载
+WsParseResult ws_parse_frame(uint8_t* data, size_t size, size_t max_payload, WsFrame* frame) {
+    if (size < 2) return WS_NEED_MORE;
+    frame->fin = (data[0] & 0x80) != 0;
+    frame->opcode = data[0] & 0x0F;
+    if (data[0] & 0x70) return WS_PROTOCOL_ERROR; // 没有协商扩展，保留位必须为0
+    if (!(data[1] & 0x80)) return WS_PROTOCOL_ERROR; // 客户端发出的帧必须带掩码
+
+    uint64_t length = data[1] & 0x7F;
+    size_t header = 2;
+    if (length == 126) {
+        if (size < 4) return WS_NEED_MORE;
+        length = (static_cast<uint64_t>(data[2]) << 8) | data[3];
+        header = 4;
+    } else if (length == 127) {
+        if (size < 10) return WS_NEED_MORE;
+        length = 0;
+        for (int i = 0; i < 8; ++i) {
+            length = (length << 8) | data[2 + i];
+        }
+        header = 10;
+    }
+
+    // 控制帧（关闭、心跳）不能分片，负载不超过125字节
+    if (frame->opcode >= WS_CLOSE && (!frame->fin || length > 125)) return WS_PROTOCOL_ERROR;
+    if (length > max_payload) return WS_FRAME_TOO_LARGE;
+
+    const uint8_t* mask = data + header;
+    header += 4;
+    if (size < header + length) return WS_NEED_MORE;
+
+    uint8_t* payload = data + header;
+    for (size_t i = 0; i < length; ++i) {
+        payload[i] ^= mask[i & 3];
+    }
+    frame->header_size = header;
+    frame->payload_size = static_cast<size_t>(length);
+    return WS_FRAME_OK;
+}
+
+// 追加一个服务端帧
+void ws_append_frame(std::vector<uint8_t>& out, int opcode, const uint8_t* payload, size_t size) {
+    out.push_back(static_cast<uint8_t>(0x80 | (opcode & 0x0F))); // 总是单帧消息（FIN=1）
+    if (size < 126) {
+        out.push_back(static_cast<uint8_t>(size));
+    } else if (size <= 0xFFFF) {
+        out.push_back(126);
+        out.push_back(static_cast<uint8_t>(size >> 8));
+        out.push_back(static_cast<uint8_t>(size));
+    } else {
+        out.push_back(127);
+        for (int i = 7; i >= 0; --i) {
+            out.push_back(static_cast<uint8_t>((static_cast<uint64_t>(size) >> (i * 8)) & 0xFF));
+        }
+    }
+    out.insert(out.end(), payload, payload + size);
+}
@@ -0,0 +1,48 @@
+// tetris_websocket.h
+// WebSocket协议（RFC 6455）的最小实现：握手应答密钥的计算和帧的编解码
+// 只包含原生服务器（tetris_server）需要的部分：服务端不发送分片消息，也不支持扩展（如permessage-deflate）
+#ifndef TETRIS_WEBSOCKET_H // 防止头文件被重复包含的保护宏
+#define TETRIS_WEBSOCKET_H
+
+#include <cstddef> // size_t
+#include <cstdint> // 帧头中的固定宽度整数
+#include <string>  // 握手密钥
+#include <vector>  // 输出缓冲区
+
+// 帧类型（操作码）
+enum WsOpcode {
+    WS_CONTINUATION = 0x0, // 分片消息的后续帧
+    WS_TEXT = 0x1,         // 文本消息
+    WS_BINARY = 0x2,       // 二进制消息
+    WS_CLOSE = 0x8,        // 关闭连接
+    WS_PING = 0x9,         // 心跳请求
+    WS_PONG = 0xA          // 心跳应答
+};
+
+// 解析结果
+enum WsParseResult {
+    WS_NEED_MORE,       // 数据不足一帧，等待更多数据
+    WS_FRAME_OK,        // 成功解析出一帧
+    WS_PROTOCOL_ERROR,  // 违反协议（例如客户端帧没有掩码、控制帧被分片）
+    WS_FRAME_TOO_LARGE  // 负载超过调用方给出的上限
+};
+
+// 解析出的一帧
+struct WsFrame {
+    bool fin;              // 是否是消息的最后一帧
+    int opcode;            // 操作码（WsOpcode）
+    size_t header_size;    // 帧头字节数（包括掩码）
+    size_t payload_size;   // 负载字节数，负载紧跟在帧头之后
+};
+
+// 根据客户端的Sec-WebSocket-Key计算Sec-WebSocket-Accept：base64(SHA-1(key + 固定GUID))
+std::string ws_accept_key(const std::string& client_key);
+
+// 解析data开头的一个客户端帧
+// 成功时就地去掉负载的掩码，负载位于data + frame->header_size
+WsParseResult ws_parse_frame(uint8_t* data, size_t size, size_t max_payload, WsFrame* frame);
+
+// 在out末尾追加一个完整的服务端帧（服务端发出的帧不加掩码）
+void ws_append_frame(std::vector<uint8_t>& out, int opcode, const uint8_t* payload, size_t size);
+
+#endif // TETRIS_WEBSOCKET_H